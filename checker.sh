@@ -40,6 +40,37 @@ analyzer() {
     PASSED_TESTS=$((PASSED_TESTS + passed))
 }
 
+# the TAC of every test right after the pass its name ends with
+pass_analyzer() {
+    tests_dir=$TESTS_DIR/passes
+
+    echo "Running tests for passes"
+
+    passed=0
+    for file_path in $(ls $tests_dir/*.cl); do
+        ref_path=$tests_dir/$(basename $file_path .cl).ref
+        pass=$(basename $file_path .cl | cut -d- -f2-)
+
+        file_name=$(basename $file_path)
+        echo -en "Testing $file_name ... "
+
+        ./coolc --tac-after=$pass --module prelude $file_path 2>&1 | diff - $ref_path > /dev/null 2>&1
+
+        if [ $? -eq 0 ]; then
+            echo -e "\e[32mPASSED\e[0m"
+            passed=$((passed + 1))
+        else
+            echo -e "\e[31mFAILED\e[0m"
+        fi
+    done
+
+    total=$(ls $tests_dir/*.cl | wc -l)
+    echo "Passed $passed/$total tests"
+
+    TOTAL_TESTS=$((TOTAL_TESTS + total))
+    PASSED_TESTS=$((PASSED_TESTS + passed))
+}
+
 runner() {
     if [ "$#" -ne 2 ]; then
         echo "Usage: $0 <tests_dir> <exec_arg>"
@@ -115,11 +146,31 @@ tac_generator() {
     analyzer tac --tac
 }
 
+optimizer() {
+    echo "Testing the optimization passes"
+    pass_analyzer
+}
+
+cfg_generator() {
+    echo "Testing the control flow graph"
+    analyzer cfg --cfg
+}
+
 asm_generator() {
     echo "Testing the assembly generator"
     runner asm --asm
 }
 
+garbage_collector() {
+    echo "Testing the garbage collector"
+    runner gc "--asm --module gc"
+}
+
+data_structures() {
+    echo "Testing the data structures"
+    runner data "--asm --module data"
+}
+
 make clean && make
 
 ARG1=$1
@@ -131,16 +182,28 @@ elif [ "$ARG1" == "--sem" ]; then
     semantic_analyzer
 elif [ "$ARG1" == "--tac" ]; then
     tac_generator
+elif [ "$ARG1" == "--passes" ]; then
+    optimizer
+elif [ "$ARG1" == "--cfg" ]; then
+    cfg_generator
 elif [ "$ARG1" == "--asm" ]; then
     asm_generator
+elif [ "$ARG1" == "--gc" ]; then
+    garbage_collector
+elif [ "$ARG1" == "--data" ]; then
+    data_structures
 elif [ -z "$ARG1" ]; then
     lexical_analyzer
     syntax_analyzer
     semantic_analyzer
     tac_generator
+    optimizer
+    cfg_generator
     asm_generator
+    garbage_collector
+    data_structures
 else
-    echo "Usage: $0 [--lex | --syn | --sem | --tac | --asm]"
+    echo "Usage: $0 [--lex | --syn | --sem | --tac | --passes | --cfg | --asm | --gc | --data]"
     exit 1
 fi
 
@@ -1,6 +1,7 @@
 #ifndef ASSEMBLER_H
 #define ASSEMBLER_H
 
+#include "codegen.h"
 #include "semantic.h"
 
 enum assembler_result {
@@ -8,6 +9,39 @@ enum assembler_result {
     ASSEMBLER_ERROR,
 };
 
-enum assembler_result assembler_run(const char *filename, semantic_mapping *mapping);
+typedef struct assembler_options {
+        int report; // print what the optimizations did on stderr
+        tac_pipeline *pipeline; // passes run on the TAC of every method
+        int write_barrier; // call write_barrier after the attribute stores
+} assembler_options;
+
+// One line of the emitted assembly. The assembler keeps the lines of the
+// whole program so that the peephole pass can rewrite the instructions
+// before they are written out.
+enum asm_line_kind {
+    ASM_LINE_LABEL,
+    ASM_LINE_COMMENT,
+    ASM_LINE_CODE, // an instruction or a directive
+};
+
+#define ASM_MAX_OPERANDS 3
+
+typedef struct asm_line {
+        enum asm_line_kind kind;
+        int align;
+        char *text; // the line as it is written out
+        const char *comment;
+        char *mnemonic; // the first word of the code
+        char *operands[ASM_MAX_OPERANDS];
+        int operand_count;
+        int removed;
+} asm_line;
+
+void assembler_line_parse(asm_line *line);
+size_t assembler_count_instructions(ds_dynamic_array *lines);
+size_t assembler_peephole(ds_dynamic_array *lines);
+
+enum assembler_result assembler_run(const char *filename, semantic_mapping *mapping,
+                                    assembler_options options);
 
 #endif // ASSEMBLER_H
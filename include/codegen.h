@@ -4,6 +4,7 @@
 #include "ds.h"
 #include "parser.h"
 #include "semantic.h"
+#include <stdint.h>
 
 enum tac_kind {
     TAC_LABEL,
@@ -28,12 +29,37 @@ enum tac_kind {
     TAC_IDENT,
     TAC_ASSIGN_INT,
     TAC_ASSIGN_STRING,
-    TAC_ASSIGN_BOOL
+    TAC_ASSIGN_BOOL,
+    TAC_BOX,
+    TAC_UNBOX,
+    TAC_JUMP_IF_COND,
+    TAC_JUMP_CASE,
+    TAC_ATTR_LOAD,
+    TAC_ATTR_STORE,
+    TAC_PHI
+};
+
+enum tac_cond {
+    TAC_COND_LT,
+    TAC_COND_LE,
+    TAC_COND_GE,
+    TAC_COND_GT,
+    TAC_COND_EQ,
+    TAC_COND_NE,
+    TAC_COND_VOID,
+    TAC_COND_NOT_VOID
+};
+
+// how `=` is computed for the static type of its operands
+enum tac_eq_kind {
+    TAC_EQ_VALUE,   // Int and Bool, compared as raw values
+    TAC_EQ_BYTE,    // Byte, compared by the val attribute
+    TAC_EQ_STRING,  // String, compared by string_equals
+    TAC_EQ_DISPATCH // static dispatch to equals
 };
 
 typedef struct tac_ident {
         char *name;
-        int index;
 } tac_ident;
 
 typedef struct tac_assign_int {
@@ -72,6 +98,9 @@ typedef struct tac_assign_unary {
 typedef struct tac_assign_new {
         char *ident;
         char *type;
+        int stack;  // never leaves the method, so it lives in its frame
+        int slot;   // first stack slot of the object, set by the assembler
+        int shared; // a class without state, the prototype is the object
 } tac_assign_new;
 
 typedef struct tac_assign_value {
@@ -86,6 +115,7 @@ typedef struct tac_dispatch_call {
         char *type;
         char *method;
         ds_dynamic_array args; // char *
+        int tail;              // jumps to the method in place of returning
 } tac_dispatch_call;
 
 typedef struct tac_label {
@@ -101,6 +131,24 @@ typedef struct tac_jump_if_true {
         char *label;
 } tac_jump_if_true;
 
+typedef struct tac_jump_if_cond {
+        enum tac_cond cond;
+        char *lhs;
+        char *rhs; // NULL for the void tests
+        char *label;
+} tac_jump_if_cond;
+
+typedef struct tac_case_branch {
+        char *type;
+        char *label;
+} tac_case_branch;
+
+typedef struct tac_jump_case {
+        char *expr;
+        ds_dynamic_array branches; // tac_case_branch, first match wins
+        char *default_label;       // taken when no branch matches
+} tac_jump_case;
+
 typedef struct tac_isinstance {
         char *ident;
         char *expr;
@@ -113,6 +161,32 @@ typedef struct tac_cast {
         char *type;
 } tac_cast;
 
+typedef struct tac_box {
+        char *ident;
+        char *expr;
+        char *type;
+} tac_box;
+
+// ident <- object.attribute (load) or object.attribute <- ident (store),
+// the attribute of any object of class type
+typedef struct tac_attr {
+        char *ident;
+        char *object;
+        const char *type;
+        const char *attribute;
+} tac_attr;
+
+// the value of a phi when control comes from the block of the label
+typedef struct tac_phi_arg {
+        char *value; // NULL when the variable is undefined on that path
+        char *label;
+} tac_phi_arg;
+
+typedef struct tac_phi {
+        char *ident;
+        ds_dynamic_array args; // tac_phi_arg, one for each predecessor
+} tac_phi;
+
 typedef struct tac_instr {
         enum tac_kind kind;
         union {
@@ -133,16 +207,220 @@ typedef struct tac_instr {
                 tac_assign_int assign_int;
                 tac_assign_string assign_string;
                 tac_assign_bool assign_bool;
+                tac_box box;
+                tac_assign_unary unbox;
+                tac_jump_if_cond jump_if_cond;
+                tac_jump_case jump_case;
+                tac_attr attr;
+                tac_phi phi;
         };
 } tac_instr;
 
+typedef struct tac_local {
+        char *name;
+        const char *type; // static type of the value, may be NULL
+        int unboxed;      // holds the raw value of an Int or Bool
+        const char *reg;  // register holding the variable, NULL if spilled
+        int slot;         // stack slot of the variable when it is spilled
+} tac_local;
+
 typedef struct tac_result {
-        ds_dynamic_array locals; // char *
+        ds_dynamic_array locals; // tac_local
         ds_dynamic_array instrs; // tac_instr
+        int label_count;
+        int ssa; // the instructions are in SSA form and may contain phis
 } tac_result;
 
 int codegen_expr_to_tac(semantic_mapping *mapping, const expr_node *expr, tac_result *result);
 
-void codegen_tac_print(semantic_mapping *mapping, program_node *program);
+char *codegen_tac_new_local(tac_result *tac, const char *type, int unboxed);
+char *codegen_tac_new_label(tac_result *tac);
+tac_local *codegen_tac_find_local(tac_result *tac, const char *name);
+semantic_mapping_item *codegen_tac_find_class(semantic_mapping *mapping,
+                                              const char *class_name);
+implementation_mapping_item *
+codegen_tac_find_method(semantic_mapping_item *item, const char *method_name);
+void codegen_tac_pack_slots(tac_result *tac);
+
+// How a value is held: the unbox lowering keeps Int and Bool temporaries as
+// raw values and boxes them only where an object is needed.
+enum tac_repr {
+    TAC_REPR_NONE,  // not a use or definition
+    TAC_REPR_RAW,   // raw Int or Bool value
+    TAC_REPR_BOXED, // pointer to an object
+    TAC_REPR_FREE,  // can produce both for the same cost (constants)
+    TAC_REPR_COPY,  // has the representation of the source
+};
+
+void codegen_tac_instr_uses(tac_instr *instr, ds_dynamic_array *uses);
+void codegen_tac_instr_uses_repr(tac_instr *instr, ds_dynamic_array *uses,
+                                 ds_dynamic_array *reprs /* enum tac_repr */);
+char **codegen_tac_instr_def(tac_instr *instr);
+char **codegen_tac_instr_def_repr(tac_instr *instr, enum tac_repr *repr);
+int codegen_tac_instr_is_call(tac_instr *instr);
+void codegen_tac_instr_targets(tac_instr *instr, ds_dynamic_array *labels /* char ** */);
+int codegen_tac_instr_falls_through(tac_instr *instr);
+const char *codegen_tac_cond_name(enum tac_cond cond);
+enum tac_eq_kind codegen_tac_eq_kind(const char *type);
+int codegen_tac_is_basic_class(const char *type);
+int codegen_tac_is_value_type(const char *type);
+
+// Sets of locals or instructions, one bit for each of them.
+#define tac_set_words(count) (((count) + 63) / 64)
+#define tac_set_has(set, v) (((set)[(v) / 64] >> ((v) % 64)) & 1)
+#define tac_set_add(set, v) ((set)[(v) / 64] |= (uint64_t)1 << ((v) % 64))
+#define tac_set_remove(set, v)                                                 \
+    ((set)[(v) / 64] &= ~((uint64_t)1 << ((v) % 64)))
+
+// A basic block is a range of instructions that starts at a label, at the
+// first instruction or after a jump, and ends at a jump or before a label.
+typedef struct tac_basic_block {
+        size_t first;                  // first instruction
+        size_t last;                   // one past the last instruction
+        ds_dynamic_array successors;   // size_t, blocks
+        ds_dynamic_array predecessors; // size_t, blocks
+} tac_basic_block;
+
+typedef struct tac_cfg {
+        tac_result *tac;
+        ds_dynamic_array blocks; // tac_basic_block, the entry block first
+        size_t *block_of;        // the block of each instruction
+} tac_cfg;
+
+typedef struct tac_liveness {
+        size_t words;  // words in a set of locals
+        uint64_t *in;  // locals live before each instruction
+        uint64_t *out; // locals live after each instruction
+} tac_liveness;
+
+typedef struct tac_reaching {
+        size_t words;   // words in a set of instructions
+        uint64_t *in;   // definitions reaching the start of each block
+        uint64_t *out;  // definitions reaching the end of each block
+        uint64_t *defs; // the definitions of each local
+        int *local_of;  // the local written by each instruction, -1 if none
+} tac_reaching;
+
+typedef struct tac_dominators {
+        size_t blocks;
+        int *idom;                  // immediate dominator of each block, -1
+                                    // for the entry and unreachable blocks
+        int *rpo;                   // reverse postorder index, -1 if the
+                                    // block is unreachable
+        ds_dynamic_array *children; // size_t, blocks dominated immediately
+} tac_dominators;
+
+void codegen_tac_cfg_build(tac_result *tac, tac_cfg *cfg);
+void codegen_tac_cfg_free(tac_cfg *cfg);
+tac_instr *codegen_tac_get_instr(tac_result *tac, size_t i);
+tac_basic_block *codegen_tac_get_block(tac_cfg *cfg, size_t b);
+int codegen_tac_local_index(tac_result *tac, const char *name);
+int codegen_tac_label_block(tac_cfg *cfg, const char *label);
+void codegen_tac_liveness(tac_cfg *cfg, tac_liveness *liveness);
+void codegen_tac_liveness_free(tac_liveness *liveness);
+void codegen_tac_reaching(tac_cfg *cfg, tac_reaching *reaching);
+void codegen_tac_reaching_step(tac_cfg *cfg, tac_reaching *reaching,
+                               size_t i, uint64_t *set);
+void codegen_tac_reaching_free(tac_reaching *reaching);
+void codegen_tac_dominators(tac_cfg *cfg, tac_dominators *dominators);
+int codegen_tac_dominates(tac_dominators *dominators, size_t a, size_t b);
+void codegen_tac_dominators_free(tac_dominators *dominators);
+
+typedef struct tac_stats {
+        size_t dispatches;    // dynamic dispatches seen
+        size_t devirtualized; // turned into direct calls
+        size_t inlined;       // direct calls replaced by the method body
+        size_t redundant;     // computations replaced by an earlier value
+        size_t hoisted;       // loop invariant computations moved out
+        size_t tail_calls;    // calls that reuse the frame of the caller
+        size_t stack_objects; // new objects allocated in the frame
+        size_t shared;        // new objects of stateless classes shared
+} tac_stats;
+
+// Optimizations run on the TAC of one method at a time. The passes of the
+// boxed stage see every Int and Bool as an object; the unbox lowering then
+// always runs and the passes of the unboxed stage see the raw values. The
+// passes of the emitted stage run on the assembly of the whole program.
+enum tac_stage { TAC_STAGE_BOXED, TAC_STAGE_UNBOXED, TAC_STAGE_EMITTED };
+
+typedef struct tac_pass_context {
+        semantic_mapping *mapping;
+        const char *class_name;
+        const char *method_name; // NULL for attribute initializers
+        tac_stats *stats;
+} tac_pass_context;
+
+typedef struct tac_pass {
+        const char *name;
+        const char *description;
+        enum tac_stage stage;
+        void (*run)(tac_pass_context *context, tac_result *tac);
+} tac_pass;
+
+typedef struct tac_pipeline {
+        ds_dynamic_array passes; // const tac_pass *
+} tac_pipeline;
+
+#define TAC_OPT_LEVEL_MAX 2
+
+// the first arguments of a call are passed in registers, the rest on the
+// stack
+#define TAC_REGISTER_ARGS 4
+
+int codegen_tac_pipeline_level(int level, tac_pipeline *pipeline);
+int codegen_tac_pipeline_parse(const char *names, tac_pipeline *pipeline);
+int codegen_tac_pipeline_has(tac_pipeline *pipeline, const char *name);
+void codegen_tac_pipeline_run(tac_pipeline *pipeline, tac_pass_context *context,
+                              tac_result *tac, const char *stop_after);
+void codegen_tac_pipeline_free(tac_pipeline *pipeline);
+
+void codegen_tac_devirtualize(semantic_mapping *mapping,
+                              const char *class_name, tac_result *tac,
+                              tac_stats *stats);
+void codegen_tac_inline(semantic_mapping *mapping, const char *class_name,
+                        const char *method_name, tac_result *tac,
+                        tac_stats *stats);
+void codegen_tac_fold_constants(tac_result *tac);
+int codegen_tac_is_pure_call(tac_dispatch_call *call);
+int codegen_tac_is_immutable_attribute(tac_attr *attr);
+void codegen_tac_number_values(semantic_mapping *mapping,
+                               const char *class_name, const char *method_name,
+                               tac_result *tac, tac_stats *stats);
+void codegen_tac_hoist_invariants(semantic_mapping *mapping,
+                                  const char *class_name,
+                                  const char *method_name, tac_result *tac,
+                                  tac_stats *stats);
+void codegen_tac_eliminate_dead_code(tac_result *tac);
+void codegen_tac_coalesce_copies(tac_result *tac);
+void codegen_tac_to_ssa(tac_result *tac);
+void codegen_tac_from_ssa(tac_result *tac);
+void codegen_tac_retarget_phis(tac_result *tac, const char *from, char *to);
+void codegen_tac_unbox(tac_result *tac);
+void codegen_tac_fuse_branches(tac_result *tac);
+void codegen_tac_lower_case(tac_result *tac);
+void codegen_tac_lower_formals(semantic_mapping *mapping,
+                               const char *class_name,
+                               const char *method_name, tac_result *tac);
+void codegen_tac_mark_tail_calls(semantic_mapping *mapping,
+                                 const char *class_name,
+                                 const char *method_name, tac_result *tac,
+                                 tac_stats *stats);
+void codegen_tac_share_stateless(semantic_mapping *mapping, tac_result *tac,
+                                 tac_stats *stats);
+void codegen_tac_stack_allocate(semantic_mapping *mapping,
+                                const char *method_name, tac_result *tac,
+                                tac_stats *stats);
+// the registers the methods have to preserve besides rbx; the allocator
+// keeps the locals that live across calls in them and the prologue of a
+// method saves the ones it was given
+#define TAC_CALLEE_SAVED_COUNT 4
+extern const char *codegen_tac_callee_saved[TAC_CALLEE_SAVED_COUNT];
+
+void codegen_tac_regalloc(tac_result *tac);
+
+void codegen_tac_print(semantic_mapping *mapping, program_node *program,
+                       tac_pipeline *pipeline, const char *stop_after);
+void codegen_tac_print_cfg(semantic_mapping *mapping, program_node *program,
+                           tac_pipeline *pipeline, const char *stop_after);
 
 #endif // CODEGEN_H
@@ -21,6 +21,11 @@
 #define ARG_TACGEN "tac"
 #define ARG_ASSEMBLER "asm"
 #define ARG_MODULE "module"
+#define ARG_REPORT "report"
+#define ARG_OPT_LEVEL "opt"
+#define ARG_PASSES "passes"
+#define ARG_TAC_AFTER "tac-after"
+#define ARG_CFG "cfg"
 
 int util_parse_arguments(ds_argparse_parser *parser, int argc, char **argv);
 int util_validate_module(char *cool_lib, const char *module);
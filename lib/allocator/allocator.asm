@@ -72,3 +72,16 @@ allocate:
     add     rsp, 16                    ; deallocate local variables
     pop     rbp                        ; restore return address
     ret
+
+;
+;
+; write_barrier
+;
+;   This allocator does not track stores, nothing to do.
+;
+;   INPUT: rdi contains the object that was written to
+;   STACK: empty
+;   OUTPUT: nothing
+;
+write_barrier:
+    ret
@@ -18,29 +18,31 @@ class List {
         }
     };
 
+    set_next(n: List): List {
+        next <- n
+    };
+
     single(v: Object): List {
         let void: List in new List.init(v, void)
     };
 
+    last(): List {
+        if isvoid next then
+            self
+        else
+            next.last()
+        fi
+    };
+
     append(v: Object): List {
-        {
-            if isvoid next then
-                let void: List
-                in next <- new List.init(v, void)
-            else
-                next.append(v)
-            fi;
-            self;
-        }
+        let void: List
+        in concat(new List.init(v, void))
     };
 
     concat(l: List): List {
         {
-            if isvoid next then
-                next <- l
-            else
-                next.concat(l)
-            fi;
+            let tail: List <- last()
+            in tail.set_next(l);
             self;
         }
     };
@@ -0,0 +1,1697 @@
+;
+;
+; Generational mostly copying garbage collector
+;
+;   Objects are allocated in a fixed size nursery. When the nursery is full a
+;   minor collection copies every live nursery object into the old space (all
+;   survivors are promoted at once) and the nursery is reused from the start.
+;   The old space is made of two semispaces; once it grows past its threshold
+;   a major collection copies everything that is still alive into the other
+;   semispace and returns the pages of the first one to the kernel.
+;
+;   Roots are found conservatively: a word on the stack or in the callee saved
+;   registers that points inside an object of the space being collected pins
+;   that object. A pinned object is not copied and the root words are never
+;   changed, since any of them may be a plain integer that only looks like an
+;   address. The nursery then allocates in the gaps between its pinned
+;   objects, and the objects pinned in a semispace stay there until the next
+;   major collection, which copies the live objects around them. The gaps are
+;   marked with filler objects so that every space can be walked.
+;
+;   The objects themselves are scanned precisely: every attribute holds a
+;   reference, except for the raw val of the boxed values (Int, Bool, Byte,
+;   Word, DoubleWord and Float) and the bytes that follow the length of a
+;   String. References may point inside an object (like the ones kept by Ref).
+;
+;   Stores into old objects are tracked with a card table which is updated by
+;   write_barrier. The compiler emits a call to it after every attribute store.
+;   A card that still points to a pinned nursery object after a collection is
+;   left dirty.
+;
+;   Set COOL_GC_STATS in the environment to report every collection (and its
+;   pause) on stderr.
+;
+
+GC_NURSERY_SIZE = 0x100000            ; 1 MiB nursery
+GC_SEMISPACE_SIZE = 0x40000000         ; 1 GiB of address space per semispace
+GC_CARD_SHIFT = 9                      ; 512 bytes per card
+GC_LARGE_OBJECT = 0x10000              ; larger objects go to the old space
+GC_OLD_THRESHOLD = 0x800000            ; minimum old space before a major gc
+GC_FORWARDED = -1                      ; tag of an object that was copied
+GC_FILLER = -2                         ; tag of a gap, its size in words follows
+GC_FILLER_WORD = -3                    ; tag of a gap of a single word
+GC_CARD_DIRTY = 1                      ; written since the last collection
+GC_CARD_YOUNG = 2                      ; found pointing to the nursery by the gc
+
+GC_SPACE_SIZE = GC_NURSERY_SIZE + 2 * GC_SEMISPACE_SIZE
+GC_CARDS_SIZE = (2 * GC_SEMISPACE_SIZE) shr GC_CARD_SHIFT
+GC_MAP_SIZE = GC_SPACE_SIZE shr 6
+GC_HEAP_SIZE = GC_SPACE_SIZE + GC_CARDS_SIZE + 2 * GC_MAP_SIZE
+
+section '.data' writeable
+
+; memory layout
+heap_pos dq 0                          ; next free byte of the nursery
+heap_end dq 0                          ; end of the gap heap_pos is in
+gc_nursery_start dq 0                  ; also the start of the whole heap
+gc_nursery_end dq 0
+gc_old_base dq 0                       ; first semispace, the cards start here
+gc_old_start dq 0                      ; current old semispace
+gc_old_pos dq 0
+gc_old_gap dq 0                        ; end of the gap gc_old_pos is in
+gc_old_end dq 0
+gc_old_other dq 0                      ; the other old semispace
+gc_other_pos dq 0                      ; end of its objects, some are pinned
+gc_old_limit dq GC_OLD_THRESHOLD
+gc_space_end dq 0                      ; end of the second semispace
+gc_cards dq 0                          ; one byte per card of the old space
+gc_start_map dq 0                      ; one bit per word, set where objects start
+gc_pin_map dq 0                        ; one bit per word, set on pinned objects
+
+; collection state
+gc_from_start dq 0                     ; space being collected
+gc_from_end dq 0
+gc_to_top dq 0                         ; end of the pinned objects copied around
+gc_stack_base dq 0
+
+; the classes with attributes that are not references: the boxed values keep
+; a raw val and a String keeps its bytes after the length
+gc_string_class dq String_dispTab
+gc_value_classes dq Int_dispTab, Bool_dispTab, Byte_dispTab, Word_dispTab, DoubleWord_dispTab, Float_dispTab
+gc_value_classes_count = ($ - gc_value_classes) / 8
+
+; statistics
+gc_stats dq 0
+gc_minor_count dq 0
+gc_major_count dq 0
+gc_time_start dq 0, 0
+gc_time_end dq 0, 0
+gc_digits dq 0, 0, 0
+
+gc_stats_env db 'COOL_GC_STATS='
+gc_stats_env_len = $ - gc_stats_env
+gc_minor_msg db 'gc: minor #'
+gc_minor_msg_len = $ - gc_minor_msg
+gc_major_msg db 'gc: major #'
+gc_major_msg_len = $ - gc_major_msg
+gc_promoted_msg db ' promoted '
+gc_promoted_msg_len = $ - gc_promoted_msg
+gc_live_msg db ' live '
+gc_live_msg_len = $ - gc_live_msg
+gc_pause_msg db ' bytes, pause '
+gc_pause_msg_len = $ - gc_pause_msg
+gc_us_msg db ' us', 10
+gc_us_msg_len = $ - gc_us_msg
+gc_oom_msg db 'gc: out of memory', 10
+gc_oom_msg_len = $ - gc_oom_msg
+
+section '.text' executable
+
+;
+;
+; allocator_init
+;
+;   Reserves the heap and remembers the bottom of the stack. It has to be the
+;   first call made by _start, so that argc, argv and envp are right above the
+;   return address.
+;
+;   INPUT: nothing
+;   STACK: empty
+;   OUTPUT: nothing
+allocator_init:
+    push    rbp                        ; save return address
+    mov     rbp, rsp                   ; set up stack frame
+    push    rbx                        ; save register
+    push    r12                        ; save register
+
+    lea     rax, [rbp + 16]            ; everything above belongs to _start
+    mov     [gc_stack_base], rax
+
+    ; reserve the whole heap at once, pages are only backed when touched
+    mov     rax, 9                     ; mmap
+    mov     rdi, 0                     ; let the kernel choose the address
+    mov     rsi, GC_HEAP_SIZE
+    mov     rdx, 3                     ; PROT_READ | PROT_WRITE
+    mov     r10, 0x4022                ; MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE
+    mov     r8, -1
+    mov     r9, 0
+    syscall
+    cmp     rax, -4096
+    ja      gc_out_of_memory
+
+    mov     [gc_nursery_start], rax
+    mov     [heap_pos], rax
+    add     rax, GC_NURSERY_SIZE
+    mov     [heap_end], rax
+    mov     [gc_nursery_end], rax
+
+    mov     [gc_old_base], rax
+    mov     [gc_old_start], rax
+    mov     [gc_old_pos], rax
+    mov     rdi, GC_SEMISPACE_SIZE
+    add     rax, rdi
+    mov     [gc_old_gap], rax
+    mov     [gc_old_end], rax
+
+    mov     [gc_old_other], rax
+    mov     [gc_other_pos], rax
+    add     rax, rdi
+    mov     [gc_space_end], rax
+
+    mov     [gc_cards], rax
+    add     rax, GC_CARDS_SIZE
+    mov     [gc_start_map], rax
+    add     rax, GC_MAP_SIZE
+    mov     [gc_pin_map], rax
+
+    ; the nursery starts as a single gap
+    mov     rdi, [gc_nursery_start]
+    mov     rsi, [gc_nursery_end]
+    call    gc_fill
+
+    ; look for COOL_GC_STATS in envp
+    mov     rax, [rbp + 16]            ; argc
+    lea     rbx, [rbp + 8*rax + 32]    ; envp
+.next_env:
+    mov     r12, [rbx]
+    test    r12, r12
+    jz      .done
+
+    mov     rsi, gc_stats_env
+    mov     rcx, gc_stats_env_len
+.next_char:
+    mov     al, byte [rsi]
+    cmp     al, byte [r12]
+    jne     .skip_env
+    inc     rsi
+    inc     r12
+    dec     rcx
+    jnz     .next_char
+
+    mov     qword [gc_stats], 1
+    jmp     .done
+
+.skip_env:
+    add     rbx, 8
+    jmp     .next_env
+
+.done:
+    pop     r12                        ; restore register
+    pop     rbx                        ; restore register
+    pop     rbp                        ; restore return address
+    ret
+
+;
+;
+; allocate
+;
+;   Bump allocates in the gaps of the nursery and runs a collection when they
+;   are all full. Large objects are allocated directly in the old space, and
+;   so are the ones that do not fit in any gap even after a collection.
+;
+;   INPUT: rdi contains the size in bytes
+;   STACK: empty
+;   OUTPUT: rax points to the newly allocated memory
+;
+allocate:
+    push    rbp                        ; save return address
+    mov     rbp, rsp                   ; set up stack frame
+    push    rdi                        ; save size
+    push    0                          ; no collection yet
+
+    cmp     rdi, GC_LARGE_OBJECT
+    jae     .large
+
+.retry:
+    mov     rax, qword [heap_pos]
+    lea     rdx, [rax + rdi]
+    cmp     rdx, qword [heap_end]
+    ja      .full
+
+    mov     qword [heap_pos], rdx
+    jmp     .done
+
+.full:
+    mov     rax, qword [heap_end]
+    cmp     rax, qword [gc_nursery_end]
+    jae     .collect
+
+    call    gc_next_gap
+    mov     rdi, qword [rbp - 8]
+    jmp     .retry
+
+.collect:
+    cmp     qword [rbp - 16], 0
+    jne     .large_alloc               ; the pinned objects left no room
+
+    mov     qword [rbp - 16], 1
+    call    gc_collect
+    mov     rdi, qword [rbp - 8]
+    jmp     .retry
+
+.large:
+    mov     rax, qword [gc_old_pos]
+    add     rax, rdi
+    sub     rax, qword [gc_old_start]
+    cmp     rax, qword [gc_old_limit]
+    jbe     .large_alloc
+
+    call    gc_collect
+
+.large_alloc:
+    mov     rdi, qword [rbp - 8]
+    call    gc_allocate_old
+
+.done:
+    add     rsp, 16                    ; drop saved size
+    pop     rbp                        ; restore return address
+    ret
+
+;
+;
+; write_barrier
+;
+;   Remembers that an object was written to, so that the next minor
+;   collection can find the nursery objects referenced by old objects.
+;   Every card the object spans is marked, since the attribute that was
+;   written may be in any of them. All registers are preserved.
+;
+;   INPUT: rdi contains the object that was written to
+;   STACK: empty
+;   OUTPUT: nothing
+;
+write_barrier:
+    push    rdi                        ; save register
+    push    rsi                        ; save register
+
+    mov     rsi, rdi
+    sub     rdi, qword [gc_old_base]
+    jb      .done                      ; not an old object
+    cmp     rsi, qword [gc_space_end]
+    jae     .done
+
+    ; mark the cards from the first to the last byte of the object
+    mov     rsi, qword [rsi + 8]       ; object size
+    lea     rsi, [rdi + 8*rsi - 1]
+    shr     rdi, GC_CARD_SHIFT
+    shr     rsi, GC_CARD_SHIFT
+    add     rdi, qword [gc_cards]
+    add     rsi, qword [gc_cards]
+.next_card:
+    mov     byte [rdi], GC_CARD_DIRTY  ; mark the card as dirty
+    inc     rdi
+    cmp     rdi, rsi
+    jbe     .next_card
+
+.done:
+    pop     rsi                        ; restore register
+    pop     rdi                        ; restore register
+    ret
+
+;
+;
+; gc_next_gap
+;
+;   Moves the nursery allocation past the pinned object at heap_end, to the
+;   next gap. The rest of the current gap is filled.
+;
+;   INPUT: nothing
+;   STACK: empty
+;   OUTPUT: nothing
+;
+gc_next_gap:
+    push    rbp                        ; save return address
+    mov     rbp, rsp                   ; set up stack frame
+    push    rbx                        ; save register
+    push    rbx                        ; keep the stack aligned
+
+    mov     rbx, qword [heap_end]      ; the pinned object
+    mov     rdi, qword [heap_pos]
+    mov     rsi, rbx
+    call    gc_fill
+
+    mov     rdi, rbx
+    call    gc_words
+    lea     rdi, [rbx + 8*rax]
+    mov     qword [heap_pos], rdi
+    mov     rsi, qword [gc_nursery_end]
+    call    gc_next_pin
+    mov     qword [heap_end], rax
+
+    pop     rbx                        ; restore register
+    pop     rbx                        ; restore register
+    pop     rbp                        ; restore return address
+    ret
+
+;
+;
+; gc_allocate_old
+;
+;   Bump allocates in the old space. The cards of the new memory are marked
+;   as dirty, since the caller fills it with references to nursery objects.
+;
+;   INPUT: rdi contains the size in bytes
+;   STACK: empty
+;   OUTPUT: rax points to the newly allocated memory
+;
+gc_allocate_old:
+    push    rbp                        ; save return address
+    mov     rbp, rsp                   ; set up stack frame
+    push    rdi                        ; save size
+    push    rdi                        ; keep the stack aligned
+
+    call    gc_old_bump
+
+    ; mark the cards from rax to rax + size - 1
+    mov     rsi, rax
+    sub     rsi, qword [gc_old_base]
+    mov     rdx, qword [rbp - 8]
+    lea     rdx, [rsi + rdx - 1]
+    shr     rsi, GC_CARD_SHIFT
+    shr     rdx, GC_CARD_SHIFT
+    add     rsi, qword [gc_cards]
+    add     rdx, qword [gc_cards]
+.next_card:
+    mov     byte [rsi], GC_CARD_DIRTY
+    inc     rsi
+    cmp     rsi, rdx
+    jbe     .next_card
+
+    add     rsp, 16                    ; drop saved size
+    pop     rbp                        ; restore return address
+    ret
+
+;
+;
+; gc_old_bump
+;
+;   Bump allocates in the old space, skipping the pinned objects of the
+;   semispace a major collection is copying to. The start of the new object
+;   is marked in the start map.
+;
+;   INPUT: rdi contains the size in bytes
+;   STACK: empty
+;   OUTPUT: rax points to the newly allocated memory
+;
+gc_old_bump:
+    push    rbp                        ; save return address
+    mov     rbp, rsp                   ; set up stack frame
+    push    rbx                        ; save register
+    push    rbx                        ; keep the stack aligned
+
+    mov     rbx, rdi
+.retry:
+    mov     rax, qword [gc_old_pos]
+    lea     rdx, [rax + rbx]
+    cmp     rdx, qword [gc_old_gap]
+    jbe     .found
+
+    mov     rax, qword [gc_old_gap]
+    cmp     rax, qword [gc_old_end]
+    jae     gc_out_of_memory
+    call    gc_old_next_gap
+    jmp     .retry
+
+.found:
+    mov     qword [gc_old_pos], rdx
+    mov     rcx, rax
+    sub     rcx, qword [gc_nursery_start]
+    shr     rcx, 3
+    mov     rdx, qword [gc_start_map]
+    bts     qword [rdx], rcx
+
+    pop     rbx                        ; restore register
+    pop     rbx                        ; restore register
+    pop     rbp                        ; restore return address
+    ret
+
+;
+;
+; gc_old_next_gap
+;
+;   Moves the old space allocation past the pinned object at gc_old_gap, to
+;   the next gap. The rest of the current gap is filled.
+;
+;   INPUT: nothing
+;   STACK: empty
+;   OUTPUT: nothing
+;
+gc_old_next_gap:
+    push    rbp                        ; save return address
+    mov     rbp, rsp                   ; set up stack frame
+    push    rbx                        ; save register
+    push    rbx                        ; keep the stack aligned
+
+    mov     rbx, qword [gc_old_gap]    ; the pinned object
+    mov     rdi, qword [gc_old_pos]
+    mov     rsi, rbx
+    call    gc_fill
+
+    mov     rdi, rbx
+    call    gc_words
+    lea     rdi, [rbx + 8*rax]
+    mov     qword [gc_old_pos], rdi
+    mov     rsi, qword [gc_to_top]
+    call    gc_next_pin
+    cmp     rax, qword [gc_to_top]
+    jb      .found
+    mov     rax, qword [gc_old_end]    ; no more pinned objects
+.found:
+    mov     qword [gc_old_gap], rax
+
+    pop     rbx                        ; restore register
+    pop     rbx                        ; restore register
+    pop     rbp                        ; restore return address
+    ret
+
+;
+;
+; gc_collect
+;
+;   Runs a minor collection, followed by a major one if the old space grew
+;   past its threshold. The callee saved registers are pushed on the stack so
+;   that the objects they point to are pinned like the ones the stack does.
+;
+;   INPUT: nothing
+;   STACK: empty
+;   OUTPUT: nothing
+;
+gc_collect:
+    push    rbp                        ; save return address
+    mov     rbp, rsp                   ; set up stack frame
+    push    rbx                        ; save registers, they are roots
+    push    r12
+    push    r13
+    push    r14
+    push    r15
+    sub     rsp, 8                     ; keep the stack aligned
+
+    call    gc_clock_start
+    call    gc_minor
+    inc     qword [gc_minor_count]
+    mov     rdi, gc_minor_msg
+    mov     rsi, gc_minor_msg_len
+    mov     rdx, qword [gc_minor_count]
+    mov     rcx, gc_promoted_msg
+    mov     r8, gc_promoted_msg_len
+    call    gc_report
+
+    mov     rax, qword [gc_old_pos]
+    sub     rax, qword [gc_old_start]
+    cmp     rax, qword [gc_old_limit]
+    jbe     .done
+
+    call    gc_clock_start
+    call    gc_major
+    inc     qword [gc_major_count]
+    mov     rdi, gc_major_msg
+    mov     rsi, gc_major_msg_len
+    mov     rdx, qword [gc_major_count]
+    mov     rcx, gc_live_msg
+    mov     r8, gc_live_msg_len
+    call    gc_report
+
+.done:
+    add     rsp, 8
+    pop     r15                        ; restore registers
+    pop     r14
+    pop     r13
+    pop     r12
+    pop     rbx
+    pop     rbp                        ; restore return address
+    ret
+
+;
+;
+; gc_minor
+;
+;   Promotes every live nursery object that is not pinned to the old space.
+;   The pinned ones stay and the nursery allocates around them.
+;
+;   INPUT: nothing
+;   STACK: empty
+;   OUTPUT: rax contains the number of bytes promoted
+;
+gc_minor:
+    push    rbp                        ; save return address
+    mov     rbp, rsp                   ; set up stack frame
+    push    rbx                        ; save register
+    push    r12                        ; save register
+
+    ; fill the rest of the current gap, so that the nursery can be walked
+    mov     rdi, qword [heap_pos]
+    mov     rsi, qword [heap_end]
+    call    gc_fill
+
+    ; the nursery is the space being collected
+    mov     rdi, qword [gc_nursery_start]
+    mov     rsi, qword [gc_nursery_end]
+    call    gc_build_map
+
+    mov     rbx, qword [gc_old_pos]    ; first promoted object
+
+    ; roots: stack
+    lea     rdi, [rbp + 16]
+    call    gc_scan_stack
+
+    ; the pinned objects and the dirty cards of the old space
+    mov     rdi, qword [gc_nursery_start]
+    mov     rsi, qword [gc_nursery_end]
+    xor     rdx, rdx
+    call    gc_scan_pinned
+
+    mov     rdi, qword [gc_old_start]
+    mov     rsi, rbx
+    call    gc_scan_cards
+
+    mov     rdi, qword [gc_old_other]
+    mov     rsi, qword [gc_other_pos]
+    mov     rdx, 1                     ; only the ones with dirty cards
+    call    gc_scan_pinned
+
+    ; copy everything reachable from the promoted objects
+    mov     rdi, rbx
+    call    gc_scan_copied
+
+    ; only the old objects pointing to pinned nursery objects stay dirty
+    mov     rdi, qword [gc_old_start]
+    mov     rsi, qword [gc_old_pos]
+    call    gc_settle_cards
+    mov     rdi, qword [gc_old_other]
+    mov     rsi, qword [gc_other_pos]
+    call    gc_settle_cards
+
+    call    gc_reset_nursery
+
+    mov     rax, qword [gc_old_pos]
+    sub     rax, rbx
+
+    pop     r12                        ; restore register
+    pop     rbx                        ; restore register
+    pop     rbp                        ; restore return address
+    ret
+
+;
+;
+; gc_major
+;
+;   Copies every live old object that is not pinned into the other semispace,
+;   around the objects the last major collection pinned there. It runs right
+;   after a minor collection, so the nursery only has pinned objects.
+;
+;   INPUT: nothing
+;   STACK: empty
+;   OUTPUT: rax contains the number of live bytes
+;
+gc_major:
+    push    rbp                        ; save return address
+    mov     rbp, rsp                   ; set up stack frame
+    push    rbx                        ; save register
+    push    r12                        ; save register
+
+    ; the current semispace is the space being collected, the start map
+    ; already has its objects
+    mov     rbx, qword [gc_old_start]
+    mov     r12, qword [gc_old_pos]
+    mov     qword [gc_from_start], rbx
+    mov     qword [gc_from_end], r12
+    mov     rdi, qword [gc_pin_map]
+    mov     rsi, rbx
+    mov     rdx, r12
+    call    gc_clear_bits
+
+    ; the other semispace only keeps the objects that were pinned there
+    mov     rdi, qword [gc_old_other]
+    mov     rsi, qword [gc_other_pos]
+    call    gc_keep_pinned
+
+    ; switch to the other semispace
+    mov     rax, qword [gc_other_pos]
+    mov     qword [gc_to_top], rax
+    mov     rax, qword [gc_old_other]
+    mov     qword [gc_old_start], rax
+    mov     qword [gc_old_pos], rax
+    add     rax, GC_SEMISPACE_SIZE
+    mov     qword [gc_old_end], rax
+    mov     qword [gc_old_other], rbx
+    mov     qword [gc_other_pos], r12
+
+    mov     rdi, qword [gc_old_start]
+    mov     rsi, qword [gc_to_top]
+    call    gc_next_pin
+    cmp     rax, qword [gc_to_top]
+    jb      .first_gap
+    mov     rax, qword [gc_old_end]
+.first_gap:
+    mov     qword [gc_old_gap], rax
+
+    ; roots: stack
+    lea     rdi, [rbp + 16]
+    call    gc_scan_stack
+
+    ; the pinned objects of the old semispace, the nursery and the new one
+    mov     rdi, rbx
+    mov     rsi, r12
+    xor     rdx, rdx
+    call    gc_scan_pinned
+
+    mov     rdi, qword [gc_nursery_start]
+    mov     rsi, qword [gc_nursery_end]
+    xor     rdx, rdx
+    call    gc_scan_pinned
+
+    mov     rdi, qword [gc_old_start]
+    mov     rsi, qword [gc_to_top]
+    xor     rdx, rdx
+    call    gc_scan_pinned
+
+    ; copy everything reachable from the roots
+    mov     rdi, qword [gc_old_start]
+    call    gc_scan_copied
+
+    ; move past the pinned objects above the copies
+.next_gap:
+    mov     rax, qword [gc_old_gap]
+    cmp     rax, qword [gc_old_end]
+    jae     .copied
+    call    gc_old_next_gap
+    jmp     .next_gap
+
+.copied:
+    mov     rdi, qword [gc_old_start]
+    mov     rsi, qword [gc_old_pos]
+    call    gc_settle_cards
+    mov     rdi, rbx
+    mov     rsi, r12
+    call    gc_settle_cards
+
+    ; give the pages of the old semispace back to the kernel
+    mov     rdi, rbx
+    mov     rsi, r12
+    call    gc_release
+
+    ; collect again when the old space doubles
+    mov     rax, qword [gc_old_pos]
+    sub     rax, qword [gc_old_start]
+    lea     rdi, [rax + rax]
+    cmp     rdi, GC_OLD_THRESHOLD
+    jae     .set_limit
+    mov     rdi, GC_OLD_THRESHOLD
+.set_limit:
+    mov     qword [gc_old_limit], rdi
+
+    pop     r12                        ; restore register
+    pop     rbx                        ; restore register
+    pop     rbp                        ; restore return address
+    ret
+
+;
+;
+; gc_build_map
+;
+;   Walks the objects of the nursery and marks where each one starts. The
+;   nursery becomes the space being collected and none of its objects is
+;   pinned yet.
+;
+;   INPUT:
+;       rdi points to the start of the nursery
+;       rsi points to the end of the nursery
+;   STACK: empty
+;   OUTPUT: nothing
+;
+gc_build_map:
+    push    rbp                        ; save return address
+    mov     rbp, rsp                   ; set up stack frame
+    push    rbx                        ; save register
+    push    r12                        ; save register
+
+    mov     qword [gc_from_start], rdi
+    mov     qword [gc_from_end], rsi
+    mov     rbx, rdi
+    mov     r12, rsi
+
+    mov     rdi, qword [gc_start_map]
+    mov     rsi, rbx
+    mov     rdx, r12
+    call    gc_clear_bits
+    mov     rdi, qword [gc_pin_map]
+    mov     rsi, rbx
+    mov     rdx, r12
+    call    gc_clear_bits
+
+.next_object:
+    cmp     rbx, r12
+    jae     .done
+
+    mov     rcx, rbx
+    sub     rcx, qword [gc_nursery_start]
+    shr     rcx, 3
+    mov     rax, rcx
+    shr     rax, 6
+    mov     rdx, 1
+    shl     rdx, cl
+    mov     rsi, qword [gc_start_map]
+    or      qword [rsi + 8*rax], rdx
+
+    mov     rdi, rbx
+    call    gc_words
+    lea     rbx, [rbx + 8*rax]
+    jmp     .next_object
+
+.done:
+    pop     r12                        ; restore register
+    pop     rbx                        ; restore register
+    pop     rbp                        ; restore return address
+    ret
+
+;
+;
+; gc_clear_bits
+;
+;   Clears the bits of a map for the words of a region. The region starts
+;   at a multiple of 512 bytes into the heap.
+;
+;   INPUT:
+;       rdi points to the map
+;       rsi points to the start of the region
+;       rdx points to the end of the region
+;   STACK: empty
+;   OUTPUT: nothing
+;
+gc_clear_bits:
+    mov     rcx, rdx
+    sub     rcx, rsi
+    add     rcx, 511
+    shr     rcx, 9                     ; qwords of the map
+    sub     rsi, qword [gc_nursery_start]
+    shr     rsi, 6
+    add     rdi, rsi
+    xor     rax, rax
+    rep stosq
+    ret
+
+;
+;
+; gc_keep_pinned
+;
+;   Forgets the objects of a region of the start map that are not pinned.
+;   The region starts at a multiple of 512 bytes into the heap.
+;
+;   INPUT:
+;       rdi points to the start of the region
+;       rsi points to the end of the region
+;   STACK: empty
+;   OUTPUT: nothing
+;
+gc_keep_pinned:
+    mov     rcx, rsi
+    sub     rcx, rdi
+    add     rcx, 511
+    shr     rcx, 9                     ; qwords of the map
+    sub     rdi, qword [gc_nursery_start]
+    shr     rdi, 6
+    mov     rsi, qword [gc_start_map]
+    add     rsi, rdi
+    mov     rdx, qword [gc_pin_map]
+    add     rdx, rdi
+.next_qword:
+    test    rcx, rcx
+    jz      .done
+    mov     rax, qword [rdx]
+    and     qword [rsi], rax
+    add     rsi, 8
+    add     rdx, 8
+    dec     rcx
+    jmp     .next_qword
+
+.done:
+    ret
+
+;
+;
+; gc_scan_stack
+;
+;   Pins the objects the words between the caller's stack pointer and the
+;   bottom of the stack point to.
+;
+;   INPUT: rdi contains the stack pointer of the caller
+;   STACK: empty
+;   OUTPUT: nothing
+;
+gc_scan_stack:
+    push    rbp                        ; save return address
+    mov     rbp, rsp                   ; set up stack frame
+    push    rbx                        ; save register
+    push    r12                        ; save register
+
+    mov     rbx, rdi
+    mov     r12, qword [gc_stack_base]
+.next_word:
+    cmp     rbx, r12
+    jae     .done
+    mov     rdi, rbx
+    call    gc_pin
+    add     rbx, 8
+    jmp     .next_word
+
+.done:
+    pop     r12                        ; restore register
+    pop     rbx                        ; restore register
+    pop     rbp                        ; restore return address
+    ret
+
+;
+;
+; gc_scan_pinned
+;
+;   Forwards the references of the pinned objects of a region.
+;
+;   INPUT:
+;       rdi points to the start of the region
+;       rsi points to the end of the region
+;       rdx is not zero to only scan the objects with a dirty card
+;   STACK: empty
+;   OUTPUT: nothing
+;
+gc_scan_pinned:
+    push    rbp                        ; save return address
+    mov     rbp, rsp                   ; set up stack frame
+    push    rbx                        ; save register
+    push    r12                        ; save register
+    push    r13                        ; save register
+    push    r14                        ; save register
+
+    mov     rbx, rdi                   ; where to look for the next one
+    mov     r12, rsi                   ; end of the region
+    mov     r13, rdx
+.next_object:
+    mov     rdi, rbx
+    mov     rsi, r12
+    call    gc_next_pin
+    cmp     rax, r12
+    jae     .done
+
+    mov     r14, rax                   ; r14 <- the pinned object
+    mov     rdi, rax
+    call    gc_words
+    lea     rbx, [r14 + 8*rax]         ; rbx <- its end
+    test    r13, r13
+    jz      .scan
+
+    ; look for a dirty card from the first to the last byte of the object
+    mov     rsi, r14
+    sub     rsi, qword [gc_old_base]
+    lea     rdx, [rbx - 1]
+    sub     rdx, qword [gc_old_base]
+    shr     rsi, GC_CARD_SHIFT
+    shr     rdx, GC_CARD_SHIFT
+    add     rsi, qword [gc_cards]
+    add     rdx, qword [gc_cards]
+.next_card:
+    cmp     byte [rsi], 0
+    jne     .scan
+    inc     rsi
+    cmp     rsi, rdx
+    jbe     .next_card
+    jmp     .next_object
+
+.scan:
+    mov     rdi, r14
+    xor     rsi, rsi
+    mov     rdx, -1
+    call    gc_scan_object
+    jmp     .next_object
+
+.done:
+    pop     r14                        ; restore register
+    pop     r13                        ; restore register
+    pop     r12                        ; restore register
+    pop     rbx                        ; restore register
+    pop     rbp                        ; restore return address
+    ret
+
+;
+;
+; gc_scan_cards
+;
+;   Forwards the references in the dirty cards of a region of the old space.
+;
+;   INPUT:
+;       rdi points to the start of the region
+;       rsi points to the end of the region
+;   STACK: empty
+;   OUTPUT: nothing
+;
+gc_scan_cards:
+    push    rbp                        ; save return address
+    mov     rbp, rsp                   ; set up stack frame
+    push    rbx                        ; save register
+    push    r12                        ; save register
+    push    r13                        ; save register
+    push    r14                        ; save register
+    push    r15                        ; save register
+    sub     rsp, 8                     ; keep the stack aligned
+
+    mov     rbx, rdi                   ; current card
+    mov     r12, rsi                   ; end of the region
+    mov     r13, rdi
+    sub     r13, qword [gc_old_base]
+    shr     r13, GC_CARD_SHIFT
+    add     r13, qword [gc_cards]
+.next_card:
+    cmp     rbx, r12
+    jae     .done
+
+    ; skip 8 clean cards at once
+    lea     r14, [rbx + (8 shl GC_CARD_SHIFT)]
+    cmp     r14, r12
+    ja      .one_card
+    cmp     qword [r13], 0
+    jne     .one_card
+    mov     rbx, r14
+    add     r13, 8
+    jmp     .next_card
+
+.one_card:
+    lea     r14, [rbx + (1 shl GC_CARD_SHIFT)]
+    cmp     byte [r13], 0
+    je      .skip_card
+
+    cmp     r14, r12
+    jbe     .first_object
+    mov     r14, r12                   ; the last card is only partially used
+.first_object:
+    mov     rax, rbx
+    call    gc_find_start
+    mov     r15, rcx                   ; the object the card starts in
+.next_object:
+    cmp     r15, r14
+    jae     .skip_card
+    mov     rdi, r15
+    mov     rsi, rbx
+    mov     rdx, r14
+    call    gc_scan_object
+    mov     rdi, r15
+    call    gc_words
+    lea     r15, [r15 + 8*rax]
+    jmp     .next_object
+
+.skip_card:
+    mov     rbx, r14
+    inc     r13
+    jmp     .next_card
+
+.done:
+    add     rsp, 8
+    pop     r15                        ; restore register
+    pop     r14                        ; restore register
+    pop     r13                        ; restore register
+    pop     r12                        ; restore register
+    pop     rbx                        ; restore register
+    pop     rbp                        ; restore return address
+    ret
+
+;
+;
+; gc_scan_copied
+;
+;   Forwards the references of the objects copied to the old space. The
+;   objects copied while scanning are scanned as well.
+;
+;   INPUT: rdi points to the first copied object
+;   STACK: empty
+;   OUTPUT: nothing
+;
+gc_scan_copied:
+    push    rbp                        ; save return address
+    mov     rbp, rsp                   ; set up stack frame
+    push    rbx                        ; save register
+    push    r12                        ; save register
+
+    mov     rbx, rdi
+.next_object:
+    cmp     rbx, qword [gc_old_pos]
+    jae     .done
+    mov     rdi, rbx
+    xor     rsi, rsi
+    mov     rdx, -1
+    call    gc_scan_object
+    mov     rdi, rbx
+    call    gc_words
+    lea     rbx, [rbx + 8*rax]
+    jmp     .next_object
+
+.done:
+    pop     r12                        ; restore register
+    pop     rbx                        ; restore register
+    pop     rbp                        ; restore return address
+    ret
+
+;
+;
+; gc_scan_object
+;
+;   Forwards the references of an object that are inside a region. The
+;   fillers have none, the boxed values only have their raw val and a String
+;   only has its length.
+;
+;   INPUT:
+;       rdi points to the object
+;       rsi points to the start of the region
+;       rdx points to the end of the region
+;   STACK: empty
+;   OUTPUT: nothing
+;
+gc_scan_object:
+    push    rbp                        ; save return address
+    mov     rbp, rsp                   ; set up stack frame
+    push    rbx                        ; save register
+    push    r12                        ; save register
+
+    cmp     qword [rdi], GC_FILLER
+    je      .done
+    cmp     qword [rdi], GC_FILLER_WORD
+    je      .done
+
+    lea     rbx, [rdi + 24]            ; first attribute
+    mov     r12, qword [rdi + 8]
+    lea     r12, [rdi + 8*r12]         ; end of the object
+
+    mov     rax, qword [rdi + 16]      ; dispatch table
+    cmp     rax, qword [gc_string_class]
+    je      .string
+    cmp     qword [rdi + 8], 4         ; a boxed value has a single attribute
+    jne     .clamp
+
+    mov     rcx, gc_value_classes
+    mov     r8, gc_value_classes_count
+.next_class:
+    cmp     rax, qword [rcx]
+    je      .done
+    add     rcx, 8
+    dec     r8
+    jnz     .next_class
+    jmp     .clamp
+
+.string:
+    lea     r12, [rdi + 32]            ; the bytes follow the length
+
+.clamp:
+    cmp     rbx, rsi
+    jae     .clamp_end
+    mov     rbx, rsi
+.clamp_end:
+    cmp     r12, rdx
+    jbe     .next_attribute
+    mov     r12, rdx
+
+.next_attribute:
+    cmp     rbx, r12
+    jae     .done
+    mov     rdi, rbx
+    call    gc_forward
+    add     rbx, 8
+    jmp     .next_attribute
+
+.done:
+    pop     r12                        ; restore register
+    pop     rbx                        ; restore register
+    pop     rbp                        ; restore return address
+    ret
+
+;
+;
+; gc_settle_cards
+;
+;   Called after a collection scanned every dirty card of a region of the
+;   old space: the cards found pointing to pinned nursery objects stay dirty
+;   and the others are cleaned.
+;
+;   INPUT:
+;       rdi points to the start of the region
+;       rsi points to the end of the region
+;   STACK: empty
+;   OUTPUT: nothing
+;
+gc_settle_cards:
+    sub     rdi, qword [gc_old_base]
+    shr     rdi, GC_CARD_SHIFT
+    add     rdi, qword [gc_cards]
+    sub     rsi, qword [gc_old_base]
+    add     rsi, (1 shl GC_CARD_SHIFT) - 1
+    shr     rsi, GC_CARD_SHIFT
+    add     rsi, qword [gc_cards]
+
+    ; the cards after the end of the region are clean, so the cards are
+    ; settled 8 at a time: young becomes dirty and dirty clean
+    mov     rdx, 0x7f7f7f7f7f7f7f7f
+.next_qword:
+    cmp     rdi, rsi
+    jae     .done
+    mov     rax, qword [rdi]
+    test    rax, rax
+    jz      .skip_qword
+    shr     rax, 1
+    and     rax, rdx
+    mov     qword [rdi], rax
+.skip_qword:
+    add     rdi, 8
+    jmp     .next_qword
+
+.done:
+    ret
+
+;
+;
+; gc_reset_nursery
+;
+;   Fills the gaps between the pinned objects of the nursery and starts
+;   allocating in the first one.
+;
+;   INPUT: nothing
+;   STACK: empty
+;   OUTPUT: nothing
+;
+gc_reset_nursery:
+    push    rbp                        ; save return address
+    mov     rbp, rsp                   ; set up stack frame
+    push    rbx                        ; save register
+    push    r12                        ; save register
+
+    mov     rbx, qword [gc_nursery_start]
+.next_gap:
+    mov     rdi, rbx
+    mov     rsi, qword [gc_nursery_end]
+    call    gc_next_pin
+    mov     r12, rax                   ; end of the gap
+    mov     rdi, rbx
+    mov     rsi, r12
+    call    gc_fill
+
+    cmp     r12, qword [gc_nursery_end]
+    jae     .done
+    mov     rdi, r12
+    call    gc_words
+    lea     rbx, [r12 + 8*rax]
+    jmp     .next_gap
+
+.done:
+    mov     rdi, qword [gc_nursery_start]
+    mov     qword [heap_pos], rdi
+    mov     rsi, qword [gc_nursery_end]
+    call    gc_next_pin
+    mov     qword [heap_end], rax
+
+    pop     r12                        ; restore register
+    pop     rbx                        ; restore register
+    pop     rbp                        ; restore return address
+    ret
+
+;
+;
+; gc_release
+;
+;   Gives the pages between the pinned objects of a region back to the
+;   kernel.
+;
+;   INPUT:
+;       rdi points to the start of the region
+;       rsi points to the end of the region
+;   STACK: empty
+;   OUTPUT: nothing
+;
+gc_release:
+    push    rbp                        ; save return address
+    mov     rbp, rsp                   ; set up stack frame
+    push    rbx                        ; save register
+    push    r12                        ; save register
+    push    r13                        ; save register
+    push    r13                        ; keep the stack aligned
+
+    mov     rbx, rdi                   ; start of the gap
+    mov     r13, rsi
+.next_gap:
+    mov     rdi, rbx
+    mov     rsi, r13
+    call    gc_next_pin
+    mov     r12, rax                   ; end of the gap
+
+    ; only the pages that are entirely in the gap
+    lea     rdi, [rbx + 4095]
+    and     rdi, -4096
+    mov     rsi, r12
+    and     rsi, -4096
+    cmp     rsi, rdi
+    jbe     .skip_gap
+    sub     rsi, rdi
+    mov     rax, 28                    ; madvise
+    mov     rdx, 4                     ; MADV_DONTNEED
+    syscall
+
+.skip_gap:
+    cmp     r12, r13
+    jae     .done
+    mov     rdi, r12
+    call    gc_words
+    lea     rbx, [r12 + 8*rax]
+    jmp     .next_gap
+
+.done:
+    pop     r13                        ; restore register
+    pop     r13                        ; restore register
+    pop     r12                        ; restore register
+    pop     rbx                        ; restore register
+    pop     rbp                        ; restore return address
+    ret
+
+;
+;
+; gc_pin
+;
+;   If the word points inside an object of the space being collected, pins
+;   the object. The word itself is left alone.
+;
+;   INPUT: rdi points to the word
+;   STACK: empty
+;   OUTPUT: nothing
+;
+gc_pin:
+    mov     rax, qword [rdi]
+    cmp     rax, qword [gc_from_start]
+    jb      .done
+    cmp     rax, qword [gc_from_end]
+    jae     .done
+
+    call    gc_find_start
+    cmp     qword [rcx], GC_FILLER     ; nothing lives in a gap
+    je      .done
+    cmp     qword [rcx], GC_FILLER_WORD
+    je      .done
+
+    sub     rcx, qword [gc_nursery_start]
+    shr     rcx, 3
+    mov     rdx, qword [gc_pin_map]
+    bts     qword [rdx], rcx
+
+.done:
+    ret
+
+;
+;
+; gc_forward
+;
+;   If the reference points inside an object of the space being collected
+;   that is not pinned, copies the object to the old space (unless it was
+;   already copied) and updates the reference to point inside the copy. A
+;   reference of an old object that still points to the nursery marks its
+;   card.
+;
+;   INPUT: rdi points to the reference
+;   STACK: empty
+;   OUTPUT: nothing
+;
+gc_forward:
+    mov     rax, qword [rdi]
+    cmp     rax, qword [gc_from_start]
+    jb      .young
+    cmp     rax, qword [gc_from_end]
+    jb      .collected
+
+.young:
+    cmp     rax, qword [gc_nursery_start]
+    jb      .done
+    cmp     rax, qword [gc_nursery_end]
+    jae     .done
+    mov     rdx, rdi
+    sub     rdx, qword [gc_old_base]
+    jb      .done                      ; not an old object
+    cmp     rdi, qword [gc_space_end]
+    jae     .done
+    shr     rdx, GC_CARD_SHIFT
+    add     rdx, qword [gc_cards]
+    mov     byte [rdx], GC_CARD_YOUNG
+
+.done:
+    ret
+
+.collected:
+    push    rbp                        ; save return address
+    mov     rbp, rsp                   ; set up stack frame
+    push    rbx                        ; save register
+    push    r12                        ; save register
+
+    mov     rbx, rdi
+    call    gc_find_start
+    mov     r12, rcx                   ; r12 <- start of the object
+    cmp     qword [r12], GC_FORWARDED
+    je      .forwarded
+
+    mov     rdx, r12
+    sub     rdx, qword [gc_nursery_start]
+    shr     rdx, 3
+    mov     rcx, qword [gc_pin_map]
+    bt      qword [rcx], rdx
+    jc      .exit                      ; pinned objects stay where they are
+
+    ; copy the object to the old space
+    mov     rdi, qword [r12 + 8]
+    shl     rdi, 3                     ; size in bytes
+    call    gc_old_bump
+    mov     rdi, rax
+    mov     rsi, r12
+    mov     rcx, qword [r12 + 8]
+    rep movsq
+
+    ; leave a forwarding pointer behind
+    mov     qword [r12], GC_FORWARDED
+    mov     qword [r12 + 8], rax
+
+.forwarded:
+    mov     rax, qword [rbx]
+    sub     rax, r12                   ; keep the offset inside the object
+    add     rax, qword [r12 + 8]
+    mov     qword [rbx], rax
+
+.exit:
+    mov     rdi, rbx
+    pop     r12                        ; restore register
+    pop     rbx                        ; restore register
+    pop     rbp                        ; restore return address
+    jmp     .young
+
+;
+;
+; gc_find_start
+;
+;   Finds the object an address points inside of: the closest marked word
+;   of the start map at or before it.
+;
+;   INPUT: rax contains the address
+;   STACK: empty
+;   OUTPUT: rcx points to the start of the object
+;
+gc_find_start:
+    mov     rcx, rax
+    sub     rcx, qword [gc_nursery_start]
+    shr     rcx, 3                     ; bit of the address
+    mov     r8, rcx
+    shr     r8, 6                      ; its qword
+    mov     rdx, qword [gc_start_map]
+    mov     r9, qword [rdx + 8*r8]
+    mov     r10, 2
+    shl     r10, cl
+    dec     r10
+    and     r9, r10                    ; drop the bits after it
+.next_qword:
+    test    r9, r9
+    jnz     .found
+    dec     r8
+    mov     r9, qword [rdx + 8*r8]
+    jmp     .next_qword
+
+.found:
+    bsr     r9, r9
+    shl     r8, 6
+    add     r8, r9
+    lea     rcx, [8*r8]
+    add     rcx, qword [gc_nursery_start]
+    ret
+
+;
+;
+; gc_next_pin
+;
+;   Finds the first pinned object at or after an address.
+;
+;   INPUT:
+;       rdi contains the address
+;       rsi contains the end of the region to look in
+;   STACK: empty
+;   OUTPUT: rax points to the pinned object, or is rsi if there is none
+;
+gc_next_pin:
+    mov     r10, rdi
+    sub     r10, qword [gc_nursery_start]
+    shr     r10, 3                     ; first bit
+    mov     r8, rsi
+    sub     r8, qword [gc_nursery_start]
+    shr     r8, 3                      ; end bit
+    mov     rdx, qword [gc_pin_map]
+.next_qword:
+    cmp     r10, r8
+    jae     .none
+    mov     rax, r10
+    shr     rax, 6
+    mov     r9, qword [rdx + 8*rax]
+    mov     rcx, r10
+    and     rcx, 63
+    shr     r9, cl                     ; drop the bits before r10
+    test    r9, r9
+    jnz     .found
+    or      r10, 63                    ; go to the next qword
+    inc     r10
+    jmp     .next_qword
+
+.found:
+    bsf     r9, r9
+    add     r10, r9
+    cmp     r10, r8
+    jae     .none
+    lea     rax, [8*r10]
+    add     rax, qword [gc_nursery_start]
+    ret
+
+.none:
+    mov     rax, rsi
+    ret
+
+;
+;
+; gc_fill
+;
+;   Marks a gap with a filler object, so that walking the space skips it.
+;
+;   INPUT:
+;       rdi points to the start of the gap
+;       rsi points to the end of the gap
+;   STACK: empty
+;   OUTPUT: nothing
+;
+gc_fill:
+    cmp     rdi, rsi
+    jae     .done
+
+    mov     rax, rsi
+    sub     rax, rdi
+    shr     rax, 3                     ; words
+    cmp     rax, 1
+    jne     .gap
+    mov     qword [rdi], GC_FILLER_WORD
+    jmp     .mark
+
+.gap:
+    mov     qword [rdi], GC_FILLER
+    mov     qword [rdi + 8], rax
+
+.mark:
+    mov     rcx, rdi
+    sub     rcx, qword [gc_nursery_start]
+    shr     rcx, 3
+    mov     rax, qword [gc_start_map]
+    bts     qword [rax], rcx
+
+.done:
+    ret
+
+;
+;
+; gc_words
+;
+;   Returns the size of an object or filler.
+;
+;   INPUT: rdi points to the object
+;   STACK: empty
+;   OUTPUT: rax contains the size in words
+;
+gc_words:
+    mov     rax, 1
+    cmp     qword [rdi], GC_FILLER_WORD
+    je      .done
+    mov     rax, qword [rdi + 8]
+
+.done:
+    ret
+
+;
+;
+; gc_clock_start
+;
+;   Starts measuring a pause when statistics are enabled.
+;
+;   INPUT: nothing
+;   STACK: empty
+;   OUTPUT: nothing
+;
+gc_clock_start:
+    cmp     qword [gc_stats], 0
+    je      .done
+
+    mov     rax, 228                   ; clock_gettime
+    mov     rdi, 1                     ; CLOCK_MONOTONIC
+    mov     rsi, gc_time_start
+    syscall
+
+.done:
+    ret
+
+;
+;
+; gc_report
+;
+;   Prints a line like "gc: minor #3 promoted 1024 bytes, pause 12 us" on
+;   stderr when statistics are enabled.
+;
+;   INPUT:
+;       rax contains the number of bytes
+;       rdi points to the kind message, rsi contains its length
+;       rdx contains the collection number
+;       rcx points to the bytes message, r8 contains its length
+;   STACK: empty
+;   OUTPUT: nothing
+;
+gc_report:
+    cmp     qword [gc_stats], 0
+    je      .skip
+
+    push    rbp                        ; save return address
+    mov     rbp, rsp                   ; set up stack frame
+    push    rbx                        ; save register
+    push    r12                        ; save register
+    push    r13                        ; save register
+    push    r14                        ; save register
+    push    r15                        ; save register
+    sub     rsp, 8                     ; keep the stack aligned
+
+    mov     rbx, rax                   ; bytes
+    mov     r12, rdx                   ; collection number
+    mov     r13, rcx
+    mov     r14, r8
+    push    rdi
+    push    rsi
+
+    mov     rax, 228                   ; clock_gettime
+    mov     rdi, 1                     ; CLOCK_MONOTONIC
+    mov     rsi, gc_time_end
+    syscall
+
+    ; r15 <- elapsed microseconds
+    mov     rax, qword [gc_time_end]
+    sub     rax, qword [gc_time_start]
+    imul    rax, rax, 1000000000
+    add     rax, qword [gc_time_end + 8]
+    sub     rax, qword [gc_time_start + 8]
+    xor     rdx, rdx
+    mov     rcx, 1000
+    div     rcx
+    mov     r15, rax
+
+    pop     rsi
+    pop     rdi
+    call    gc_write
+
+    mov     rax, r12
+    call    gc_write_number
+
+    mov     rdi, r13
+    mov     rsi, r14
+    call    gc_write
+
+    mov     rax, rbx
+    call    gc_write_number
+
+    mov     rdi, gc_pause_msg
+    mov     rsi, gc_pause_msg_len
+    call    gc_write
+
+    mov     rax, r15
+    call    gc_write_number
+
+    mov     rdi, gc_us_msg
+    mov     rsi, gc_us_msg_len
+    call    gc_write
+
+    add     rsp, 8
+    pop     r15                        ; restore register
+    pop     r14                        ; restore register
+    pop     r13                        ; restore register
+    pop     r12                        ; restore register
+    pop     rbx                        ; restore register
+    pop     rbp                        ; restore return address
+
+.skip:
+    ret
+
+;
+;
+; gc_write
+;
+;   Writes a buffer to stderr.
+;
+;   INPUT:
+;       rdi points to the buffer
+;       rsi contains the length of the buffer
+;   STACK: empty
+;   OUTPUT: nothing
+;
+gc_write:
+    mov     rdx, rsi
+    mov     rsi, rdi
+    mov     rdi, 2                     ; stderr
+    mov     rax, 1                     ; write
+    syscall
+    ret
+
+;
+;
+; gc_write_number
+;
+;   Writes an unsigned number to stderr.
+;
+;   INPUT: rax contains the number
+;   STACK: empty
+;   OUTPUT: nothing
+;
+gc_write_number:
+    mov     rdi, gc_digits + 24        ; digits are written backwards
+    mov     rcx, 10
+.next_digit:
+    xor     rdx, rdx
+    div     rcx
+    add     dl, 48
+    dec     rdi
+    mov     byte [rdi], dl
+    test    rax, rax
+    jnz     .next_digit
+
+    mov     rsi, gc_digits + 24
+    sub     rsi, rdi
+    jmp     gc_write
+
+;
+;
+; gc_out_of_memory
+;
+;   Aborts the program when the heap is exhausted.
+;
+;   INPUT: nothing
+;   STACK: empty
+;   OUTPUT: does not return
+;
+gc_out_of_memory:
+    mov     rdi, gc_oom_msg
+    mov     rsi, gc_oom_msg_len
+    call    gc_write
+
+    mov     rax, 60                    ; exit
+    mov     rdi, 1
+    syscall
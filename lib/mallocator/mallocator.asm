@@ -1,3 +1,10 @@
+section '.data' writeable
+
+; the compiler bumps heap_pos inline while it stays below heap_end; both are
+; zero here so that every object comes from malloc
+heap_pos dq 0
+heap_end dq 0
+
 section '.text' executable
 
 extrn malloc
@@ -34,3 +41,16 @@ allocate:
 
     pop     rbp                        ; restore return address
     ret
+
+;
+;
+; write_barrier
+;
+;   This allocator does not track stores, nothing to do.
+;
+;   INPUT: rdi contains the object that was written to
+;   STACK: empty
+;   OUTPUT: nothing
+;
+write_barrier:
+    ret
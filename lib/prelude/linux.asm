@@ -28,6 +28,8 @@ Ref.init_:
     add     rax, [slot_0]
     mov     rdi, qword [rbp - loc_0]
     mov     [rax], rdi
+    mov     rdi, rbx
+    call    write_barrier              ; remember the store
 
     ; return self
     mov     rax, rbx
@@ -84,23 +86,16 @@ Ref.addr:
     push    rbx                        ; save register
     mov     rbx, rax                   ; save self
 
-    ; t0 <- new Int
-    mov     rax, Int_protObj
-    call    Object.copy
-    call    Int_init
-    mov     qword [rbp - loc_0], rax
-
     ; t1 <- self.val
     mov     rax, rbx
     add     rax, [slot_0]
     mov     rax, [rax]
     mov     qword [rbp - loc_1], rax
 
-    ; t0.val <- t1
-    mov     rax, qword [rbp - loc_0]
-    add     rax, [slot_0]
+    ; t0 <- box_int(t1)
     mov     rdi, qword [rbp - loc_1]
-    mov     [rax], rdi
+    call    box_int
+    mov     qword [rbp - loc_0], rax
 
     ; return t0
     mov     rax, qword [rbp - loc_0]
@@ -210,12 +205,6 @@ Linux.read:
     push    rbx                        ; save register
     mov     rbx, rax                   ; save self
 
-    ; t0 <- new Int
-    mov     rax, Int_protObj
-    call    Object.copy
-    call    Int_init
-    mov     qword [rbp - loc_0], rax
-
     ; t1 <- arg2.val
     mov     rax, [rbp + arg_2]
     add     rax, [slot_0]
@@ -246,17 +235,18 @@ Linux.read:
     syscall
     mov     qword [rbp - loc_5], rax
 
-    ; t0.val <- t5
-    mov     rax, qword [rbp - loc_0]
-    add     rax, [slot_0]
+    ; t0 <- box_int(t5)
     mov     rdi, qword [rbp - loc_5]
-    mov     [rax], rdi
+    call    box_int
+    mov     qword [rbp - loc_0], rax
 
     ; t2.l <- t0
     mov     rax, qword [rbp - loc_2]
     add     rax, [slot_0]
     mov     rdi, qword [rbp - loc_0]
     mov     qword [rax], rdi
+    mov     rdi, qword [rbp - loc_2]
+    call    write_barrier              ; remember the store
 
     ; arg1.val <- t2 + slot_0
     mov     rax, [rbp + arg_1]
@@ -264,6 +254,8 @@ Linux.read:
     mov     rdi, qword [rbp - loc_2]
     add     rdi, [slot_0]
     mov     [rax], rdi
+    mov     rdi, [rbp + arg_1]
+    call    write_barrier              ; remember the store
 
     ; return t5
     mov     rax, qword [rbp - loc_5]
@@ -291,12 +283,6 @@ Linux.write:
     push    rbx                        ; save register
     mov     rbx, rax                   ; save self
 
-    ; t0 <- new Int
-    mov     rax, Int_protObj
-    call    Object.copy
-    call    Int_init
-    mov     qword [rbp - loc_0], rax
-
     ; t1 <- arg0.val
     mov     rax, [rbp + arg_0]
     add     rax, [slot_0]
@@ -322,11 +308,10 @@ Linux.write:
     syscall
     mov     qword [rbp - loc_4], rax
 
-    ; t0.val <- t4
-    mov     rax, qword [rbp - loc_0]
-    add     rax, [slot_0]
+    ; t0 <- box_int(t4)
     mov     rdi, qword [rbp - loc_4]
-    mov     [rax], rdi
+    call    box_int
+    mov     qword [rbp - loc_0], rax
 
     ; return t0
     mov     rax, qword [rbp - loc_0]
@@ -352,12 +337,6 @@ Linux.close:
     push    rbx                        ; save register
     mov     rbx, rax                   ; save self
 
-    ; t0 <- new Int
-    mov     rax, Int_protObj
-    call    Object.copy
-    call    Int_init
-    mov     qword [rbp - loc_0], rax
-
     ; t1 <- arg0.val
     mov     rax, [rbp + arg_0]
     add     rax, [slot_0]
@@ -370,11 +349,10 @@ Linux.close:
     syscall
     mov     qword [rbp - loc_2], rax
 
-    ; t0.val <- t2
-    mov     rax, qword [rbp - loc_0]
-    add     rax, [slot_0]
+    ; t0 <- box_int(t2)
     mov     rdi, qword [rbp - loc_2]
-    mov     [rax], rdi
+    call    box_int
+    mov     qword [rbp - loc_0], rax
 
     ; return t0
     mov     rax, qword [rbp - loc_0]
@@ -402,12 +380,6 @@ Linux.socket:
     push    rbx                        ; save register
     mov     rbx, rax                   ; save self
 
-    ; t0 <- new Int
-    mov     rax, Int_protObj
-    call    Object.copy
-    call    Int_init
-    mov     qword [rbp - loc_0], rax
-
     ; t1 <- arg0.val
     mov     rax, [rbp + arg_0]
     add     rax, [slot_0]
@@ -434,11 +406,10 @@ Linux.socket:
     syscall
     mov     qword [rbp - loc_4], rax
 
-    ; t0.val <- t4
-    mov     rax, qword [rbp - loc_0]
-    add     rax, [slot_0]
+    ; t0 <- box_int(t4)
     mov     rdi, qword [rbp - loc_4]
-    mov     [rax], rdi
+    call    box_int
+    mov     qword [rbp - loc_0], rax
 
     ; return t0
     mov     rax, qword [rbp - loc_0]
@@ -466,12 +437,6 @@ Linux.connect:
     push    rbx                        ; save register
     mov     rbx, rax                   ; save self
 
-    ; t0 <- new Int
-    mov     rax, Int_protObj
-    call    Object.copy
-    call    Int_init
-    mov     qword [rbp - loc_0], rax
-
     ; t1 <- arg0.val
     mov     rax, [rbp + arg_0]
     add     rax, [slot_0]
@@ -498,11 +463,10 @@ Linux.connect:
     syscall
     mov     qword [rbp - loc_4], rax
 
-    ; t0.val <- t4
-    mov     rax, qword [rbp - loc_0]
-    add     rax, [slot_0]
+    ; t0 <- box_int(t4)
     mov     rdi, qword [rbp - loc_4]
-    mov     [rax], rdi
+    call    box_int
+    mov     qword [rbp - loc_0], rax
 
     ; return t0
     mov     rax, qword [rbp - loc_0]
@@ -530,12 +494,6 @@ Linux.accept:
     push    rbx                        ; save register
     mov     rbx, rax                   ; save self
 
-    ; t0 <- new Int
-    mov     rax, Int_protObj
-    call    Object.copy
-    call    Int_init
-    mov     qword [rbp - loc_0], rax
-
     ; t1 <- arg0.val
     mov     rax, [rbp + arg_0]
     add     rax, [slot_0]
@@ -562,11 +520,10 @@ Linux.accept:
     syscall
     mov     qword [rbp - loc_4], rax
 
-    ; t0.val <- t4
-    mov     rax, qword [rbp - loc_0]
-    add     rax, [slot_0]
+    ; t0 <- box_int(t4)
     mov     rdi, qword [rbp - loc_4]
-    mov     [rax], rdi
+    call    box_int
+    mov     qword [rbp - loc_0], rax
 
     ; return t0
     mov     rax, qword [rbp - loc_0]
@@ -594,12 +551,6 @@ Linux.bind:
     push    rbx                        ; save register
     mov     rbx, rax                   ; save self
 
-    ; t0 <- new Int
-    mov     rax, Int_protObj
-    call    Object.copy
-    call    Int_init
-    mov     qword [rbp - loc_0], rax
-
     ; t1 <- arg0.val
     mov     rax, [rbp + arg_0]
     add     rax, [slot_0]
@@ -626,11 +577,10 @@ Linux.bind:
     syscall
     mov     qword [rbp - loc_4], rax
 
-    ; t0.val <- t4
-    mov     rax, qword [rbp - loc_0]
-    add     rax, [slot_0]
+    ; t0 <- box_int(t4)
     mov     rdi, qword [rbp - loc_4]
-    mov     [rax], rdi
+    call    box_int
+    mov     qword [rbp - loc_0], rax
 
     ; return t0
     mov     rax, qword [rbp - loc_0]
@@ -657,12 +607,6 @@ Linux.listen:
     push    rbx                        ; save register
     mov     rbx, rax                   ; save self
 
-    ; t0 <- new Int
-    mov     rax, Int_protObj
-    call    Object.copy
-    call    Int_init
-    mov     qword [rbp - loc_0], rax
-
     ; t1 <- arg0.val
     mov     rax, [rbp + arg_0]
     add     rax, [slot_0]
@@ -682,11 +626,10 @@ Linux.listen:
     syscall
     mov     qword [rbp - loc_3], rax
 
-    ; t0.val <- t3
-    mov     rax, qword [rbp - loc_0]
-    add     rax, [slot_0]
+    ; t0 <- box_int(t3)
     mov     rdi, qword [rbp - loc_3]
-    mov     [rax], rdi
+    call    box_int
+    mov     qword [rbp - loc_0], rax
 
     ; return t0
     mov     rax, qword [rbp - loc_0]
@@ -148,12 +148,6 @@ Object.equals:
     push    rbx                        ; save register
     mov     rbx, rax                   ; save self
 
-    ; t0 <- new Bool
-    mov     rax, Bool_protObj
-    call    Object.copy
-    call    Bool_init
-    mov     qword [rbp - loc_0], rax
-
     ; cmp address of self == address of x
     mov     rdi, rbx
     mov     rsi, [rbp + arg_0]
@@ -162,11 +156,10 @@ Object.equals:
     movzx   rax, al
     mov     qword [rbp - loc_1], rax
 
-    ; t0.val <- t1
-    mov     rax, qword [rbp - loc_0]
-    add     rax, [slot_0]
+    ; t0 <- box_bool(t1)
     mov     rdi, qword [rbp - loc_1]
-    mov     [rax], rdi
+    call    box_bool
+    mov     qword [rbp - loc_0], rax
 
     mov     rax, qword [rbp - loc_0]
 
@@ -194,12 +187,6 @@ Byte.to_string:
     ; t3 <- 1
     mov     qword [rbp - loc_3], 1
 
-    ; t0 <- new Int
-    mov     rax, Int_protObj
-    call    Object.copy
-    call    Int_init
-    mov     qword [rbp - loc_0], rax
-
     ; t1 <- allocate_string(t3)
     mov     rdi, qword [rbp - loc_3]
     call    allocate_string
@@ -222,17 +209,18 @@ Byte.to_string:
     mov     rdi, qword [rbp - loc_4]
     mov     byte [rax], dil
 
-    ; t0.val <- t3
-    mov     rax, qword [rbp - loc_0]
-    add     rax, [slot_0]
+    ; t0 <- box_int(t3)
     mov     rdi, qword [rbp - loc_3]
-    mov     [rax], rdi
+    call    box_int
+    mov     qword [rbp - loc_0], rax
 
     ; t1.l <- t0
     mov     rax, qword [rbp - loc_1]
     add     rax, [slot_0]
     mov     rdi, qword [rbp - loc_0]
     mov     qword [rax], rdi
+    mov     rdi, qword [rbp - loc_1]
+    call    write_barrier              ; remember the store
 
     ; return t1
     mov     rax, qword [rbp - loc_1]
@@ -332,23 +320,16 @@ Byte.to_int:
     push    rbx                        ; save register
     mov     rbx, rax                   ; save self
 
-    ; t0 <- new Int
-    mov     rax, Int_protObj
-    call    Object.copy
-    call    Int_init
-    mov     qword [rbp - loc_0], rax
-
     ; t1 <- self.val
     mov     rax, rbx
     add     rax, [slot_0]
     mov     rax, [rax]
     mov     qword [rbp - loc_1], rax
 
-    ; t0.val <- t1
-    mov     rax, qword [rbp - loc_0]
-    add     rax, [slot_0]
+    ; t0 <- box_int(t1)
     mov     rdi, qword [rbp - loc_1]
-    mov     qword [rax], rdi
+    call    box_int
+    mov     qword [rbp - loc_0], rax
 
     ; return t0
     mov     rax, qword [rbp - loc_0]
@@ -411,23 +392,16 @@ Word.to_int:
     push    rbx                        ; save register
     mov     rbx, rax                   ; save self
 
-    ; t0 <- new Int
-    mov     rax, Int_protObj
-    call    Object.copy
-    call    Int_init
-    mov     qword [rbp - loc_0], rax
-
     ; t1 <- self.val
     mov     rax, rbx
     add     rax, [slot_0]
     mov     rax, [rax]
     mov     qword [rbp - loc_1], rax
 
-    ; t0.val <- t1
-    mov     rax, qword [rbp - loc_0]
-    add     rax, [slot_0]
+    ; t0 <- box_int(t1)
     mov     rdi, qword [rbp - loc_1]
-    mov     qword [rax], rdi
+    call    box_int
+    mov     qword [rbp - loc_0], rax
 
     ; return t0
     mov     rax, qword [rbp - loc_0]
@@ -490,23 +464,16 @@ DoubleWord.to_int:
     push    rbx                        ; save register
     mov     rbx, rax                   ; save self
 
-    ; t0 <- new Int
-    mov     rax, Int_protObj
-    call    Object.copy
-    call    Int_init
-    mov     qword [rbp - loc_0], rax
-
     ; t1 <- self.val
     mov     rax, rbx
     add     rax, [slot_0]
     mov     rax, [rax]
     mov     qword [rbp - loc_1], rax
 
-    ; t0.val <- t1
-    mov     rax, qword [rbp - loc_0]
-    add     rax, [slot_0]
+    ; t0 <- box_int(t1)
     mov     rdi, qword [rbp - loc_1]
-    mov     qword [rax], rdi
+    call    box_int
+    mov     qword [rbp - loc_0], rax
 
     ; return t0
     mov     rax, qword [rbp - loc_0]
@@ -576,12 +543,6 @@ Float.from_fraction:
     push    rbx                        ; save register
     mov     rbx, rax                   ; save self
 
-    ; t0 <- new Int
-    mov     rax, Int_protObj
-    call    Object.copy
-    call    Int_init
-    mov     qword [rbp - loc_0], rax
-
     ; t1 <- arg0.val
     mov     rax, [rbp + arg_0]
     add     rax, [slot_0]
@@ -631,12 +592,6 @@ Float.to_int:
     push    rbx                        ; save register
     mov     rbx, rax                   ; save self
 
-    ; t0 <- new Int
-    mov     rax, Int_protObj
-    call    Object.copy
-    call    Int_init
-    mov     qword [rbp - loc_0], rax
-
     ; t1 <- self.val
     mov     rax, rbx
     add     rax, [slot_0]
@@ -649,11 +604,10 @@ Float.to_int:
     movsxd   rax, eax
     mov      qword [rbp - loc_1], rax
 
-    ; t0.val <- t1
-    mov     rax, qword [rbp - loc_0]
-    add     rax, [slot_0]
+    ; t0 <- box_int(t1)
     mov     rdi, qword [rbp - loc_1]
-    mov     [rax], rdi
+    call    box_int
+    mov     qword [rbp - loc_0], rax
 
     ; return t0
     mov     rax, qword [rbp - loc_0]
@@ -949,12 +903,6 @@ Float.equals:
     push    rbx                        ; save register
     mov     rbx, rax                   ; save self
 
-    ; t0 <- new Bool
-    mov     rax, Bool_protObj
-    call    Object.copy
-    call    Bool_init
-    mov     qword [rbp - loc_0], rax
-
     ; t1 <- self.val
     mov     rax, rbx
     add     rax, [slot_0]
@@ -975,11 +923,10 @@ Float.equals:
     movzx   rax, al
     mov     qword [rbp - loc_3], rax
 
-    ; t0.val <- t3
-    mov     rax, qword [rbp - loc_0]
-    add     rax, [slot_0]
+    ; t0 <- box_bool(t3)
     mov     rdi, qword [rbp - loc_3]
-    mov     [rax], rdi
+    call    box_bool
+    mov     qword [rbp - loc_0], rax
 
     ; return t0
     mov     rax, qword [rbp - loc_0]
@@ -1007,12 +954,6 @@ String.concat:
     push    rbx                        ; save register
     mov     rbx, rax                   ; save self
 
-    ; t0 <- new Int
-    mov     rax, Int_protObj
-    call    Object.copy
-    call    Int_init
-    mov     qword [rbp - loc_0], rax
-
     ; t2 <- self.l.val
     mov     rax, rbx
     add     rax, [slot_0]
@@ -1056,17 +997,18 @@ String.concat:
     mov     rdx, qword [rbp - loc_3]
     call    memcpy
 
-    ; t0.val <- t4
-    mov     rax, qword [rbp - loc_0]
-    add     rax, [slot_0]
+    ; t0 <- box_int(t4)
     mov     rdi, qword [rbp - loc_4]
-    mov     [rax], rdi
+    call    box_int
+    mov     qword [rbp - loc_0], rax
 
     ; t1.l <- t0
     mov     rax, qword [rbp - loc_1]
     add     rax, [slot_0]
     mov     rdi, qword [rbp - loc_0]
     mov     [rax], rdi
+    mov     rdi, qword [rbp - loc_1]
+    call    write_barrier              ; remember the store
 
     ; return t1
     mov     rax, qword [rbp - loc_1]
@@ -1095,12 +1037,6 @@ String.substr:
     push    rbx                        ; save register
     mov     rbx, rax                   ; save self
 
-    ; t0 <- new Int
-    mov     rax, Int_protObj
-    call    Object.copy
-    call    Int_init
-    mov     qword [rbp - loc_0], rax
-
     ; t3 <- arg1.val
     mov     rax, [rbp + arg_1]
     add     rax, [slot_0]
@@ -1127,17 +1063,18 @@ String.substr:
     mov     rdx, qword [rbp - loc_3]
     call    memcpy
 
-    ; t0.val <- t3
-    mov     rax, qword [rbp - loc_0]
-    add     rax, [slot_0]
+    ; t0 <- box_int(t3)
     mov     rdi, qword [rbp - loc_3]
-    mov     [rax], rdi
+    call    box_int
+    mov     qword [rbp - loc_0], rax
 
     ; t1.l <- t0
     mov     rax, qword [rbp - loc_1]
     add     rax, [slot_0]
     mov     rdi, qword [rbp - loc_0]
     mov     [rax], rdi
+    mov     rdi, qword [rbp - loc_1]
+    call    write_barrier              ; remember the store
 
     ; return t1
     mov     rax, qword [rbp - loc_1]
@@ -1147,10 +1084,164 @@ String.substr:
     pop     rbp                        ; restore return address
     ret
 
+;
+;
+; String.equals
+;
+;   Compares two strings for equality.
+;
+;   INPUT: rax contains self
+;   STACK:
+;        x object
+;   OUTPUT: rax contains a boolean object
+;
+String.equals:
+    push    rbp                        ; save return address
+    mov     rbp, rsp                   ; set up stack frame
+    sub     rsp, 8                     ; allocate 1 local variables
+    push    rbx                        ; save register
+    mov     rbx, rax                   ; save self
+
+    ; rax <- string_equals(self, x)
+    mov     rdi, rbx
+    mov     rsi, [rbp + arg_0]
+    call    string_equals
+
+    ; t0 <- box_bool(rax)
+    mov     rdi, rax
+    call    box_bool
+    mov     qword [rbp - loc_0], rax
+
+    ; return t0
+    mov     rax, qword [rbp - loc_0]
+
+    pop     rbx                        ; restore register
+    add     rsp, 8                     ; deallocate local variables
+    pop     rbp                        ; restore return address
+    ret
+
+;
+;
+; string_equals
+;
+;   Compares the lengths of two strings and then their bytes. The compiler
+;   calls it directly for `=` on strings, so it only clobbers rdi, rsi and
+;   rdx and it does not allocate.
+;
+;   INPUT:
+;       rdi points to the first string object
+;       rsi points to the second object
+;   STACK: empty
+;   OUTPUT: rax contains 1 if the strings are equal and 0 otherwise
+;
+string_equals:
+    push    rbp                        ; save return address
+    mov     rbp, rsp                   ; set up stack frame
+    push    rcx                        ; save register
+
+    xor     rax, rax                   ; not equal
+    cmp     rdi, rsi                   ; same object
+    je      .equal
+    test    rdi, rdi                   ; void is only equal to itself
+    jz      .done
+    test    rsi, rsi
+    jz      .done
+
+    mov     rdx, [obj_tag]
+    mov     rcx, [rdi + rdx]
+    cmp     rcx, [rsi + rdx]           ; the other object is not a string
+    jne     .done
+
+    ; rcx <- length of the first string
+    mov     rdx, [slot_0]
+    mov     rcx, [rdi + rdx]
+    mov     rcx, [rcx + rdx]
+
+    ; compare with the length of the second string
+    mov     rdx, [rsi + rdx]
+    add     rdx, [slot_0]
+    cmp     rcx, [rdx]
+    jne     .done
+
+    ; compare the bytes
+    add     rdi, [slot_1]
+    add     rsi, [slot_1]
+    repe cmpsb
+    jne     .done
+
+.equal:
+    mov     rax, 1
+
+.done:
+    pop     rcx                        ; restore register
+    pop     rbp                        ; restore return address
+    ret
+
+;
+;
+; box_int
+;
+;   Returns the Int object for a value. The compiler keeps one object for
+;   each value from int_cache_min on in int_cache, so only the values outside
+;   of it allocate a new Int. No Int object is ever written to afterwards.
+;
+;   INPUT: rdi contains the value
+;   STACK: empty
+;   OUTPUT: rax contains an int object
+;
+box_int:
+    mov     rax, rdi
+    sub     rax, int_cache_min
+    cmp     rax, int_cache_size        ; the value is not cached
+    jae     .allocate
+
+    ; return int_cache + 32 * (rdi - int_cache_min)
+    shl     rax, 5
+    mov     rdi, int_cache
+    add     rax, rdi
+    ret
+
+.allocate:
+    push    rdi                        ; save the value
+
+    ; t0 <- new Int
+    mov     rax, Int_protObj
+    call    Object.copy
+    call    Int_init
+
+    ; t0.val <- value
+    pop     rdi                        ; restore the value
+    mov     rdx, [slot_0]
+    mov     [rax + rdx], rdi
+    ret
+
+;
+;
+; box_bool
+;
+;   Returns bool_true or bool_false, the only two Bool objects.
+;
+;   INPUT: rdi contains the value
+;   STACK: empty
+;   OUTPUT: rax contains a boolean object
+;
+box_bool:
+    mov     rax, bool_true
+    test    rdi, rdi
+    jnz     .done
+    mov     rax, bool_false
+
+.done:
+    ret
+
 ;
 ;
 ; allocate_string
 ;
+;   Allocates a string object with room for rdi bytes after the attributes.
+;   The header is set up before the object is visible, so that the heap
+;   always contains well formed objects.
+;
 ;   INPUT: rdi contains the size in bytes
 ;   STACK: empty
 ;   OUTPUT: rax points to the newly allocated string object
@@ -1166,35 +1257,43 @@ allocate_string:
     shr     rax, 3
     mov     qword [rbp - loc_1], rax
 
-    ; t0 <- new String
+    ; t2 <- size(String_protObj) + t1
     mov     rax, String_protObj
-    call    Object.copy
-    call    String_init
-    mov     qword [rbp - loc_0], rax
-
-    ; t2 <- size(t0) + t1
-    mov     rax, qword [rbp - loc_0]
     add     rax, [obj_size]
     mov     rax, [rax]
+    mov     qword [rbp - loc_3], rax
     add     rax, qword [rbp - loc_1]
     mov     qword [rbp - loc_2], rax
 
+    ; t0 <- allocate(t2 * 8)
+    mov     rdi, qword [rbp - loc_2]
+    shl     rdi, 3
+    call    allocate
+    mov     qword [rbp - loc_0], rax
+
+    ; memcpy(t0, String_protObj, size(String_protObj) * 8)
+    mov     rdi, qword [rbp - loc_0]
+    mov     rsi, String_protObj
+    mov     rdx, qword [rbp - loc_3]
+    shl     rdx, 3
+    call    memcpy
+
+    ; clear the bytes of the string
+    mov     rdi, qword [rbp - loc_0]
+    add     rdi, [slot_1]
+    mov     rcx, qword [rbp - loc_1]
+    xor     rax, rax
+    rep stosq
+
     ; size(t0) <- t2
     mov     rax, qword [rbp - loc_0]
     add     rax, [obj_size]
     mov     rdi, qword [rbp - loc_2]
     mov     [rax], rdi
 
-    ; t3 <- t0.copy()
+    ; return String_init(t0)
     mov     rax, qword [rbp - loc_0]
-    call    Object.copy
     call    String_init
-    mov     qword [rbp - loc_3], rax
-
-    ; should we free t0?
-
-    ; return t3
-    mov     rax, qword [rbp - loc_3]
 
     add     rsp, 32                    ; deallocate local variables
     pop     rbp                        ; restore return address
@@ -142,27 +142,7 @@ class String inherits Object {
             }
     };
 
-    equals(x: Object): Bool {
-        let s: String <- case self of me: String => me; esac,
-            other: String <- case x of me: String => me; esac,
-            i: Int <- 0,
-            l1: Int <- s.length(),
-            l2: Int <- other.length(),
-            eq: Bool <- true
-        in
-            {
-                while (i < l1).and(i < l2) loop
-                    {
-                        let b1: Byte <- new Byte.from_string(s.substr(i, 1)),
-                            b2: Byte <- new Byte.from_string(other.substr(i, 1))
-                        in eq <- eq.and(b1 = b2);
-                        i <- i + 1;
-                    }
-                pool;
-
-                if l1 = l2 then eq else false fi;
-            }
-    };
+    equals(x: Object): Bool extern;
 };
 
 class Bool inherits Object {
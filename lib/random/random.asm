@@ -23,17 +23,10 @@ Time.time:
     call    time
     mov     qword [rbp - loc_1], rax
 
-    ; t0 <- new Int
-    mov     rax, Int_protObj
-    call    Object.copy
-    call    Int_init
-    mov     qword [rbp - loc_0], rax
-
-    ; t0.val <- t1
-    mov     rax, qword [rbp - loc_0]
-    add     rax, [slot_0]
+    ; t0 <- box_int(t1)
     mov     rdi, qword [rbp - loc_1]
-    mov     [rax], rdi
+    call    box_int
+    mov     qword [rbp - loc_0], rax
 
     ; return t0
     mov     rax, qword [rbp - loc_0]
@@ -92,17 +85,10 @@ Random.random:
     call    random
     mov     qword [rbp - loc_1], rax
 
-    ; t0 <- new Int
-    mov     rax, Int_protObj
-    call    Object.copy
-    call    Int_init
-    mov     qword [rbp - loc_0], rax
-
-    ; t0.val <- t1
-    mov     rax, qword [rbp - loc_0]
-    add     rax, [slot_0]
+    ; t0 <- box_int(t1)
     mov     rdi, qword [rbp - loc_1]
-    mov     [rax], rdi
+    call    box_int
+    mov     qword [rbp - loc_0], rax
 
     ; return t0
     mov     rax, qword [rbp - loc_0]
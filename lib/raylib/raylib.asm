@@ -76,18 +76,11 @@ Raylib.windowShouldClose:
     call    WindowShouldClose
     mov     qword [rbp - loc_1], rax
 
-    ; t0 <- new Bool
-    mov     rax, Bool_protObj
-    call    Object.copy
-    call    Bool_init
+    ; t0 <- box_bool(t1), a C bool only sets al
+    movzx   rdi, byte [rbp - loc_1]
+    call    box_bool
     mov     qword [rbp - loc_0], rax
 
-    ; t0.val <- t1
-    mov     rax, qword [rbp - loc_0]
-    add     rax, [slot_0]
-    mov     rdi, qword [rbp - loc_1]
-    mov     [rax], rdi
-
     ; return t0
     mov     rax, qword [rbp - loc_0]
 
@@ -365,18 +358,11 @@ Raylib.isKeyPressed:
     call    IsKeyPressed
     mov     qword [rbp - loc_1], rax
 
-    ; t0 <- new Bool
-    mov     rax, Bool_protObj
-    call    Object.copy
-    call    Bool_init
+    ; t0 <- box_bool(t1), a C bool only sets al
+    movzx   rdi, byte [rbp - loc_1]
+    call    box_bool
     mov     qword [rbp - loc_0], rax
 
-    ; t0.val <- t1
-    mov     rax, qword [rbp - loc_0]
-    add     rax, [slot_0]
-    mov     rdi, qword [rbp - loc_1]
-    mov     [rax], rdi
-
     ; return t0
     mov     rax, qword [rbp - loc_0]
 
@@ -493,17 +479,10 @@ Raylib.getRandomValue:
     call    GetRandomValue
     mov     qword [rbp - loc_1], rax
 
-    ; t0 <- new Int
-    mov     rax, Int_protObj
-    call    Object.copy
-    call    Int_init
-    mov     qword [rbp - loc_0], rax
-
-    ; t0.val <- t1
-    mov     rax, qword [rbp - loc_0]
-    add     rax, [slot_0]
+    ; t0 <- box_int(t1)
     mov     rdi, qword [rbp - loc_1]
-    mov     [rax], rdi
+    call    box_int
+    mov     qword [rbp - loc_0], rax
 
     ; return t0
     mov     rax, qword [rbp - loc_0]
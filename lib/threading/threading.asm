@@ -17,12 +17,10 @@ pthread_thread:
     push    rbx                        ; save register
     mov     rbx, rax                   ; save self
 
-    ; PThread.run(thread)
+    ; PThread.run(thread), the first argument goes in rsi
     mov     rax, rdi
-    push    0
-    push    rax
+    mov     rsi, rdi
     call    PThread.run
-    add     rsp, 16
 
     pop     rbx                        ; restore register
     add     rsp, 8                     ; deallocate local variables
@@ -47,24 +45,22 @@ PThread.spawn:
     push    rbx                        ; save register
     mov     rbx, rax                   ; save self
 
-    ; t0 <- new Int
-    mov     rax, Int_protObj
-    call    Object.copy
-    call    Int_init
-    mov     qword [rbp - loc_0], rax
-
-    ; t1 <- *t0.val
-    mov     rax, [rbp - loc_0]
-    add     rax, [slot_0]
+    ; t1 <- &t2
+    lea     rax, [rbp - loc_2]
     mov     qword [rbp - loc_1], rax
 
-    ; t2 <- pthread_create(t1, 0, pthread_thread, arg_0)
+    ; pthread_create(t1, 0, pthread_thread, arg_0)
     mov     rdi, [rbp - loc_1]
     mov     rsi, 0
     mov     rdx, pthread_thread
     mov     rcx, [rbp + arg_0]
     call    pthread_create
 
+    ; t0 <- box_int(t2)
+    mov     rdi, qword [rbp - loc_2]
+    call    box_int
+    mov     qword [rbp - loc_0], rax
+
     ; return t0
     mov     rax, [rbp - loc_0]
 
@@ -16,7 +16,25 @@
 #define DISPTABLE_OFFSET 16
 #define ATTRIBUTE_OFFSET 24
 
-#define locals_count_16_aligned(count) ((count + 1) / 2 * 2)
+// The Ints from INT_CACHE_MIN to INT_CACHE_MAX are preallocated in
+// int_cache and boxing one hands out its object instead of a new one, the
+// same way there are only the two Bool objects bool_false and bool_true.
+// They are shared, so no Int or Bool object is written to once created.
+#define INT_CACHE_MIN -128
+#define INT_CACHE_MAX 1023
+
+// Objects of at most this many words are allocated inline by bumping
+// heap_pos, which every allocator module defines; X_new is only called when
+// the object does not fit before heap_end. Larger ones are always allocated
+// by X_new.
+#define ASM_INLINE_NEW_WORDS 16
+
+// The first arguments of a method come in registers and the rest on the
+// stack, pushed last to first and freed by the caller; self is in rax. The
+// externs take all of their arguments on the stack, so each one with
+// arguments gets a `.regs` shim that pushes them and calls it.
+static const char *argument_registers[TAC_REGISTER_ARGS] = {"rsi", "rdx",
+                                                            "r8", "r9"};
 
 enum asm_const_type {
     ASM_CONST_INT,
@@ -37,6 +55,15 @@ typedef struct asm_const_value {
         };
 } asm_const_value;
 
+// Methods get a frame on rbp, with rbx holding self. A leaf method that
+// keeps everything in registers needs neither: it saves rbx only when it
+// uses self and otherwise has no prologue at all.
+enum asm_frame {
+    ASM_FRAME_FULL,
+    ASM_FRAME_SELF,
+    ASM_FRAME_NONE,
+};
+
 typedef struct asm_const {
         const char *name;
         asm_const_value value;
@@ -53,6 +80,16 @@ typedef struct assembler_context {
 
         semantic_mapping_item *current_class;
         implementation_mapping_item *current_method;
+        enum asm_frame frame;   // the frame of the code being emitted
+        ds_dynamic_array saved; // const char *, callee saved registers in use
+        int num_slots;          // stack slots of the spilled locals
+        int num_locals;         // stack slots of the frame, with the padding
+        int inline_news;        // allocations emitted inline
+
+        ds_dynamic_array lines; // asm_line, written out at the end
+
+        assembler_options options;
+        tac_stats stats;
 } assembler_context;
 
 static int assembler_context_init(assembler_context *context,
@@ -71,8 +108,20 @@ static int assembler_context_init(assembler_context *context,
 
     context->mapping = mapping;
     context->result = 0;
+    context->stats = (tac_stats){
+        .dispatches = 0,
+        .devirtualized = 0,
+        .inlined = 0,
+        .redundant = 0,
+        .hoisted = 0,
+        .tail_calls = 0,
+        .stack_objects = 0,
+        .shared = 0};
+
+    context->inline_news = 0;
 
     ds_dynamic_array_init(&context->consts, sizeof(asm_const));
+    ds_dynamic_array_init(&context->lines, sizeof(asm_line));
 
 defer:
     if (result != 0 && filename != NULL && context->file != NULL) {
@@ -92,26 +141,44 @@ static void assembler_context_destroy(assembler_context *context) {
 
 static void assembler_emit_fmt(assembler_context *context, int align,
                                const char *comment, const char *format, ...) {
-    fprintf(context->file, "%*s", align, "");
-
     va_list args;
     va_start(args, format);
-    int size = vsnprintf(NULL, 0, format, args) + align;
-    int padding = COMMENT_START_COLUMN - size;
+    int size = vsnprintf(NULL, 0, format, args);
     va_end(args);
 
+    char *text = malloc(size + 1);
+
     va_start(args, format);
-    vfprintf(context->file, format, args);
+    vsnprintf(text, size + 1, format, args);
     va_end(args);
 
-    if (comment != NULL) {
-        if (padding < 0) {
-            padding = 1;
+    asm_line line = {.align = align, .text = text, .comment = comment};
+    assembler_line_parse(&line);
+    ds_dynamic_array_append(&context->lines, &line);
+}
+
+static void assembler_write_lines(assembler_context *context) {
+    for (size_t i = 0; i < context->lines.count; i++) {
+        asm_line *line = NULL;
+        ds_dynamic_array_get_ref(&context->lines, i, (void **)&line);
+
+        if (line->removed) {
+            continue;
+        }
+
+        fprintf(context->file, "%*s%s", line->align, "", line->text);
+
+        if (line->comment != NULL) {
+            int padding =
+                COMMENT_START_COLUMN - line->align - (int)strlen(line->text);
+            if (padding < 0) {
+                padding = 1;
+            }
+            fprintf(context->file, "%*s; %s", padding, "", line->comment);
         }
-        fprintf(context->file, "%*s; %s", padding, "", comment);
-    }
 
-    fprintf(context->file, "\n");
+        fprintf(context->file, "\n");
+    }
 }
 
 #define assembler_emit(context, format, ...)                                   \
@@ -233,6 +300,36 @@ static void print_tac_assign_bool(assembler_context *context, tac_assign_bool as
     assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "; %s <- bool %s", assign_bool.ident, assign_bool.value ? "true" : "false");
 }
 
+static void print_tac_box(assembler_context *context, tac_box box) {
+    assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "; %s <- box %s %s", box.ident, box.type, box.expr);
+}
+
+static void print_tac_jump_if_cond(assembler_context *context, tac_jump_if_cond jump) {
+    if (jump.rhs == NULL) {
+        assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "; bt %s %s %s", codegen_tac_cond_name(jump.cond), jump.lhs, jump.label);
+    } else {
+        assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "; bt %s %s %s %s", jump.lhs, codegen_tac_cond_name(jump.cond), jump.rhs, jump.label);
+    }
+}
+
+static void print_tac_jump_case(assembler_context *context, tac_jump_case jump) {
+    assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "; case %s else %s", jump.expr, jump.default_label);
+    for (size_t i = 0; i < jump.branches.count; i++) {
+        tac_case_branch *branch = NULL;
+        ds_dynamic_array_get_ref(&jump.branches, i, (void **)&branch);
+
+        assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, ";   %s => %s", branch->type, branch->label);
+    }
+}
+
+static void print_tac_attr_load(assembler_context *context, tac_attr attr) {
+    assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "; %s <- %s.%s", attr.ident, attr.object, attr.attribute);
+}
+
+static void print_tac_attr_store(assembler_context *context, tac_attr attr) {
+    assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "; %s.%s <- %s", attr.object, attr.attribute, attr.ident);
+}
+
 static void assembler_emit_tac_comment(assembler_context *context, tac_instr tac) {
     switch (tac.kind) {
     case TAC_LABEL:
@@ -281,6 +378,20 @@ static void assembler_emit_tac_comment(assembler_context *context, tac_instr tac
         return print_tac_assign_string(context, tac.assign_string);
     case TAC_ASSIGN_BOOL:
         return print_tac_assign_bool(context, tac.assign_bool);
+    case TAC_BOX:
+        return print_tac_box(context, tac.box);
+    case TAC_UNBOX:
+        return print_tac_assign_unary(context, tac.unbox, "unbox");
+    case TAC_JUMP_IF_COND:
+        return print_tac_jump_if_cond(context, tac.jump_if_cond);
+    case TAC_JUMP_CASE:
+        return print_tac_jump_case(context, tac.jump_case);
+    case TAC_ATTR_LOAD:
+        return print_tac_attr_load(context, tac.attr);
+    case TAC_ATTR_STORE:
+        return print_tac_attr_store(context, tac.attr);
+    case TAC_PHI:
+        return;
     }
 }
 
@@ -346,12 +457,21 @@ static void assembler_new_const(assembler_context *context,
         break;
     }
     case ASM_CONST_BOOL: {
-        prefix = "bool_const";
+        // there are only the two Bool objects
+        prefix = value.boolean ? "bool_true" : "bool_false";
         value.tag = context->bool_tag;
         break;
     }
     }
 
+    if (value.type == ASM_CONST_BOOL) {
+        asm_const constant = {.name = prefix, .value = value};
+        ds_dynamic_array_append(&context->consts, &constant);
+
+        ds_dynamic_array_get_ref(&context->consts, count, (void **)result);
+        return;
+    }
+
     size_t needed = snprintf(NULL, 0, "%s%d", prefix, count);
     char *name = malloc(needed + 1);
     if (name == NULL) {
@@ -424,6 +544,19 @@ static void assembler_emit_const(assembler_context *context, asm_const c) {
     }
 }
 
+static void assembler_emit_int_cache(assembler_context *context) {
+    assembler_emit(context, "int_cache_min = %d", INT_CACHE_MIN);
+    assembler_emit(context, "int_cache_size = %d",
+                   INT_CACHE_MAX - INT_CACHE_MIN + 1);
+    assembler_emit(context, "int_cache:");
+
+    for (int value = INT_CACHE_MIN; value <= INT_CACHE_MAX; value++) {
+        assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL,
+                           "dq %d, 4, Int_dispTab, %d", context->int_tag,
+                           value);
+    }
+}
+
 static void assembler_emit_consts(assembler_context *context) {
     assembler_emit(context, "section '.data'");
 
@@ -433,6 +566,8 @@ static void assembler_emit_consts(assembler_context *context) {
 
         assembler_emit_const(context, *c);
     }
+
+    assembler_emit_int_cache(context);
 }
 
 static void assembler_emit_class_name_table(assembler_context *context) {
@@ -467,6 +602,34 @@ static void assembler_emit_class_name_table(assembler_context *context) {
     }
 }
 
+// the constant a variable of TYPE starts with, any other type is null
+static const char *assembler_default_value(assembler_context *context,
+                                           const char *type) {
+    asm_const *constant = NULL;
+
+    if (strcmp(type, INT_TYPE) == 0) {
+        assembler_new_const(
+            context, (asm_const_value){.type = ASM_CONST_INT, .integer = 0},
+            &constant);
+    } else if (strcmp(type, STRING_TYPE) == 0) {
+        asm_const *int_const = NULL;
+        assembler_new_const(
+            context, (asm_const_value){.type = ASM_CONST_INT, .integer = 0},
+            &int_const);
+
+        assembler_new_const(context,
+                            (asm_const_value){.type = ASM_CONST_STR,
+                                              .str = {int_const->name, ""}},
+                            &constant);
+    } else if (strcmp(type, BOOL_TYPE) == 0) {
+        assembler_new_const(
+            context, (asm_const_value){.type = ASM_CONST_BOOL, .boolean = 0},
+            &constant);
+    }
+
+    return constant != NULL ? constant->name : "0";
+}
+
 static void assembler_emit_attribute_init(assembler_context *context,
                                           class_mapping_attribute *attr) {
     const attribute_node *node = attr->attribute;
@@ -491,7 +654,7 @@ static void assembler_emit_attribute_init(assembler_context *context,
             context,
             (asm_const_value){
                 .type = ASM_CONST_BOOL,
-                .boolean = strcmp(node->value.boolean.value, "true") ? 1 : 0},
+                .boolean = strcmp(node->value.boolean.value, "true") == 0},
             &bool_const);
 
         assembler_emit_fmt(context, ASM_INDENT_SIZE, comment, "dq %s",
@@ -530,6 +693,11 @@ static void assembler_emit_attribute_init(assembler_context *context,
         }
         break;
     }
+    case EXPR_NULL: {
+        assembler_emit_fmt(context, ASM_INDENT_SIZE, comment, "dq %s",
+                           assembler_default_value(context, node->type.value));
+        break;
+    }
     default:
         assembler_emit_fmt(context, ASM_INDENT_SIZE, comment, "dq %d", 0);
         break;
@@ -565,29 +733,39 @@ static void assembler_emit_object_prototypes(assembler_context *context) {
     }
 }
 
-// rax <- ident
-static void assembler_emit_load_variable(assembler_context *context,
-                                         tac_result *tac, char *ident) {
+static int assembler_is_unboxed(tac_result *tac, const char *ident) {
+    tac_local *local = codegen_tac_find_local(tac, ident);
+
+    return local != NULL && local->unboxed;
+}
+
+// reg <- ident
+static void assembler_emit_load_variable_into(assembler_context *context,
+                                              tac_result *tac, char *ident,
+                                              const char *reg) {
     if (strcmp(ident, "self") == 0) {
         const char *comment = comment_fmt("load self");
         assembler_emit_fmt(context, ASM_INDENT_SIZE, comment,
-                           "mov     rax, rbx");
+                           "mov     %s, rbx", reg);
         return;
     }
 
     if (tac != NULL) {
-        for (size_t i = 0; i < tac->locals.count; i++) {
-            char *local = NULL;
-            ds_dynamic_array_get_ref(&tac->locals, i, (void **)&local);
+        tac_local *local = codegen_tac_find_local(tac, ident);
+        if (local != NULL && local->reg != NULL) {
+            const char *comment = comment_fmt("load %s", ident);
+            assembler_emit_fmt(context, ASM_INDENT_SIZE, comment,
+                               "mov     %s, %s", reg, local->reg);
+            return;
+        }
 
-            if (strcmp(local, ident) == 0) {
-                int offset = i;
-                const char *comment = comment_fmt("load %s", ident);
-                assembler_emit_fmt(context, ASM_INDENT_SIZE, comment,
-                                   "mov     rax, qword [rbp-%d]",
-                                   LOCALS_OFFSET + WORD_SIZE * offset);
-                return;
-            }
+        if (local != NULL) {
+            int offset = local->slot;
+            const char *comment = comment_fmt("load %s", ident);
+            assembler_emit_fmt(context, ASM_INDENT_SIZE, comment,
+                               "mov     %s, qword [rbp-%d]", reg,
+                               LOCALS_OFFSET + WORD_SIZE * offset);
+            return;
         }
     }
 
@@ -600,10 +778,17 @@ static void assembler_emit_load_variable(assembler_context *context,
             ds_dynamic_array_get_ref(&node->formals, i, (void **)&formal);
 
             if (strcmp(formal->name.value, ident) == 0) {
-                int offset = i;
                 const char *comment = comment_fmt("load %s", ident);
+                if (i < TAC_REGISTER_ARGS) {
+                    assembler_emit_fmt(context, ASM_INDENT_SIZE, comment,
+                                       "mov     %s, %s", reg,
+                                       argument_registers[i]);
+                    return;
+                }
+
+                int offset = i - TAC_REGISTER_ARGS;
                 assembler_emit_fmt(context, ASM_INDENT_SIZE, comment,
-                                   "mov     rax, qword [rbp+%d]",
+                                   "mov     %s, qword [rbp+%d]", reg,
                                    ARGUMENTS_OFFSET + WORD_SIZE * offset);
                 return;
             }
@@ -619,31 +804,54 @@ static void assembler_emit_load_variable(assembler_context *context,
             int offset = i;
             const char *comment = comment_fmt("load %s", ident);
             assembler_emit_fmt(context, ASM_INDENT_SIZE, comment,
-                               "mov     rax, qword [rbx+%d]",
+                               "mov     %s, qword [rbx+%d]", reg,
                                ATTRIBUTE_OFFSET + WORD_SIZE * offset);
             return;
         }
     }
 
-    DS_PANIC("not implemented: rax <- %s", ident);
+    DS_PANIC("not implemented: %s <- %s", reg, ident);
+}
+
+// rax <- ident
+static void assembler_emit_load_variable(assembler_context *context,
+                                         tac_result *tac, char *ident) {
+    assembler_emit_load_variable_into(context, tac, ident, "rax");
+}
+
+// write_barrier(reg), tells the allocator that the object in reg changed;
+// only the gc module needs to know, the other allocators leave it out
+static void assembler_emit_write_barrier(assembler_context *context,
+                                         const char *reg) {
+    if (!context->options.write_barrier) {
+        return;
+    }
+
+    assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "mov     rdi, %s",
+                       reg);
+    assembler_emit_fmt(context, ASM_INDENT_SIZE, "write barrier",
+                       "call    write_barrier");
 }
 
 // ident <- rax
 static void assembler_emit_store_variable(assembler_context *context,
                                           tac_result *tac, const char *ident) {
     if (tac != NULL) {
-        for (size_t i = 0; i < tac->locals.count; i++) {
-            char *local = NULL;
-            ds_dynamic_array_get_ref(&tac->locals, i, (void **)&local);
+        tac_local *local = codegen_tac_find_local(tac, ident);
+        if (local != NULL && local->reg != NULL) {
+            const char *comment = comment_fmt("store %s", ident);
+            assembler_emit_fmt(context, ASM_INDENT_SIZE, comment,
+                               "mov     %s, rax", local->reg);
+            return;
+        }
 
-            if (strcmp(local, ident) == 0) {
-                int offset = i;
-                const char *comment = comment_fmt("store %s", ident);
-                assembler_emit_fmt(context, ASM_INDENT_SIZE, comment,
-                                   "mov     qword [rbp-%d], rax",
-                                   LOCALS_OFFSET + WORD_SIZE * offset);
-                return;
-            }
+        if (local != NULL) {
+            int offset = local->slot;
+            const char *comment = comment_fmt("store %s", ident);
+            assembler_emit_fmt(context, ASM_INDENT_SIZE, comment,
+                               "mov     qword [rbp-%d], rax",
+                               LOCALS_OFFSET + WORD_SIZE * offset);
+            return;
         }
     }
 
@@ -656,8 +864,15 @@ static void assembler_emit_store_variable(assembler_context *context,
             ds_dynamic_array_get_ref(&node->formals, i, (void **)&formal);
 
             if (strcmp(formal->name.value, ident) == 0) {
-                int offset = i;
                 const char *comment = comment_fmt("store %s", ident);
+                if (i < TAC_REGISTER_ARGS) {
+                    assembler_emit_fmt(context, ASM_INDENT_SIZE, comment,
+                                       "mov     %s, rax",
+                                       argument_registers[i]);
+                    return;
+                }
+
+                int offset = i - TAC_REGISTER_ARGS;
                 assembler_emit_fmt(context, ASM_INDENT_SIZE, comment,
                                    "mov     qword [rbp+%d], rax",
                                    ARGUMENTS_OFFSET + WORD_SIZE * offset);
@@ -677,6 +892,7 @@ static void assembler_emit_store_variable(assembler_context *context,
             assembler_emit_fmt(context, ASM_INDENT_SIZE, comment,
                                "mov     qword [rbx+%d], rax",
                                ATTRIBUTE_OFFSET + WORD_SIZE * offset);
+            assembler_emit_write_barrier(context, "rbx");
             return;
         }
     }
@@ -684,109 +900,165 @@ static void assembler_emit_store_variable(assembler_context *context,
     DS_PANIC("not implemented: %s <- rax", ident);
 }
 
-// rax <- ident.attr
-static void assembler_emit_get_attr(assembler_context *context, tac_result tac,
-                                    char *ident, char *type, char *attr) {
-    const char *comment = NULL;
+// the prototype already holds the value of a constant initializer, and of
+// a missing one; the constructor only has to run the other ones
+static int assembler_is_static_initializer(class_mapping_attribute *attr) {
+    switch (attr->attribute->value.kind) {
+    case EXPR_NULL:
+    case EXPR_INT:
+    case EXPR_BOOL:
+    case EXPR_STRING:
+    case EXPR_EXTERN:
+        return 1;
+    default:
+        return 0;
+    }
+}
 
-    semantic_mapping_item *item = NULL;
-    for (size_t i = 0; i < context->mapping->classes.count; i++) {
-        semantic_mapping_item *c = NULL;
-        ds_dynamic_array_get_ref(&context->mapping->classes, i, (void **)&c);
+// the initializers X_init runs: the ones of the attributes declared in X,
+// the inherited ones are left to the constructor of the parent
+static int assembler_has_initializer(assembler_context *context,
+                                     semantic_mapping_item *item, size_t j) {
+    class_mapping_attribute *attr = NULL;
+    ds_dynamic_array_get_ref(&item->attributes, j, (void **)&attr);
 
-        if (strcmp(c->class_name, type) == 0) {
-            item = c;
-            break;
-        }
+    if (item->parent != NULL && j < item->parent->attributes.count) {
+        return 0;
     }
 
-    if (item == NULL) {
-        DS_PANIC("unreachable");
+    if (attr->attribute->value.kind == EXPR_EXTERN) {
+        return 0;
     }
 
-    size_t attribute_slot = 0;
-    for (size_t i = 0; i < item->attributes.count; i++) {
-        class_mapping_attribute *attribute = NULL;
-        ds_dynamic_array_get_ref(&item->attributes, i, (void **)&attribute);
+    return !codegen_tac_pipeline_has(context->options.pipeline, "alloc") ||
+           !assembler_is_static_initializer(attr);
+}
 
-        if (strcmp(attribute->attribute_name, attr) == 0) {
-            attribute_slot = ATTRIBUTE_OFFSET + WORD_SIZE * i;
-            break;
+// whether X_init or the constructor of any parent runs an initializer
+static int assembler_has_initializers(assembler_context *context,
+                                      semantic_mapping_item *item) {
+    for (; item != NULL; item = item->parent) {
+        for (size_t j = 0; j < item->attributes.count; j++) {
+            if (assembler_has_initializer(context, item, j)) {
+                return 1;
+            }
         }
     }
 
-    if (attribute_slot == 0) {
-        DS_PANIC("unreachable");
-    }
-
-    assembler_emit_load_variable(context, &tac, ident);
-
-    comment = comment_fmt("get %s.%s", ident, attr);
-    assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "add     rax, %d",
-                       attribute_slot);
-    assembler_emit_fmt(context, ASM_INDENT_SIZE, comment,
-                       "mov     rax, qword [rax]");
+    return 0;
 }
 
-// ident.attr <- rax
-static void assembler_emit_set_attr(assembler_context *context, tac_result tac,
-                                    char *ident, char *type, char *attr) {
-    const char *comment = NULL;
-
-    semantic_mapping_item *item = NULL;
-    for (size_t i = 0; i < context->mapping->classes.count; i++) {
-        semantic_mapping_item *c = NULL;
-        ds_dynamic_array_get_ref(&context->mapping->classes, i,
-                                 (void **)&c);
-
-        if (strcmp(c->class_name, type) == 0) {
-            item = c;
-            break;
-        }
+// rax <- new TYPE
+static void assembler_emit_new_type(assembler_context *context, char *type) {
+    const char *comment = comment_fmt("new %s", type);
+    semantic_mapping_item *item =
+        codegen_tac_find_class(context->mapping, type);
+
+    if (!codegen_tac_pipeline_has(context->options.pipeline, "alloc") ||
+        item == NULL) {
+        assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL,
+                           "mov     rax, %s_protObj", type);
+        assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL,
+                           "call    Object.copy");
+        assembler_emit_fmt(context, ASM_INDENT_SIZE, comment,
+                           "call    %s_init", type);
+        return;
     }
 
-    if (item == NULL) {
-        DS_PANIC("unreachable");
+    size_t words = item->attributes.count + 3;
+    if (words > ASM_INLINE_NEW_WORDS) {
+        assembler_emit_fmt(context, ASM_INDENT_SIZE, comment,
+                           "call    %s_new", type);
+        return;
     }
 
-    size_t attribute_slot = 0;
-    for (size_t i = 0; i < item->attributes.count; i++) {
-        class_mapping_attribute *attribute = NULL;
-        ds_dynamic_array_get_ref(&item->attributes, i, (void **)&attribute);
+    int label = context->inline_news++;
 
-        if (strcmp(attribute->attribute_name, attr) == 0) {
-            attribute_slot = ATTRIBUTE_OFFSET + WORD_SIZE * i;
-            break;
-        }
-    }
+    // bump heap_pos when the object fits before heap_end
+    assembler_emit_fmt(context, ASM_INDENT_SIZE, comment,
+                       "mov     rax, qword [heap_pos]");
+    assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL,
+                       "lea     rdi, [rax+%zu]", words * WORD_SIZE);
+    assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL,
+                       "cmp     rdi, qword [heap_end]");
+    assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "ja      .new_%d",
+                       label);
+    assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL,
+                       "mov     qword [heap_pos], rdi");
 
-    if (attribute_slot == 0) {
-        DS_PANIC("unreachable");
+    // copy the prototype a word at a time
+    assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL,
+                       "mov     rdi, qword [%s_protObj]", type);
+    assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL,
+                       "mov     qword [rax], rdi");
+    for (size_t i = 1; i < words; i++) {
+        assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL,
+                           "mov     rdi, qword [%s_protObj+%zu]", type,
+                           i * WORD_SIZE);
+        assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL,
+                           "mov     qword [rax+%zu], rdi", i * WORD_SIZE);
     }
 
-    assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "mov     rdi, rax");
+    if (assembler_has_initializers(context, item)) {
+        assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "call    %s_init",
+                           type);
+    }
+    assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "jmp     .new_%d_done",
+                       label);
 
-    assembler_emit_load_variable(context, &tac, ident);
+    // the constructor calls the allocator
+    assembler_emit_fmt(context, 0, NULL, ".new_%d:", label);
+    assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "call    %s_new", type);
+    assembler_emit_fmt(context, 0, NULL, ".new_%d_done:", label);
+}
 
-    assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "xchg    rdi, rax");
+// rax <- new TYPE in the slots of the frame from the escape pass
+static void assembler_emit_stack_new(assembler_context *context,
+                                     tac_assign_new instr) {
+    const char *comment = comment_fmt("new %s on the stack", instr.type);
+    semantic_mapping_item *item =
+        codegen_tac_find_class(context->mapping, instr.type);
+    size_t words = item->attributes.count + 3;
 
-    comment = comment_fmt("set %s.%s", ident, attr);
-    assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "add     rdi, %d",
-                       attribute_slot);
+    // the object grows up from its lowest slot
     assembler_emit_fmt(context, ASM_INDENT_SIZE, comment,
-                       "mov     qword [rdi], rax");
+                       "lea     rax, [rbp-%zu]",
+                       (instr.slot + words) * WORD_SIZE);
+    for (size_t i = 0; i < words; i++) {
+        assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL,
+                           "mov     rdi, qword [%s_protObj+%zu]", instr.type,
+                           i * WORD_SIZE);
+        assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL,
+                           "mov     qword [rax+%zu], rdi", i * WORD_SIZE);
+    }
+
+    if (assembler_has_initializers(context, item)) {
+        assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "call    %s_init",
+                           instr.type);
+    }
 }
 
-// rax <- new TYPE
-static void assembler_emit_new_type(assembler_context *context, char *type) {
-    const char *comment = NULL;
+// restores the registers of the caller and frees the frame of the method
+static void assembler_emit_frame_exit(assembler_context *context) {
+    if (context->frame == ASM_FRAME_NONE) {
+        return;
+    }
 
-    assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL,
-                       "mov     rax, %s_protObj", type);
-    assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "call    Object.copy");
-    comment = comment_fmt("new %s", type);
-    assembler_emit_fmt(context, ASM_INDENT_SIZE, comment, "call    %s_init",
-                       type);
+    if (context->frame == ASM_FRAME_SELF) {
+        assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "pop     rbx");
+        return;
+    }
+
+    for (size_t j = 0; j < context->saved.count; j++) {
+        const char *reg = NULL;
+        ds_dynamic_array_get(&context->saved, context->saved.count - j - 1,
+                             &reg);
+        assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "pop     %s", reg);
+    }
+    assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "pop     rbx");
+    assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "add     rsp, %d",
+                       WORD_SIZE * context->num_locals);
+    assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "pop     rbp");
 }
 
 // TAC => ASM
@@ -808,35 +1080,72 @@ static void assembler_emit_tac_jump(assembler_context *context, tac_result tac,
 static void assembler_emit_tac_jump_if_true(assembler_context *context,
                                             tac_result tac,
                                             tac_jump_if_true jump) {
-    const char *comment;
-
-    assembler_emit_get_attr(context, tac, jump.expr, "Bool", "val");
+    assembler_emit_load_variable(context, &tac, jump.expr);
 
     assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "test    rax, rax");
     assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "jnz     .%s",
                        jump.label);
 }
 
-static void assembler_emit_tac_assign_isinstance(assembler_context *context,
-                                                 tac_result tac,
-                                                 tac_isinstance instr) {
-    const char *comment = NULL;
+static void assembler_emit_tac_jump_if_cond(assembler_context *context,
+                                            tac_result tac,
+                                            tac_jump_if_cond jump) {
+    if (jump.rhs == NULL) {
+        assembler_emit_load_variable(context, &tac, jump.lhs);
+        assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "test    rax, rax");
+    } else {
+        assembler_emit_load_variable_into(context, &tac, jump.lhs, "rdi");
+        assembler_emit_load_variable(context, &tac, jump.rhs);
+        assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "cmp     rdi, rax");
+    }
+
+    const char *op = NULL;
+    switch (jump.cond) {
+    case TAC_COND_LT:
+        op = "jl ";
+        break;
+    case TAC_COND_LE:
+        op = "jle";
+        break;
+    case TAC_COND_GE:
+        op = "jge";
+        break;
+    case TAC_COND_GT:
+        op = "jg ";
+        break;
+    case TAC_COND_EQ:
+        op = "je ";
+        break;
+    case TAC_COND_NE:
+        op = "jne";
+        break;
+    case TAC_COND_VOID:
+        op = "jz ";
+        break;
+    case TAC_COND_NOT_VOID:
+        op = "jnz";
+        break;
+    }
 
+    assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "%s     .%s", op,
+                       jump.label);
+}
+
+// the classes that conform to type have the tags start..end
+static void assembler_class_tag_range(assembler_context *context,
+                                      const char *type, size_t *start,
+                                      size_t *end) {
     size_t start_index = 0;
     for (size_t i = 0; i < context->mapping->classes.count; i++) {
         semantic_mapping_item *item = NULL;
         ds_dynamic_array_get_ref(&context->mapping->classes, i, (void **)&item);
 
-        if (strcmp(item->class_name, instr.type) == 0) {
+        if (strcmp(item->class_name, type) == 0) {
             start_index = i;
             break;
         }
     }
 
-    semantic_mapping_item *item = NULL;
-    ds_dynamic_array_get_ref(&context->mapping->classes, start_index, (void **)&item);
-
-    semantic_mapping_item *parent = item->parent;
     size_t end_index = start_index;
 
     for (size_t i = start_index + 1; i < context->mapping->classes.count; i++) {
@@ -845,7 +1154,7 @@ static void assembler_emit_tac_assign_isinstance(assembler_context *context,
 
         int found = 0;
         while (current != NULL) {
-            if (strcmp(current->class_name, instr.type) == 0) {
+            if (strcmp(current->class_name, type) == 0) {
                 found = 1;
                 break;
             }
@@ -860,9 +1169,18 @@ static void assembler_emit_tac_assign_isinstance(assembler_context *context,
         end_index = i;
     }
 
-    // t0 <- new Bool
-    assembler_emit_new_type(context, "Bool");
-    assembler_emit_store_variable(context, &tac, instr.ident);
+    *start = start_index;
+    *end = end_index;
+}
+
+static void assembler_emit_tac_assign_isinstance(assembler_context *context,
+                                                 tac_result tac,
+                                                 tac_isinstance instr) {
+    const char *comment = NULL;
+
+    size_t start_index = 0;
+    size_t end_index = 0;
+    assembler_class_tag_range(context, instr.type, &start_index, &end_index);
 
     // get tag of expr in rdi
     comment = comment_fmt("get tag(%s)", instr.expr);
@@ -881,143 +1199,378 @@ static void assembler_emit_tac_assign_isinstance(assembler_context *context,
     assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "setle   al");
     assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "movzx   rax, al");
 
-    // t0.val <- start_index <= tag && tag <= end_index
+    // t0 <- start_index <= tag && tag <= end_index
     assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "and     rax, rsi");
-    assembler_emit_set_attr(context, tac, instr.ident, "Bool", "val");
-}
-
-static void assembler_emit_tac_assign_cast(assembler_context *context,
-                                           tac_result tac,
-                                           tac_cast isinstance) {
-    // t0 <- expr; not needed
-    assembler_emit_load_variable(context, &tac, isinstance.expr);
-    assembler_emit_store_variable(context, &tac, isinstance.ident);
-}
-
-static void assembler_emit_tac_assign_value(assembler_context *context,
-                                            tac_result tac,
-                                            tac_assign_value instr) {
-    // t0 <- value
-    assembler_emit_load_variable(context, &tac, instr.expr);
     assembler_emit_store_variable(context, &tac, instr.ident);
 }
 
-static void assembler_emit_tac_dispatch_call(assembler_context *context,
-                                             tac_result tac,
-                                             tac_dispatch_call instr) {
-    if (instr.args.count % 2 == 1) {
-        assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "push    0");
+// tags lo..hi that go to the same label of a case jump
+typedef struct asm_case_range {
+        size_t lo;
+        size_t hi;
+        const char *label;
+} asm_case_range;
+
+// case jumps with at least this many ranges use a jump table if it has at
+// most CASE_TABLE_MAX_ENTRIES entries per range, smaller or sparser ones are
+// cheaper as a binary search
+#define CASE_TABLE_MIN_RANGES 4
+#define CASE_TABLE_MAX_ENTRIES 8
+
+// binary search for the tag in rax over the ranges lo..hi, which cover all
+// the tags that can reach this point; last is set when the code emitted here
+// is followed by the default label
+static void assembler_emit_case_search(assembler_context *context,
+                                       tac_jump_case jump,
+                                       ds_dynamic_array *ranges, size_t lo,
+                                       size_t hi, int last, size_t *labels) {
+    asm_case_range *first = NULL;
+    ds_dynamic_array_get_ref(ranges, lo, (void **)&first);
+
+    if (lo == hi) {
+        if (!last || strcmp(first->label, jump.default_label) != 0) {
+            assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "jmp     .%s",
+                               first->label);
+        }
+        return;
     }
 
-    for (size_t i = 0; i < instr.args.count; i++) {
-        char *arg = NULL;
-        ds_dynamic_array_get(&instr.args, instr.args.count - i - 1, &arg);
+    size_t mid = (lo + hi + 1) / 2;
+    asm_case_range *pivot = NULL;
+    ds_dynamic_array_get_ref(ranges, mid, (void **)&pivot);
 
-        assembler_emit_load_variable(context, &tac, arg);
+    assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "cmp     rax, %zu",
+                       pivot->lo);
 
-        const char *comment = comment_fmt("arg%d: %s", i, arg);
-        assembler_emit_fmt(context, ASM_INDENT_SIZE, comment, "push    rax");
+    if (lo == mid - 1) {
+        assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "jb      .%s",
+                           first->label);
+        assembler_emit_case_search(context, jump, ranges, mid, hi, last,
+                                   labels);
+        return;
     }
 
-    assembler_emit_load_variable(context, &tac, instr.expr);
-
-    if (instr.type == NULL) {
-        assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "mov     rdi, qword [rax+%d]", DISPTABLE_OFFSET);
+    size_t right = (*labels)++;
+    assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "jae     .%s_%zu",
+                       jump.default_label, right);
+    assembler_emit_case_search(context, jump, ranges, lo, mid - 1, 0, labels);
+    assembler_emit_fmt(context, 0, NULL, ".%s_%zu:", jump.default_label,
+                       right);
+    assembler_emit_case_search(context, jump, ranges, mid, hi, last, labels);
+}
 
+static void assembler_emit_tac_jump_case(assembler_context *context,
+                                         tac_result tac, tac_jump_case jump) {
+    size_t count = context->mapping->classes.count;
 
-        size_t method_index = 0;
+    // the first branch that the class conforms to wins
+    const char **targets = calloc(count, sizeof(char *));
+    for (size_t i = jump.branches.count; i > 0; i--) {
+        tac_case_branch *branch = NULL;
+        ds_dynamic_array_get_ref(&jump.branches, i - 1, (void **)&branch);
 
-        const char *expr_type = instr.expr_type;
-        if (strcmp(expr_type, "SELF_TYPE") == 0) {
-            expr_type = context->current_class->class_name;
+        size_t start = 0;
+        size_t end = 0;
+        assembler_class_tag_range(context, branch->type, &start, &end);
+        for (size_t tag = start; tag <= end; tag++) {
+            targets[tag] = branch->label;
         }
+    }
 
-        for (size_t i = 0; i < context->mapping->classes.count; i++) {
-            semantic_mapping_item *item = NULL;
-            ds_dynamic_array_get_ref(&context->mapping->classes, i, (void **)&item);
+    ds_dynamic_array ranges; // asm_case_range
+    ds_dynamic_array_init(&ranges, sizeof(asm_case_range));
+    for (size_t tag = 0; tag < count; tag++) {
+        const char *label =
+            targets[tag] != NULL ? targets[tag] : jump.default_label;
 
-            if (strcmp(item->class_name, expr_type) != 0) {
-                continue;
-            }
+        asm_case_range *last = NULL;
+        if (ranges.count > 0) {
+            ds_dynamic_array_get_ref(&ranges, ranges.count - 1,
+                                     (void **)&last);
+        }
+
+        if (last != NULL && strcmp(last->label, label) == 0) {
+            last->hi = tag;
+        } else {
+            asm_case_range range = {.lo = tag, .hi = tag, .label = label};
+            ds_dynamic_array_append(&ranges, &range);
+        }
+    }
 
-            for (size_t j = 0; j < item->methods.count; j++) {
-                implementation_mapping_item *method = NULL;
-                ds_dynamic_array_get_ref(&item->methods, j, (void **)&method);
+    size_t labels = 0;
+    assembler_emit_load_variable(context, &tac, jump.expr);
+    if (ranges.count == 1) {
+        // every class takes the same branch, but a case on void still has
+        // to fault on the tag; a compare is not dropped like a dead load
+        const char *comment = comment_fmt("touch tag(%s)", jump.expr);
+        assembler_emit_fmt(context, ASM_INDENT_SIZE, comment,
+                           "cmp     qword [rax + %d], 0", OBJTAG_OFFSET);
+        assembler_emit_case_search(context, jump, &ranges, 0, 0, 1, &labels);
+        ds_dynamic_array_free(&ranges);
+        free((void *)targets);
+        return;
+    }
 
-                if (strcmp(method->method_name, instr.method) == 0) {
-                    method_index = j;
-                    break;
-                }
-            }
+    // get tag of expr in rax
+    const char *comment = comment_fmt("get tag(%s)", jump.expr);
+    assembler_emit_fmt(context, ASM_INDENT_SIZE, comment,
+                       "mov     rax, qword [rax + %d]", OBJTAG_OFFSET);
+
+    // the tags that reach a branch, the ones outside go to the default
+    size_t lo = count;
+    size_t hi = 0;
+    for (size_t tag = 0; tag < count; tag++) {
+        if (targets[tag] != NULL) {
+            lo = tag < lo ? tag : lo;
+            hi = tag;
         }
+    }
 
-        size_t method_offset = method_index * WORD_SIZE;
-        assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "mov     rdi, qword [rdi+%d]", method_offset);
-        assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "call    rdi");
+    size_t span = hi - lo + 1;
+    if (ranges.count >= CASE_TABLE_MIN_RANGES &&
+        span <= CASE_TABLE_MAX_ENTRIES * ranges.count) {
+        if (lo > 0) {
+            assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL,
+                               "sub     rax, %zu", lo);
+        }
+        if (lo > 0 || hi < count - 1) {
+            assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL,
+                               "cmp     rax, %zu", span - 1);
+            assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL,
+                               "ja      .%s", jump.default_label);
+        }
+        assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL,
+                           "lea     rdi, [.%s_table]", jump.default_label);
+        assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL,
+                           "jmp     qword [rdi + rax * 8]");
+        assembler_emit_fmt(context, 0, NULL, "align 8");
+        assembler_emit_fmt(context, 0, NULL, ".%s_table:",
+                           jump.default_label);
+        for (size_t tag = lo; tag <= hi; tag++) {
+            assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "dq      .%s",
+                               targets[tag] != NULL ? targets[tag]
+                                                    : jump.default_label);
+        }
     } else {
-        assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "call    %s.%s", instr.type, instr.method);
+        assembler_emit_case_search(context, jump, &ranges, 0, ranges.count - 1,
+                                   1, &labels);
     }
 
-    assembler_emit_store_variable(context, &tac, instr.ident);
+    ds_dynamic_array_free(&ranges);
+    free((void *)targets);
+}
 
-    const char *comment = comment_fmt("free %d args", instr.args.count);
-    assembler_emit_fmt(context, ASM_INDENT_SIZE, comment, "add     rsp, %d",
-                       WORD_SIZE * instr.args.count);
+static void assembler_emit_tac_assign_cast(assembler_context *context,
+                                           tac_result tac,
+                                           tac_cast isinstance) {
+    // t0 <- expr; not needed
+    assembler_emit_load_variable(context, &tac, isinstance.expr);
+    assembler_emit_store_variable(context, &tac, isinstance.ident);
+}
+
+static void assembler_emit_tac_assign_value(assembler_context *context,
+                                            tac_result tac,
+                                            tac_assign_value instr) {
+    // t0 <- value
+    assembler_emit_load_variable(context, &tac, instr.expr);
+    assembler_emit_store_variable(context, &tac, instr.ident);
+}
+
+// rdi <- the method of the dynamic dispatch on the object in rax
+static void assembler_emit_method_address(assembler_context *context,
+                                          tac_dispatch_call instr) {
+    assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "mov     rdi, qword [rax+%d]", DISPTABLE_OFFSET);
 
-    if (instr.args.count % 2 == 1) {
-        assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "add     rsp, %d",
-                           WORD_SIZE);
+    size_t method_index = 0;
+
+    const char *expr_type = instr.expr_type;
+    if (strcmp(expr_type, "SELF_TYPE") == 0) {
+        expr_type = context->current_class->class_name;
     }
+
+    for (size_t i = 0; i < context->mapping->classes.count; i++) {
+        semantic_mapping_item *item = NULL;
+        ds_dynamic_array_get_ref(&context->mapping->classes, i, (void **)&item);
+
+        if (strcmp(item->class_name, expr_type) != 0) {
+            continue;
+        }
+
+        for (size_t j = 0; j < item->methods.count; j++) {
+            implementation_mapping_item *method = NULL;
+            ds_dynamic_array_get_ref(&item->methods, j, (void **)&method);
+
+            if (strcmp(method->method_name, instr.method) == 0) {
+                method_index = j;
+                break;
+            }
+        }
+    }
+
+    size_t method_offset = method_index * WORD_SIZE;
+    assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "mov     rdi, qword [rdi+%d]", method_offset);
 }
 
-static void assembler_emit_tac_assign_new(assembler_context *context,
-                                          tac_result tac,
-                                          tac_assign_new instr) {
-    // t0 <- new TYPE
-    assembler_emit_new_type(context, instr.type);
+// the label called for a method of the class, the shim of an extern that
+// takes arguments
+static const char *assembler_method_label(assembler_context *context,
+                                          const char *class_name,
+                                          const char *method_name) {
+    for (size_t i = 0; i < context->mapping->classes.count; i++) {
+        semantic_mapping_item *item = NULL;
+        ds_dynamic_array_get_ref(&context->mapping->classes, i, (void **)&item);
+
+        if (strcmp(item->class_name, class_name) != 0) {
+            continue;
+        }
+
+        for (size_t j = 0; j < item->methods.count; j++) {
+            implementation_mapping_item *method = NULL;
+            ds_dynamic_array_get_ref(&item->methods, j, (void **)&method);
+
+            if (strcmp(method->method_name, method_name) != 0) {
+                continue;
+            }
+
+            if (method->method->body.kind == EXPR_EXTERN &&
+                method->method->formals.count > 0) {
+                return comment_fmt("%s.%s.regs", method->from_class,
+                                   method_name);
+            }
+            break;
+        }
+    }
+
+    return comment_fmt("%s.%s", class_name, method_name);
+}
+
+// pushes the arguments that go on the stack and then loads the others into
+// their registers; returns the number of words pushed
+static size_t assembler_emit_arguments(assembler_context *context,
+                                       tac_result tac, tac_dispatch_call instr,
+                                       int pad) {
+    size_t count = instr.args.count;
+    size_t stack = count > TAC_REGISTER_ARGS ? count - TAC_REGISTER_ARGS : 0;
+    size_t pushed = stack;
+
+    if (pad && stack % 2 == 1) {
+        assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "push    0");
+        pushed++;
+    }
+
+    for (size_t i = count; i > TAC_REGISTER_ARGS; i--) {
+        char *arg = NULL;
+        ds_dynamic_array_get(&instr.args, i - 1, &arg);
+
+        assembler_emit_load_variable(context, &tac, arg);
+
+        const char *comment = comment_fmt("arg%d: %s", i - 1, arg);
+        assembler_emit_fmt(context, ASM_INDENT_SIZE, comment, "push    rax");
+    }
+
+    for (size_t i = 0; i < count && i < TAC_REGISTER_ARGS; i++) {
+        char *arg = NULL;
+        ds_dynamic_array_get(&instr.args, i, &arg);
+
+        assembler_emit_load_variable_into(context, &tac, arg,
+                                          argument_registers[i]);
+    }
+
+    return pushed;
+}
+
+// the stack arguments go over the ones of the method, which the caller
+// frees
+static void assembler_emit_tac_tail_call(assembler_context *context,
+                                         tac_result tac,
+                                         tac_dispatch_call instr) {
+    size_t stack = assembler_emit_arguments(context, tac, instr, 0);
+
+    // the receiver can be one of the formals that get overwritten
+    assembler_emit_load_variable(context, &tac, instr.expr);
+    if (instr.type == NULL) {
+        assembler_emit_method_address(context, instr);
+    }
+
+    for (size_t i = 0; i < stack; i++) {
+        assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL,
+                           "pop     qword [rbp+%d]",
+                           ARGUMENTS_OFFSET + WORD_SIZE * i);
+    }
+
+    assembler_emit_frame_exit(context);
+
+    if (instr.type == NULL) {
+        assembler_emit_fmt(context, ASM_INDENT_SIZE, "tail call",
+                           "jmp     rdi");
+    } else {
+        assembler_emit_fmt(
+            context, ASM_INDENT_SIZE, "tail call", "jmp     %s",
+            assembler_method_label(context, instr.type, instr.method));
+    }
+}
+
+static void assembler_emit_tac_dispatch_call(assembler_context *context,
+                                             tac_result tac,
+                                             tac_dispatch_call instr) {
+    if (instr.tail) {
+        return assembler_emit_tac_tail_call(context, tac, instr);
+    }
+
+    size_t pushed = assembler_emit_arguments(context, tac, instr, 1);
+
+    assembler_emit_load_variable(context, &tac, instr.expr);
+
+    if (instr.type == NULL) {
+        assembler_emit_method_address(context, instr);
+        assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "call    rdi");
+    } else {
+        assembler_emit_fmt(
+            context, ASM_INDENT_SIZE, NULL, "call    %s",
+            assembler_method_label(context, instr.type, instr.method));
+    }
+
     assembler_emit_store_variable(context, &tac, instr.ident);
+
+    if (pushed > 0) {
+        const char *comment = comment_fmt("free %d args", pushed);
+        assembler_emit_fmt(context, ASM_INDENT_SIZE, comment,
+                           "add     rsp, %d", WORD_SIZE * pushed);
+    }
 }
 
 static void assembler_emit_tac_assign_default(assembler_context *context,
                                               tac_result tac,
                                               tac_assign_new instr) {
     // t0 <- default TYPE
-    if (strcmp(instr.type, "Int") == 0) {
-        asm_const *int_const = NULL;
-        assembler_new_const(
-            context, (asm_const_value){.type = ASM_CONST_INT, .integer = 0},
-            &int_const);
-
+    if (assembler_is_unboxed(&tac, instr.ident)) {
         const char *comment = comment_fmt("default %s", instr.type);
-        assembler_emit_fmt(context, ASM_INDENT_SIZE, comment, "mov     rax, %s",
-                           int_const->name);
-    } else if (strcmp(instr.type, "String") == 0) {
-        asm_const *int_const = NULL;
-        assembler_new_const(
-            context, (asm_const_value){.type = ASM_CONST_INT, .integer = 0},
-            &int_const);
-
-        asm_const *str_const = NULL;
-        assembler_new_const(context,
-                            (asm_const_value){.type = ASM_CONST_STR,
-                                              .str = {int_const->name, ""}},
-                            &str_const);
-
+        assembler_emit_fmt(context, ASM_INDENT_SIZE, comment, "mov     rax, 0");
+    } else {
         const char *comment = comment_fmt("default %s", instr.type);
         assembler_emit_fmt(context, ASM_INDENT_SIZE, comment, "mov     rax, %s",
-                           str_const->name);
-    } else if (strcmp(instr.type, "Bool") == 0) {
-        asm_const *bool_const = NULL;
-        assembler_new_const(
-            context, (asm_const_value){.type = ASM_CONST_BOOL, .boolean = 0},
-            &bool_const);
+                           assembler_default_value(context, instr.type));
+    }
+    assembler_emit_store_variable(context, &tac, instr.ident);
+}
 
-        const char *comment = comment_fmt("default %s", instr.type);
-        assembler_emit_fmt(context, ASM_INDENT_SIZE, comment, "mov     rax, %s",
-                           bool_const->name);
+static void assembler_emit_tac_assign_new(assembler_context *context,
+                                          tac_result tac,
+                                          tac_assign_new instr) {
+    // a new Int, Bool or String is the shared default one
+    if (codegen_tac_is_basic_class(instr.type)) {
+        return assembler_emit_tac_assign_default(context, tac, instr);
+    }
+
+    if (instr.shared) {
+        const char *comment = comment_fmt("shared %s", instr.type);
+        assembler_emit_fmt(context, ASM_INDENT_SIZE, comment,
+                           "mov     rax, %s_protObj", instr.type);
+    } else if (instr.stack) {
+        assembler_emit_stack_new(context, instr);
     } else {
-        // any other type is null
-        assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "mov     rax, 0");
+        // t0 <- new TYPE
+        assembler_emit_new_type(context, instr.type);
     }
     assembler_emit_store_variable(context, &tac, instr.ident);
 }
@@ -1025,10 +1578,6 @@ static void assembler_emit_tac_assign_default(assembler_context *context,
 static void assembler_emit_tac_assign_isvoid(assembler_context *context,
                                              tac_result tac,
                                              tac_assign_unary instr) {
-    // t0 <- new Bool
-    assembler_emit_new_type(context, "Bool");
-    assembler_emit_store_variable(context, &tac, instr.ident);
-
     // compare expr to 0
     assembler_emit_load_variable(context, &tac, instr.expr);
     assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "test    rax, rax");
@@ -1037,8 +1586,8 @@ static void assembler_emit_tac_assign_isvoid(assembler_context *context,
     assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "setz    al");
     assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "movzx   rax, al");
 
-    // set t0.val to rax
-    assembler_emit_set_attr(context, tac, instr.ident, "Bool", "val");
+    // set t0 to rax
+    assembler_emit_store_variable(context, &tac, instr.ident);
 }
 
 static void assembler_emit_tac_assign_add(assembler_context *context,
@@ -1046,22 +1595,18 @@ static void assembler_emit_tac_assign_add(assembler_context *context,
                                           tac_assign_binary instr) {
     const char *comment;
 
-    // t0 <- new Int
-    assembler_emit_new_type(context, "Int");
-    assembler_emit_store_variable(context, &tac, instr.ident);
-
     // set rdi to t1
-    assembler_emit_get_attr(context, tac, instr.lhs, "Int", "val");
-    assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "mov     rdi, rax");
+    assembler_emit_load_variable_into(context, &tac, instr.lhs, "rdi");
 
     // set rax to t2
-    assembler_emit_get_attr(context, tac, instr.rhs, "Int", "val");
+    assembler_emit_load_variable(context, &tac, instr.rhs);
 
     // set rax to t1 + t2
-    assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "add     rax, rdi");
+    comment = comment_fmt("%s + %s", instr.lhs, instr.rhs);
+    assembler_emit_fmt(context, ASM_INDENT_SIZE, comment, "add     rax, rdi");
 
-    // set t0.val to rax
-    assembler_emit_set_attr(context, tac, instr.ident, "Int", "val");
+    // set t0 to rax
+    assembler_emit_store_variable(context, &tac, instr.ident);
 }
 
 static void assembler_emit_tac_assign_sub(assembler_context *context,
@@ -1069,22 +1614,18 @@ static void assembler_emit_tac_assign_sub(assembler_context *context,
                                           tac_assign_binary instr) {
     const char *comment;
 
-    // t0 <- new Int
-    assembler_emit_new_type(context, "Int");
-    assembler_emit_store_variable(context, &tac, instr.ident);
+    // set rdi to t2
+    assembler_emit_load_variable_into(context, &tac, instr.rhs, "rdi");
 
-    // set rax to t2
-    assembler_emit_get_attr(context, tac, instr.rhs, "Int", "val");
-    assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "mov     rdi, rax");
-
-    // set rdi to t1
-    assembler_emit_get_attr(context, tac, instr.lhs, "Int", "val");
+    // set rax to t1
+    assembler_emit_load_variable(context, &tac, instr.lhs);
 
     // set rax to t1 - t2
-    assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "sub     rax, rdi");
+    comment = comment_fmt("%s - %s", instr.lhs, instr.rhs);
+    assembler_emit_fmt(context, ASM_INDENT_SIZE, comment, "sub     rax, rdi");
 
-    // set t0.val to rax
-    assembler_emit_set_attr(context, tac, instr.ident, "Int", "val");
+    // set t0 to rax
+    assembler_emit_store_variable(context, &tac, instr.ident);
 }
 
 static void assembler_emit_tac_assign_mul(assembler_context *context,
@@ -1092,22 +1633,18 @@ static void assembler_emit_tac_assign_mul(assembler_context *context,
                                           tac_assign_binary instr) {
     const char *comment;
 
-    // t0 <- new Int
-    assembler_emit_new_type(context, "Int");
-    assembler_emit_store_variable(context, &tac, instr.ident);
-
     // set rdi to t1
-    assembler_emit_get_attr(context, tac, instr.lhs, "Int", "val");
-    assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "mov     rdi, rax");
+    assembler_emit_load_variable_into(context, &tac, instr.lhs, "rdi");
 
     // set rax to t2
-    assembler_emit_get_attr(context, tac, instr.rhs, "Int", "val");
+    assembler_emit_load_variable(context, &tac, instr.rhs);
 
     // set rax to t1 * t2
-    assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "mul     rdi");
+    comment = comment_fmt("%s * %s", instr.lhs, instr.rhs);
+    assembler_emit_fmt(context, ASM_INDENT_SIZE, comment, "imul    rax, rdi");
 
-    // set t0.val to rax
-    assembler_emit_set_attr(context, tac, instr.ident, "Int", "val");
+    // set t0 to rax
+    assembler_emit_store_variable(context, &tac, instr.ident);
 }
 
 static void assembler_emit_tac_assign_div(assembler_context *context,
@@ -1115,38 +1652,30 @@ static void assembler_emit_tac_assign_div(assembler_context *context,
                                           tac_assign_binary instr) {
     const char *comment;
 
-    // t0 <- new Int
-    assembler_emit_new_type(context, "Int");
-    assembler_emit_store_variable(context, &tac, instr.ident);
-
-    // set rax to t2
-    assembler_emit_get_attr(context, tac, instr.rhs, "Int", "val");
-    assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "mov     rdi, rax");
+    // set rdi to t2
+    assembler_emit_load_variable_into(context, &tac, instr.rhs, "rdi");
 
     // set rax to t1
-    assembler_emit_get_attr(context, tac, instr.lhs, "Int", "val");
+    assembler_emit_load_variable(context, &tac, instr.lhs);
 
     // set rax to t1 / t2
+    comment = comment_fmt("%s / %s", instr.lhs, instr.rhs);
     assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "cqo");
-    assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "idiv    rdi");
+    assembler_emit_fmt(context, ASM_INDENT_SIZE, comment, "idiv    rdi");
 
-    // set t0.val to rax
-    assembler_emit_set_attr(context, tac, instr.ident, "Int", "val");
+    // set t0 to rax
+    assembler_emit_store_variable(context, &tac, instr.ident);
 }
 
 static void assembler_emit_tac_assign_neg(assembler_context *context,
                                           tac_result tac,
                                           tac_assign_unary instr) {
-    // t0 <- new Int
-    assembler_emit_new_type(context, "Int");
-    assembler_emit_store_variable(context, &tac, instr.ident);
-
-    // set rax to ~t0.val
-    assembler_emit_get_attr(context, tac, instr.expr, "Int", "val");
+    // set rax to -t1
+    assembler_emit_load_variable(context, &tac, instr.expr);
     assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "neg     rax");
 
-    // set t1 to rax
-    assembler_emit_set_attr(context, tac, instr.ident, "Bool", "val");
+    // set t0 to rax
+    assembler_emit_store_variable(context, &tac, instr.ident);
 }
 
 static void assembler_emit_tac_assign_lt(assembler_context *context,
@@ -1154,26 +1683,20 @@ static void assembler_emit_tac_assign_lt(assembler_context *context,
                                          tac_assign_binary instr) {
     const char *comment;
 
-    // t2 <- new Bool
-    assembler_emit_new_type(context, "Bool");
-    assembler_emit_store_variable(context, &tac, instr.ident);
-
-    // set rdi to t0
-    assembler_emit_get_attr(context, tac, instr.lhs, "Int", "val");
-    assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "mov     rdi, rax");
+    // set rdi to t1
+    assembler_emit_load_variable_into(context, &tac, instr.lhs, "rdi");
 
-    // set rax to t1
-    assembler_emit_get_attr(context, tac, instr.rhs, "Int", "val");
+    // set rax to t2
+    assembler_emit_load_variable(context, &tac, instr.rhs);
 
-    // set rax to t0 < t1
+    // set rax to t1 < t2
+    comment = comment_fmt("%s < %s", instr.lhs, instr.rhs);
     assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "cmp     rdi, rax");
     assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "setl    al");
-    assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "and     al, 1");
-    comment = comment_fmt("%s.val < %s.val", instr.lhs, instr.rhs);
     assembler_emit_fmt(context, ASM_INDENT_SIZE, comment, "movzx   rax, al");
 
-    // set t2.val to rax
-    assembler_emit_set_attr(context, tac, instr.ident, "Bool", "val");
+    // set t0 to rax
+    assembler_emit_store_variable(context, &tac, instr.ident);
 }
 
 static void assembler_emit_tac_assign_le(assembler_context *context,
@@ -1181,30 +1704,64 @@ static void assembler_emit_tac_assign_le(assembler_context *context,
                                          tac_assign_binary instr) {
     const char *comment;
 
-    // t2 <- new Bool
-    assembler_emit_new_type(context, "Bool");
+    // set rdi to t1
+    assembler_emit_load_variable_into(context, &tac, instr.lhs, "rdi");
+
+    // set rax to t2
+    assembler_emit_load_variable(context, &tac, instr.rhs);
+
+    // set rax to t1 <= t2
+    comment = comment_fmt("%s <= %s", instr.lhs, instr.rhs);
+    assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "cmp     rdi, rax");
+    assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "setle   al");
+    assembler_emit_fmt(context, ASM_INDENT_SIZE, comment, "movzx   rax, al");
+
+    // set t0 to rax
     assembler_emit_store_variable(context, &tac, instr.ident);
+}
 
-    // set rdi to t0
-    assembler_emit_get_attr(context, tac, instr.lhs, "Int", "val");
-    assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "mov     rdi, rax");
+static void assembler_emit_tac_assign_eq_inline(assembler_context *context,
+                                                tac_result tac,
+                                                tac_assign_eq instr) {
+    const char *comment = NULL;
+    enum tac_eq_kind kind = codegen_tac_eq_kind(instr.type);
+
+    if (kind == TAC_EQ_STRING) {
+        // set rax to string_equals(t1, t2)
+        assembler_emit_load_variable_into(context, &tac, instr.lhs, "rdi");
+        assembler_emit_load_variable_into(context, &tac, instr.rhs, "rsi");
+        assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL,
+                           "call    string_equals");
+        assembler_emit_store_variable(context, &tac, instr.ident);
+        return;
+    }
 
-    // set rax to t1
-    assembler_emit_get_attr(context, tac, instr.rhs, "Int", "val");
+    // set rdi to t1 and rax to t2, bytes are compared by value
+    assembler_emit_load_variable_into(context, &tac, instr.lhs, "rdi");
+    assembler_emit_load_variable(context, &tac, instr.rhs);
+    if (kind == TAC_EQ_BYTE) {
+        assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL,
+                           "mov     rdi, qword [rdi+%d]", ATTRIBUTE_OFFSET);
+        assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL,
+                           "mov     rax, qword [rax+%d]", ATTRIBUTE_OFFSET);
+    }
 
-    // set rax to t0 <= t1
+    // set rax to t1 = t2
+    comment = comment_fmt("%s = %s", instr.lhs, instr.rhs);
     assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "cmp     rdi, rax");
-    assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "setle   al");
-    assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "and     al, 1");
-    comment = comment_fmt("%s.val < %s.val", instr.lhs, instr.rhs);
+    assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "sete    al");
     assembler_emit_fmt(context, ASM_INDENT_SIZE, comment, "movzx   rax, al");
 
-    // set t2.val to rax
-    assembler_emit_set_attr(context, tac, instr.ident, "Bool", "val");
+    // set t0 to rax
+    assembler_emit_store_variable(context, &tac, instr.ident);
 }
 
 static void assembler_emit_tac_assign_eq(assembler_context *context,
                                          tac_result tac, tac_assign_eq instr) {
+    if (codegen_tac_eq_kind(instr.type) != TAC_EQ_DISPATCH) {
+        return assembler_emit_tac_assign_eq_inline(context, tac, instr);
+    }
+
     ds_dynamic_array args;
     ds_dynamic_array_init(&args, sizeof(char *));
 
@@ -1250,19 +1807,12 @@ static void assembler_emit_tac_assign_eq(assembler_context *context,
 static void assembler_emit_tac_assign_not(assembler_context *context,
                                           tac_result tac,
                                           tac_assign_unary instr) {
-    const char *comment;
-    int offset;
-
-    // t1 <- new Bool
-    assembler_emit_new_type(context, "Bool");
-    assembler_emit_store_variable(context, &tac, instr.ident);
-
-    // set rax to not t0.val
-    assembler_emit_get_attr(context, tac, instr.expr, "Bool", "val");
+    // set rax to not t1
+    assembler_emit_load_variable(context, &tac, instr.expr);
     assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "xor     rax, 1");
 
-    // set t1.val to rax
-    assembler_emit_set_attr(context, tac, instr.ident, "Bool", "val");
+    // set t0 to rax
+    assembler_emit_store_variable(context, &tac, instr.ident);
 }
 
 static void assembler_emit_tac_ident(assembler_context *context, tac_result tac,
@@ -1273,13 +1823,21 @@ static void assembler_emit_tac_ident(assembler_context *context, tac_result tac,
 static void assembler_emit_tac_assign_int(assembler_context *context,
                                           tac_result tac,
                                           tac_assign_int instr) {
+    const char *comment = comment_fmt("load %d", instr.value);
+
+    if (assembler_is_unboxed(&tac, instr.ident)) {
+        assembler_emit_fmt(context, ASM_INDENT_SIZE, comment,
+                           "mov     rax, %d", instr.value);
+        assembler_emit_store_variable(context, &tac, instr.ident);
+        return;
+    }
+
     asm_const *int_const = NULL;
     assembler_new_const(
         context,
         (asm_const_value){.type = ASM_CONST_INT, .integer = instr.value},
         &int_const);
 
-    const char *comment = comment_fmt("load %d", instr.value);
     assembler_emit_fmt(context, ASM_INDENT_SIZE, comment, "mov     rax, %s",
                        int_const->name);
     assembler_emit_store_variable(context, &tac, instr.ident);
@@ -1309,6 +1867,13 @@ static void assembler_emit_tac_assign_string(assembler_context *context,
 static void assembler_emit_tac_assign_bool(assembler_context *context,
                                            tac_result tac,
                                            tac_assign_bool instr) {
+    if (assembler_is_unboxed(&tac, instr.ident)) {
+        assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "mov     rax, %d",
+                           instr.value);
+        assembler_emit_store_variable(context, &tac, instr.ident);
+        return;
+    }
+
     asm_const *bool_const = NULL;
     assembler_new_const(
         context,
@@ -1320,6 +1885,88 @@ static void assembler_emit_tac_assign_bool(assembler_context *context,
     assembler_emit_store_variable(context, &tac, instr.ident);
 }
 
+static void assembler_emit_tac_box(assembler_context *context, tac_result tac,
+                                   tac_box instr) {
+    const char *comment = comment_fmt("box %s", instr.expr);
+
+    if (strcmp(instr.type, "Int") == 0) {
+        // t0 <- box_int(t1)
+        assembler_emit_load_variable_into(context, &tac, instr.expr, "rdi");
+        assembler_emit_fmt(context, ASM_INDENT_SIZE, comment, "call    box_int");
+    } else if (strcmp(instr.type, "Bool") == 0) {
+        // t0 <- bool_false + 32 * t1, bool_true comes right after it
+        assembler_emit_load_variable(context, &tac, instr.expr);
+        assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "shl     rax, 5");
+        assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL,
+                           "mov     rdi, bool_false");
+        assembler_emit_fmt(context, ASM_INDENT_SIZE, comment, "add     rax, rdi");
+    } else {
+        DS_PANIC("cannot box %s", instr.type);
+    }
+
+    assembler_emit_store_variable(context, &tac, instr.ident);
+}
+
+static void assembler_emit_tac_unbox(assembler_context *context,
+                                     tac_result tac, tac_assign_unary instr) {
+    const char *comment;
+
+    // t0 <- t1.val
+    assembler_emit_load_variable(context, &tac, instr.expr);
+    comment = comment_fmt("get %s.val", instr.expr);
+    assembler_emit_fmt(context, ASM_INDENT_SIZE, comment,
+                       "mov     rax, qword [rax+%d]", ATTRIBUTE_OFFSET);
+    assembler_emit_store_variable(context, &tac, instr.ident);
+}
+
+// offset of the attribute in the objects of class type
+static int assembler_attribute_offset(assembler_context *context,
+                                      const char *type,
+                                      const char *attribute) {
+    for (size_t i = 0; i < context->mapping->classes.count; i++) {
+        semantic_mapping_item *item = NULL;
+        ds_dynamic_array_get_ref(&context->mapping->classes, i, (void **)&item);
+
+        if (strcmp(item->class_name, type) != 0) {
+            continue;
+        }
+
+        for (size_t j = 0; j < item->attributes.count; j++) {
+            class_mapping_attribute *attr = NULL;
+            ds_dynamic_array_get_ref(&item->attributes, j, (void **)&attr);
+
+            if (strcmp(attr->attribute_name, attribute) == 0) {
+                return ATTRIBUTE_OFFSET + WORD_SIZE * j;
+            }
+        }
+    }
+
+    DS_PANIC("unknown attribute %s.%s", type, attribute);
+}
+
+static void assembler_emit_tac_attr_load(assembler_context *context,
+                                         tac_result tac, tac_attr instr) {
+    // t0 <- object.attribute
+    const char *comment = comment_fmt("get %s.%s", instr.object, instr.attribute);
+    int offset = assembler_attribute_offset(context, instr.type, instr.attribute);
+    assembler_emit_load_variable(context, &tac, instr.object);
+    assembler_emit_fmt(context, ASM_INDENT_SIZE, comment,
+                       "mov     rax, qword [rax+%d]", offset);
+    assembler_emit_store_variable(context, &tac, instr.ident);
+}
+
+static void assembler_emit_tac_attr_store(assembler_context *context,
+                                          tac_result tac, tac_attr instr) {
+    // object.attribute <- t0
+    const char *comment = comment_fmt("set %s.%s", instr.object, instr.attribute);
+    int offset = assembler_attribute_offset(context, instr.type, instr.attribute);
+    assembler_emit_load_variable_into(context, &tac, instr.object, "rsi");
+    assembler_emit_load_variable(context, &tac, instr.ident);
+    assembler_emit_fmt(context, ASM_INDENT_SIZE, comment,
+                       "mov     qword [rsi+%d], rax", offset);
+    assembler_emit_write_barrier(context, "rsi");
+}
+
 static void assembler_emit_tac(assembler_context *context, tac_result tac,
                                size_t instr_idx) {
     tac_instr *instr = NULL;
@@ -1385,91 +2032,371 @@ static void assembler_emit_tac(assembler_context *context, tac_result tac,
                                                 instr->assign_string);
     case TAC_ASSIGN_BOOL:
         return assembler_emit_tac_assign_bool(context, tac, instr->assign_bool);
-        break;
+    case TAC_BOX:
+        return assembler_emit_tac_box(context, tac, instr->box);
+    case TAC_UNBOX:
+        return assembler_emit_tac_unbox(context, tac, instr->unbox);
+    case TAC_JUMP_IF_COND:
+        return assembler_emit_tac_jump_if_cond(context, tac,
+                                               instr->jump_if_cond);
+    case TAC_JUMP_CASE:
+        return assembler_emit_tac_jump_case(context, tac, instr->jump_case);
+    case TAC_ATTR_LOAD:
+        return assembler_emit_tac_attr_load(context, tac, instr->attr);
+    case TAC_ATTR_STORE:
+        return assembler_emit_tac_attr_store(context, tac, instr->attr);
+    case TAC_PHI:
+        // the pass manager takes the TAC out of SSA before it gets here
+        DS_PANIC("phi %s not lowered", instr->phi.ident);
+    }
+}
+
+// the TAC of an expression of the current class and method, optimized
+static void assembler_expr_tac(assembler_context *context,
+                               const expr_node *expr, tac_result *tac) {
+    codegen_expr_to_tac(context->mapping, expr, tac);
+    tac_pass_context pass_context = {
+        .mapping = context->mapping,
+        .class_name = context->current_class->class_name,
+        .method_name = context->current_method != NULL
+                           ? context->current_method->method_name
+                           : NULL,
+        .stats = &context->stats};
+    codegen_tac_pipeline_run(context->options.pipeline, &pass_context, tac,
+                             NULL);
+}
+
+// makes room in the frame for the spilled locals and the callee saved
+// registers of the TAC
+static void assembler_frame_add(assembler_context *context, tac_result *tac) {
+    for (size_t r = 0; r < TAC_CALLEE_SAVED_COUNT; r++) {
+        int in_use = 0;
+        for (size_t j = 0; j < context->saved.count; j++) {
+            const char *reg = NULL;
+            ds_dynamic_array_get(&context->saved, j, &reg);
+            in_use |= reg == codegen_tac_callee_saved[r];
+        }
+
+        for (size_t i = 0; i < tac->locals.count && !in_use; i++) {
+            tac_local *local = NULL;
+            ds_dynamic_array_get_ref(&tac->locals, i, (void **)&local);
+
+            if (local->reg != NULL &&
+                strcmp(local->reg, codegen_tac_callee_saved[r]) == 0) {
+                ds_dynamic_array_append(&context->saved,
+                                        &codegen_tac_callee_saved[r]);
+                in_use = 1;
+            }
+        }
     }
-}
 
-static void assembler_emit_expr(assembler_context *context,
-                                const expr_node *expr) {
-    tac_result tac;
-    codegen_expr_to_tac(context->mapping, expr, &tac);
+    for (size_t i = 0; i < tac->locals.count; i++) {
+        tac_local *local = NULL;
+        ds_dynamic_array_get_ref(&tac->locals, i, (void **)&local);
 
-    assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "push    rbp");
-    assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "mov     rbp, rsp");
+        if (local->reg == NULL && local->slot + 1 > context->num_slots) {
+            context->num_slots = local->slot + 1;
+        }
+    }
 
-    int num_locals = locals_count_16_aligned(tac.locals.count) + 1;
+    // the objects allocated on the stack go after the spilled locals
+    for (size_t i = 0; i < tac->instrs.count; i++) {
+        tac_instr *instr = NULL;
+        ds_dynamic_array_get_ref(&tac->instrs, i, (void **)&instr);
 
-    const char *comment = comment_fmt("allocate %d locals", num_locals);
-    assembler_emit_fmt(context, ASM_INDENT_SIZE, comment, "sub     rsp, %d",
-                       WORD_SIZE * num_locals);
-    assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "push    rbx");
-    assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "mov     rbx, rax");
+        if (instr->kind != TAC_ASSIGN_NEW || !instr->assign_new.stack) {
+            continue;
+        }
 
-    for (size_t j = 0; j < tac.instrs.count; j++) {
-        assembler_emit_tac(context, tac, j);
+        semantic_mapping_item *item =
+            codegen_tac_find_class(context->mapping, instr->assign_new.type);
+        instr->assign_new.slot = context->num_slots;
+        context->num_slots += item->attributes.count + 3;
     }
-
-    assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "pop     rbx");
-    assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "add     rsp, %d",
-                       WORD_SIZE * num_locals);
-    assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "pop     rbp");
 }
 
-static void assembler_emit_object_init_attribute(assembler_context *context,
-                                                 size_t attr_idx) {
-    semantic_mapping_item *item = context->current_class;
+// the instructions that never call and only use the scratch registers
+static int assembler_is_leaf_instr(tac_result *tac, tac_instr *instr) {
+    // a write outside of the locals goes to an attribute, with a barrier
+    char **ident = codegen_tac_instr_def(instr);
+    if (ident != NULL && codegen_tac_local_index(tac, *ident) < 0) {
+        return 0;
+    }
 
-    class_mapping_attribute *attr = NULL;
-    ds_dynamic_array_get_ref(&item->attributes, attr_idx, (void **)&attr);
+    switch (instr->kind) {
+    case TAC_LABEL:
+    case TAC_JUMP:
+    case TAC_JUMP_IF_TRUE:
+    case TAC_JUMP_IF_COND:
+    case TAC_IDENT:
+    case TAC_CAST:
+    case TAC_ASSIGN_VALUE:
+    case TAC_ASSIGN_INT:
+    case TAC_ASSIGN_STRING:
+    case TAC_ASSIGN_BOOL:
+    case TAC_ASSIGN_DEFAULT:
+    case TAC_ASSIGN_ISINSTANCE:
+    case TAC_ASSIGN_ISVOID:
+    case TAC_ASSIGN_ADD:
+    case TAC_ASSIGN_SUB:
+    case TAC_ASSIGN_MUL:
+    case TAC_ASSIGN_DIV:
+    case TAC_ASSIGN_NEG:
+    case TAC_ASSIGN_LT:
+    case TAC_ASSIGN_LE:
+    case TAC_ASSIGN_NOT:
+    case TAC_UNBOX:
+    case TAC_ATTR_LOAD:
+        return 1;
+    case TAC_ASSIGN_EQ:
+        return codegen_tac_eq_kind(instr->assign_eq.type) == TAC_EQ_VALUE;
+    case TAC_ASSIGN_NEW:
+        return instr->assign_new.shared;
+    default:
+        return 0;
+    }
+}
 
-    if (attr->attribute->value.kind == EXPR_EXTERN) {
-        return;
+// self, or an attribute of it
+static int assembler_is_self_operand(assembler_context *context,
+                                     tac_result *tac, const char *name) {
+    if (codegen_tac_local_index(tac, name) >= 0) {
+        return 0;
     }
 
-    assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "mov     rax, rbx");
-    // NOTE: do I need to do an extra push here for 16 byte alignment?
-    assembler_emit_expr(context, &attr->attribute->value);
+    implementation_mapping_item *method = context->current_method;
+    if (method != NULL) {
+        method_node *node = (method_node *)method->method;
+        for (size_t i = 0; i < node->formals.count; i++) {
+            formal_node *formal = NULL;
+            ds_dynamic_array_get_ref(&node->formals, i, (void **)&formal);
 
-    const char *comment = comment_fmt("init %s", attr->attribute_name);
-    assembler_emit_store_variable(context, NULL, attr->attribute_name);
+            if (strcmp(formal->name.value, name) == 0) {
+                return 0;
+            }
+        }
+    }
+
+    return 1;
 }
 
-static void assembler_emit_object_init_attributes(assembler_context *context) {
-    semantic_mapping_item *item = context->current_class;
+// the frame a method needs, see enum asm_frame
+static enum asm_frame assembler_method_frame(assembler_context *context,
+                                             tac_result *tac) {
+    method_node *node = (method_node *)context->current_method->method;
+    if (context->num_slots > 0 || context->saved.count > 0 ||
+        node->formals.count > TAC_REGISTER_ARGS) {
+        return ASM_FRAME_FULL;
+    }
 
-    for (size_t j = 0; j < item->attributes.count; j++) {
-        assembler_emit_object_init_attribute(context, j);
+    enum asm_frame frame = ASM_FRAME_NONE;
+    for (size_t i = 0; i < tac->instrs.count; i++) {
+        tac_instr *instr = NULL;
+        ds_dynamic_array_get_ref(&tac->instrs, i, (void **)&instr);
+
+        if (!assembler_is_leaf_instr(tac, instr)) {
+            return ASM_FRAME_FULL;
+        }
+
+        ds_dynamic_array uses;
+        codegen_tac_instr_uses(instr, &uses);
+        for (size_t j = 0; j < uses.count; j++) {
+            char **operand = NULL;
+            ds_dynamic_array_get(&uses, j, &operand);
+
+            if (assembler_is_self_operand(context, tac, *operand)) {
+                frame = ASM_FRAME_SELF;
+            }
+        }
+        ds_dynamic_array_free(&uses);
     }
+
+    return frame;
 }
 
-static void assembler_emit_object_init(assembler_context *context,
-                                       size_t class_idx) {
-    semantic_mapping_item *itemp = NULL;
-    ds_dynamic_array_get_ref(&context->mapping->classes, class_idx, (void **)&itemp);
+static void assembler_frame_init(assembler_context *context) {
+    context->frame = ASM_FRAME_FULL;
+    ds_dynamic_array_init(&context->saved, sizeof(const char *));
+    context->num_slots = 0;
+    context->num_locals = 0;
+}
+
+// sets up the frame and rbx <- self from rax
+static void assembler_emit_frame_entry(assembler_context *context) {
+    if (context->frame == ASM_FRAME_NONE) {
+        return;
+    }
+
+    if (context->frame == ASM_FRAME_SELF) {
+        assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "push    rbx");
+        assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "mov     rbx, rax");
+        return;
+    }
 
-    assembler_emit_fmt(context, 0, NULL, "%s_init:", itemp->class_name);
     assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "push    rbp");
     assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "mov     rbp, rsp");
+
+    // rbx and the saved registers are pushed after the locals
+    int num_slots = context->num_slots;
+    context->num_locals = num_slots + (num_slots + 1 + context->saved.count) % 2;
+
+    const char *comment = comment_fmt("allocate %d locals", context->num_locals);
+    assembler_emit_fmt(context, ASM_INDENT_SIZE, comment, "sub     rsp, %d",
+                       WORD_SIZE * context->num_locals);
     assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "push    rbx");
+    for (size_t j = 0; j < context->saved.count; j++) {
+        const char *reg = NULL;
+        ds_dynamic_array_get(&context->saved, j, &reg);
+        assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "push    %s", reg);
+    }
     assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "mov     rbx, rax");
-    if (itemp->parent != NULL) {
-        assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "call    %s_init",
-                           itemp->parent->class_name);
+}
+
+static void assembler_emit_method_body(assembler_context *context,
+                                       const expr_node *expr) {
+    tac_result tac;
+    assembler_expr_tac(context, expr, &tac);
+
+    assembler_frame_init(context);
+    assembler_frame_add(context, &tac);
+    context->frame = assembler_method_frame(context, &tac);
+
+    assembler_emit_frame_entry(context);
+    for (size_t j = 0; j < tac.instrs.count; j++) {
+        assembler_emit_tac(context, tac, j);
     }
+    assembler_emit_frame_exit(context);
+
+    ds_dynamic_array_free(&context->saved);
+}
 
+static void assembler_emit_object_init(assembler_context *context,
+                                       size_t class_idx) {
     semantic_mapping_item *item = NULL;
     ds_dynamic_array_get_ref(&context->mapping->classes, class_idx, (void **)&item);
 
     context->current_class = item;
     context->current_method = NULL;
-    assembler_emit_object_init_attributes(context);
+
+    // the initializers share the frame of X_init, so it has room for all
+    ds_dynamic_array tacs; // tac_result, one for each attribute
+    ds_dynamic_array_init(&tacs, sizeof(tac_result));
+    assembler_frame_init(context);
+
+    for (size_t j = 0; j < item->attributes.count; j++) {
+        class_mapping_attribute *attr = NULL;
+        ds_dynamic_array_get_ref(&item->attributes, j, (void **)&attr);
+
+        tac_result tac = {0};
+        if (assembler_has_initializer(context, item, j)) {
+            assembler_expr_tac(context, &attr->attribute->value, &tac);
+            assembler_frame_add(context, &tac);
+        }
+        ds_dynamic_array_append(&tacs, &tac);
+    }
+
+    assembler_emit_fmt(context, 0, NULL, "%s_init:", item->class_name);
+
+    // with nothing to initialize this is the constructor of the parent
+    int initializers = 0;
+    for (size_t j = 0; j < item->attributes.count; j++) {
+        initializers += assembler_has_initializer(context, item, j);
+    }
+
+    if (initializers == 0) {
+        if (item->parent != NULL) {
+            assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "jmp     %s_init",
+                               item->parent->class_name);
+        } else {
+            assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "ret");
+        }
+    } else {
+        assembler_emit_frame_entry(context);
+        if (item->parent != NULL) {
+            assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "call    %s_init",
+                               item->parent->class_name);
+        }
+
+        for (size_t j = 0; j < item->attributes.count; j++) {
+            class_mapping_attribute *attr = NULL;
+            ds_dynamic_array_get_ref(&item->attributes, j, (void **)&attr);
+
+            if (!assembler_has_initializer(context, item, j)) {
+                continue;
+            }
+
+            // the labels of every initializer get their own scope
+            assembler_emit_fmt(context, 0, NULL, "%s_init.%s:", item->class_name,
+                               attr->attribute_name);
+
+            tac_result *tac = NULL;
+            ds_dynamic_array_get_ref(&tacs, j, (void **)&tac);
+            for (size_t k = 0; k < tac->instrs.count; k++) {
+                assembler_emit_tac(context, *tac, k);
+            }
+
+            assembler_emit_store_variable(context, NULL, attr->attribute_name);
+        }
+
+        assembler_emit_fmt(context, ASM_INDENT_SIZE, "restore self",
+                           "mov     rax, rbx");
+        assembler_emit_frame_exit(context);
+        assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "ret");
+    }
+
     context->current_class = NULL;
+    ds_dynamic_array_free(&context->saved);
+    ds_dynamic_array_free(&tacs);
+}
 
-    assembler_emit_fmt(context, ASM_INDENT_SIZE, "restore self",
-                       "mov     rax, rbx");
-    assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "pop     rbx");
-    assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "pop     rbp");
-    assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "ret");
+// X_new allocates an X, copies X_protObj into it and runs X_init, which is
+// left out when no initializer is left to run
+static void assembler_emit_object_new(assembler_context *context,
+                                      size_t class_idx) {
+    semantic_mapping_item *item = NULL;
+    ds_dynamic_array_get_ref(&context->mapping->classes, class_idx, (void **)&item);
+
+    const char *class_name = item->class_name;
+    size_t words = item->attributes.count + 3;
+    int initializers = assembler_has_initializers(context, item);
+
+    assembler_emit_fmt(context, 0, NULL, "%s_new:", class_name);
+    assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL,
+                       "mov     rax, qword [heap_pos]");
+    assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL,
+                       "lea     rdi, [rax+%zu]", words * WORD_SIZE);
+    assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL,
+                       "cmp     rdi, qword [heap_end]");
+    assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "ja      .allocate");
+    assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL,
+                       "mov     qword [heap_pos], rdi");
+    assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "mov     rdi, rax");
+    assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL,
+                       "mov     rsi, %s_protObj", class_name);
+    assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "mov     rcx, %zu",
+                       words);
+    assembler_emit_fmt(context, ASM_INDENT_SIZE, "copy the prototype",
+                       "rep movsq");
+    if (initializers) {
+        assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "jmp     %s_init",
+                           class_name);
+    } else {
+        assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "ret");
+    }
+
+    assembler_emit_fmt(context, 0, NULL, ".allocate:");
+    assembler_emit_fmt(context, ASM_INDENT_SIZE, "keep the stack aligned",
+                       "sub     rsp, 8");
+    assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL,
+                       "mov     rax, %s_protObj", class_name);
+    assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "call    Object.copy");
+    assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "add     rsp, 8");
+    if (initializers) {
+        assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "jmp     %s_init",
+                           class_name);
+    } else {
+        assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "ret");
+    }
 }
 
 static void assembler_emit_object_inits(assembler_context *context) {
@@ -1478,6 +2405,51 @@ static void assembler_emit_object_inits(assembler_context *context) {
     for (size_t i = 0; i < context->mapping->classes.count; i++) {
         assembler_emit_object_init(context, i);
     }
+
+    if (!codegen_tac_pipeline_has(context->options.pipeline, "alloc")) {
+        return;
+    }
+
+    for (size_t i = 0; i < context->mapping->classes.count; i++) {
+        assembler_emit_object_new(context, i);
+    }
+}
+
+// pushes the arguments of an extern the way it expects them
+static void assembler_emit_extern_shim(assembler_context *context,
+                                       implementation_mapping_item *method) {
+    size_t count = method->method->formals.count;
+    if (count == 0) {
+        return;
+    }
+
+    assembler_emit_fmt(context, 0, NULL, "%s.%s.regs:", method->from_class,
+                       method->method_name);
+    assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "push    rbp");
+    assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "mov     rbp, rsp");
+
+    if (count % 2 == 1) {
+        assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "push    0");
+    }
+
+    for (size_t i = count; i > 0; i--) {
+        const char *comment = comment_fmt("arg%d", i - 1);
+        if (i - 1 < TAC_REGISTER_ARGS) {
+            assembler_emit_fmt(context, ASM_INDENT_SIZE, comment,
+                               "push    %s", argument_registers[i - 1]);
+        } else {
+            assembler_emit_fmt(
+                context, ASM_INDENT_SIZE, comment, "push    qword [rbp+%d]",
+                ARGUMENTS_OFFSET +
+                    WORD_SIZE * (int)(i - 1 - TAC_REGISTER_ARGS));
+        }
+    }
+
+    assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "call    %s.%s",
+                       method->from_class, method->method_name);
+    assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "mov     rsp, rbp");
+    assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "pop     rbp");
+    assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "ret");
 }
 
 static void assembler_emit_method(assembler_context *context,
@@ -1493,14 +2465,14 @@ static void assembler_emit_method(assembler_context *context,
     }
 
     if (method->method->body.kind == EXPR_EXTERN) {
-        return;
+        return assembler_emit_extern_shim(context, method);
     }
 
     assembler_emit_fmt(context, 0, NULL, "%s.%s:", item->class_name, method->method_name);
 
     context->current_class = item;
     context->current_method = method;
-    assembler_emit_expr(context, &method->method->body);
+    assembler_emit_method_body(context, &method->method->body);
     context->current_method = NULL;
     context->current_class = NULL;
 
@@ -1533,8 +2505,9 @@ static void assembler_emit_dispatch_table(assembler_context *context,
         implementation_mapping_item *method = NULL;
         ds_dynamic_array_get_ref(&item->methods, j, (void **)&method);
 
-        assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "dq %s.%s",
-                           method->from_class, method->method_name);
+        assembler_emit_fmt(context, ASM_INDENT_SIZE, NULL, "dq %s",
+                           assembler_method_label(context, method->from_class,
+                                                  method->method_name));
     }
 }
 
@@ -1547,13 +2520,15 @@ static void assembler_emit_dispatch_tables(assembler_context *context) {
 }
 
 enum assembler_result assembler_run(const char *filename,
-                                    semantic_mapping *mapping) {
+                                    semantic_mapping *mapping,
+                                    assembler_options options) {
 
     int result = 0;
     assembler_context context;
     if (assembler_context_init(&context, filename, mapping) != 0) {
         return_defer(1);
     }
+    context.options = options;
 
     int int_tag = 0, str_tag = 0, bool_tag = 0;
     for (size_t i = 0; i < mapping->classes.count; i++) {
@@ -1572,6 +2547,15 @@ enum assembler_result assembler_run(const char *filename,
     context.str_tag = str_tag;
     context.bool_tag = bool_tag;
 
+    // the two Bool objects, in this order
+    asm_const *bool_const = NULL;
+    assembler_new_const(
+        &context, (asm_const_value){.type = ASM_CONST_BOOL, .boolean = 0},
+        &bool_const);
+    assembler_new_const(
+        &context, (asm_const_value){.type = ASM_CONST_BOOL, .boolean = 1},
+        &bool_const);
+
     assembler_emit_class_name_table(&context);
     assembler_emit_dispatch_tables(&context);
     assembler_emit_object_prototypes(&context);
@@ -1579,6 +2563,32 @@ enum assembler_result assembler_run(const char *filename,
     assembler_emit_methods(&context);
     assembler_emit_consts(&context);
 
+    size_t instructions = assembler_count_instructions(&context.lines);
+    size_t peephole = 0;
+    if (codegen_tac_pipeline_has(options.pipeline, "peephole")) {
+        peephole = assembler_peephole(&context.lines);
+    }
+    assembler_write_lines(&context);
+
+    if (context.options.report) {
+        fprintf(stderr, "devirtualized %zu of %zu dynamic dispatches\n",
+                context.stats.devirtualized, context.stats.dispatches);
+        fprintf(stderr, "inlined %zu calls\n", context.stats.inlined);
+        fprintf(stderr, "removed %zu redundant computations\n",
+                context.stats.redundant);
+        fprintf(stderr, "hoisted %zu loop invariant computations\n",
+                context.stats.hoisted);
+        fprintf(stderr, "emitted %zu tail calls\n", context.stats.tail_calls);
+        fprintf(stderr, "allocated %d new objects inline\n",
+                context.inline_news);
+        fprintf(stderr, "allocated %zu objects on the stack\n",
+                context.stats.stack_objects);
+        fprintf(stderr, "shared %zu new objects of stateless classes\n",
+                context.stats.shared);
+        fprintf(stderr, "peephole removed %zu of %zu instructions\n",
+                peephole, instructions);
+    }
+
 defer:
     result = context.result;
     assembler_context_destroy(&context);
@@ -0,0 +1,829 @@
+#include "assembler.h"
+#include "ds.h"
+#include <ctype.h>
+#include <limits.h>
+
+// The peephole pass. It runs on the lines the assembler recorded, looking
+// at an instruction together with the one that runs right after it: the
+// source of a move is forwarded into the instruction that uses the moved
+// value, so that the register copies of the emitter fold into operands and
+// addresses, a reload of the value that was just stored is dropped, and a
+// move whose register is written again before it is read is removed. Loads
+// of zero and comparisons with zero get the shorter xor and test forms,
+// and jumps to the next line and code after a jump go away.
+//
+// Only the instructions the assembler emits are modelled. Whether a
+// register is still needed is found by following the code, and the jumps
+// to the labels of the same function; anything else ends the search and
+// the register counts as needed.
+
+#define ASM_REGISTER_COUNT 16
+#define ASM_FLAGS (1u << ASM_REGISTER_COUNT)
+#define ASM_ALL (ASM_FLAGS | (ASM_FLAGS - 1))
+
+#define ASM_RAX 0
+#define ASM_RDX 2
+#define ASM_RBX 3
+#define ASM_RSP 4
+#define ASM_RBP 5
+
+// what a return reads: the result, the stack and the callee saved registers
+#define ASM_RETURN                                                             \
+    (1u << ASM_RAX | 1u << ASM_RBX | 1u << ASM_RSP | 1u << ASM_RBP |           \
+     0xfu << 12)
+
+// the names of the general purpose registers, by size from 64 to 8 bits
+static const char *asm_registers[ASM_REGISTER_COUNT][4] = {
+    {"rax", "eax", "ax", "al"},     {"rcx", "ecx", "cx", "cl"},
+    {"rdx", "edx", "dx", "dl"},     {"rbx", "ebx", "bx", "bl"},
+    {"rsp", "esp", "sp", "spl"},    {"rbp", "ebp", "bp", "bpl"},
+    {"rsi", "esi", "si", "sil"},    {"rdi", "edi", "di", "dil"},
+    {"r8", "r8d", "r8w", "r8b"},    {"r9", "r9d", "r9w", "r9b"},
+    {"r10", "r10d", "r10w", "r10b"}, {"r11", "r11d", "r11w", "r11b"},
+    {"r12", "r12d", "r12w", "r12b"}, {"r13", "r13d", "r13w", "r13b"},
+    {"r14", "r14d", "r14w", "r14b"}, {"r15", "r15d", "r15w", "r15b"},
+};
+
+// the moves only write their destination, the arithmetic also reads it
+static const char *asm_moves[] = {"mov", "movzx", "lea", NULL};
+static const char *asm_arithmetic[] = {"add", "sub", "and", "or",  "xor",
+                                       "imul", "shl", "shr", "sar", NULL};
+
+// the instructions a moved value can be forwarded into
+static const char *asm_forwardable[] = {"mov", "movzx", "lea", "add",
+                                        "sub", "and",   "or",  "xor",
+                                        "cmp", "test",  "imul", "push",
+                                        NULL};
+
+static int asm_is_one_of(const char *mnemonic, const char **names) {
+    for (size_t i = 0; names[i] != NULL; i++) {
+        if (strcmp(mnemonic, names[i]) == 0) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+static int asm_is_token_char(char c) {
+    return isalnum((unsigned char)c) || c == '_' || c == '.' || c == '$';
+}
+
+// the register a token names and its size as an index in asm_registers,
+// -1 when the token is not a register
+static int asm_register(const char *token, size_t length, int *size) {
+    for (int reg = 0; reg < ASM_REGISTER_COUNT; reg++) {
+        for (int i = 0; i < 4; i++) {
+            const char *name = asm_registers[reg][i];
+            if (strlen(name) == length && strncmp(name, token, length) == 0) {
+                *size = i;
+                return reg;
+            }
+        }
+    }
+
+    return -1;
+}
+
+static int asm_operand_register(const char *operand, int *size) {
+    return asm_register(operand, strlen(operand), size);
+}
+
+// the registers an operand names, in an address or on its own
+static unsigned asm_operand_registers(const char *operand) {
+    unsigned mask = 0;
+
+    const char *p = operand;
+    while (*p != '\0') {
+        if (!asm_is_token_char(*p)) {
+            p++;
+            continue;
+        }
+
+        size_t length = 0;
+        while (asm_is_token_char(p[length])) {
+            length++;
+        }
+
+        int size = 0;
+        int reg = asm_register(p, length, &size);
+        if (reg >= 0) {
+            mask |= 1u << reg;
+        }
+        p += length;
+    }
+
+    return mask;
+}
+
+static int asm_is_memory(const char *operand) {
+    return strchr(operand, '[') != NULL;
+}
+
+// a number that fits the 32 bit immediate of most instructions
+static int asm_is_small_immediate(const char *operand) {
+    char *end = NULL;
+    long value = strtol(operand, &end, 10);
+
+    return *operand != '\0' && *end == '\0' && value >= INT_MIN &&
+           value <= INT_MAX;
+}
+
+// replaces the register reg by with wherever the operand names it
+static char *asm_replace_register(const char *operand, int reg,
+                                  const char *with) {
+    ds_string_builder sb;
+    ds_string_builder_init(&sb);
+
+    const char *p = operand;
+    while (*p != '\0') {
+        if (!asm_is_token_char(*p)) {
+            ds_string_builder_appendc(&sb, *p++);
+            continue;
+        }
+
+        size_t length = 0;
+        while (asm_is_token_char(p[length])) {
+            length++;
+        }
+
+        int size = 0;
+        if (asm_register(p, length, &size) == reg) {
+            ds_string_builder_append(&sb, "%s", with);
+        } else {
+            ds_string_builder_appendn(&sb, p, length);
+        }
+        p += length;
+    }
+
+    char *result = NULL;
+    ds_string_builder_build(&sb, &result);
+    ds_string_builder_free(&sb);
+
+    return result;
+}
+
+void assembler_line_parse(asm_line *line) {
+    const char *text = line->text;
+    size_t length = strlen(text);
+
+    line->mnemonic = NULL;
+    line->operand_count = 0;
+    line->removed = 0;
+
+    if (text[0] == ';') {
+        line->kind = ASM_LINE_COMMENT;
+        return;
+    }
+
+    if (line->align == 0 && length > 0 && text[length - 1] == ':') {
+        line->kind = ASM_LINE_LABEL;
+        return;
+    }
+
+    line->kind = ASM_LINE_CODE;
+
+    size_t word = strcspn(text, " ");
+    line->mnemonic = strndup(text, word);
+
+    const char *p = text + word;
+    while (*p != '\0') {
+        while (*p == ' ') {
+            p++;
+        }
+
+        // split at the commas outside of addresses and strings
+        size_t end = 0;
+        int depth = 0, quoted = 0;
+        for (; p[end] != '\0'; end++) {
+            if (p[end] == '"' || p[end] == '\'') {
+                quoted = !quoted;
+            } else if (!quoted && p[end] == '[') {
+                depth++;
+            } else if (!quoted && p[end] == ']') {
+                depth--;
+            } else if (!quoted && depth == 0 && p[end] == ',') {
+                break;
+            }
+        }
+
+        size_t trimmed = end;
+        while (trimmed > 0 && p[trimmed - 1] == ' ') {
+            trimmed--;
+        }
+
+        if (line->operand_count == ASM_MAX_OPERANDS) {
+            // not an instruction the pass knows
+            line->mnemonic = NULL;
+            line->operand_count = 0;
+            return;
+        }
+        line->operands[line->operand_count++] = strndup(p, trimmed);
+
+        p += end;
+        if (*p == ',') {
+            p++;
+        }
+    }
+}
+
+// writes the text of an instruction from its mnemonic and operands
+static void asm_line_format(asm_line *line) {
+    ds_string_builder sb;
+    ds_string_builder_init(&sb);
+
+    if (line->operand_count == 0) {
+        ds_string_builder_append(&sb, "%s", line->mnemonic);
+    } else {
+        ds_string_builder_append(&sb, "%-7s ", line->mnemonic);
+        for (int i = 0; i < line->operand_count; i++) {
+            ds_string_builder_append(&sb, i == 0 ? "%s" : ", %s",
+                                     line->operands[i]);
+        }
+    }
+
+    ds_string_builder_build(&sb, &line->text);
+    ds_string_builder_free(&sb);
+}
+
+enum asm_flow {
+    ASM_FLOW_UNKNOWN,
+    ASM_FLOW_NEXT,   // goes on with the next line
+    ASM_FLOW_BRANCH, // may go somewhere else
+};
+
+typedef struct asm_effect {
+        unsigned reads;  // registers and flags the instruction reads
+        unsigned writes; // and the ones it overwrites completely
+} asm_effect;
+
+// the destination is written, and also read when it is an address or a
+// part of a register that keeps the rest
+static void asm_effect_destination(const char *operand, int read,
+                                   asm_effect *effect) {
+    int size = 0;
+    int reg = asm_operand_register(operand, &size);
+    if (reg < 0) {
+        effect->reads |= asm_operand_registers(operand);
+        return;
+    }
+
+    effect->writes |= 1u << reg;
+    if (read || size > 1) {
+        effect->reads |= 1u << reg;
+    }
+}
+
+static enum asm_flow asm_line_effect(asm_line *line, asm_effect *effect) {
+    *effect = (asm_effect){.reads = 0, .writes = 0};
+
+    if (line->kind != ASM_LINE_CODE || line->mnemonic == NULL) {
+        return ASM_FLOW_UNKNOWN;
+    }
+
+    const char *mnemonic = line->mnemonic;
+    int count = line->operand_count;
+    char **operands = line->operands;
+
+    if (asm_is_one_of(mnemonic, asm_moves) && count == 2) {
+        effect->reads |= asm_operand_registers(operands[1]);
+        asm_effect_destination(operands[0], 0, effect);
+    } else if (asm_is_one_of(mnemonic, asm_arithmetic) && count == 2) {
+        effect->reads |= asm_operand_registers(operands[1]);
+        asm_effect_destination(operands[0], 1, effect);
+        effect->writes |= ASM_FLAGS;
+    } else if ((strcmp(mnemonic, "cmp") == 0 ||
+                strcmp(mnemonic, "test") == 0) &&
+               count == 2) {
+        effect->reads |= asm_operand_registers(operands[0]) |
+                         asm_operand_registers(operands[1]);
+        effect->writes |= ASM_FLAGS;
+    } else if (strcmp(mnemonic, "neg") == 0 && count == 1) {
+        asm_effect_destination(operands[0], 1, effect);
+        effect->writes |= ASM_FLAGS;
+    } else if (strcmp(mnemonic, "push") == 0 && count == 1) {
+        effect->reads |= asm_operand_registers(operands[0]) | 1u << ASM_RSP;
+        effect->writes |= 1u << ASM_RSP;
+    } else if (strcmp(mnemonic, "pop") == 0 && count == 1) {
+        asm_effect_destination(operands[0], 0, effect);
+        effect->reads |= 1u << ASM_RSP;
+        effect->writes |= 1u << ASM_RSP;
+    } else if (strcmp(mnemonic, "cqo") == 0 && count == 0) {
+        effect->reads |= 1u << ASM_RAX;
+        effect->writes |= 1u << ASM_RDX;
+    } else if (strcmp(mnemonic, "idiv") == 0 && count == 1) {
+        effect->reads |=
+            asm_operand_registers(operands[0]) | 1u << ASM_RAX | 1u << ASM_RDX;
+        effect->writes |= 1u << ASM_RAX | 1u << ASM_RDX | ASM_FLAGS;
+    } else if (strncmp(mnemonic, "set", 3) == 0 && count == 1) {
+        asm_effect_destination(operands[0], 0, effect);
+        effect->reads |= ASM_FLAGS;
+    } else if (strcmp(mnemonic, "call") == 0 && count == 1) {
+        // the callee may read any register, only the flags are surely gone
+        effect->reads |= ASM_ALL & ~ASM_FLAGS;
+        effect->writes |= ASM_FLAGS;
+    } else if (strcmp(mnemonic, "ret") == 0 && count == 0) {
+        // the result and the registers the caller expects preserved
+        effect->reads |= ASM_RETURN;
+        return ASM_FLOW_BRANCH;
+    } else if (mnemonic[0] == 'j' && count == 1) {
+        // where the jump goes is up to the caller to follow
+        if (strcmp(mnemonic, "jmp") != 0) {
+            effect->reads |= ASM_FLAGS;
+        }
+        return ASM_FLOW_BRANCH;
+    } else {
+        return ASM_FLOW_UNKNOWN;
+    }
+
+    return ASM_FLOW_NEXT;
+}
+
+static asm_line *asm_line_at(ds_dynamic_array *lines, size_t i) {
+    asm_line *line = NULL;
+    ds_dynamic_array_get_ref(lines, i, (void **)&line);
+    return line;
+}
+
+// the line that runs after the line at i, -1 at the end of the program
+static long asm_next_line(ds_dynamic_array *lines, size_t i) {
+    for (size_t j = i + 1; j < lines->count; j++) {
+        asm_line *line = asm_line_at(lines, j);
+        if (!line->removed && line->kind != ASM_LINE_COMMENT) {
+            return j;
+        }
+    }
+
+    return -1;
+}
+
+// a label that is not local starts a new function
+static int asm_is_function_label(asm_line *line) {
+    return line->kind == ASM_LINE_LABEL && line->text[0] != '.';
+}
+
+// the line of a local label in the function of the line at i, -1 for any
+// other jump target
+static long asm_find_label(ds_dynamic_array *lines, size_t i,
+                           const char *name) {
+    if (name[0] != '.') {
+        return -1;
+    }
+
+    size_t start = i;
+    while (start > 0 && !asm_is_function_label(asm_line_at(lines, start))) {
+        start--;
+    }
+
+    size_t length = strlen(name);
+    for (size_t j = start + 1; j < lines->count; j++) {
+        asm_line *line = asm_line_at(lines, j);
+        if (asm_is_function_label(line)) {
+            break;
+        }
+
+        if (line->kind == ASM_LINE_LABEL && !line->removed &&
+            strlen(line->text) == length + 1 &&
+            strncmp(line->text, name, length) == 0) {
+            return j;
+        }
+    }
+
+    return -1;
+}
+
+// whether one of the registers in mask may be read from the line at j on
+// before it is written, following the jumps inside the function; budget
+// bounds the number of instructions looked at
+static int asm_is_live_from(ds_dynamic_array *lines, size_t j, unsigned mask,
+                            int *budget) {
+    for (; j < lines->count; j++) {
+        asm_line *line = asm_line_at(lines, j);
+        if (asm_is_function_label(line)) {
+            return 1;
+        }
+        if (line->removed || line->kind != ASM_LINE_CODE) {
+            continue;
+        }
+
+        asm_effect effect;
+        enum asm_flow flow = asm_line_effect(line, &effect);
+        if (flow == ASM_FLOW_UNKNOWN || --*budget < 0 ||
+            (effect.reads & mask) != 0) {
+            return 1;
+        }
+
+        mask &= ~effect.writes;
+        if (mask == 0 || strcmp(line->mnemonic, "ret") == 0) {
+            return 0;
+        }
+
+        if (flow == ASM_FLOW_BRANCH) {
+            long target = asm_find_label(lines, j, line->operands[0]);
+            if (target < 0) {
+                return 1;
+            }
+
+            if (strcmp(line->mnemonic, "jmp") == 0) {
+                j = target;
+            } else if (asm_is_live_from(lines, target, mask, budget)) {
+                return 1;
+            }
+        }
+    }
+
+    return 1;
+}
+
+#define ASM_LIVENESS_BUDGET 256
+
+// whether one of the registers in mask may be read after the line at i
+// before it is written
+static int asm_is_live(ds_dynamic_array *lines, size_t i, unsigned mask) {
+    int budget = ASM_LIVENESS_BUDGET;
+    return asm_is_live_from(lines, i + 1, mask, &budget);
+}
+
+static int asm_is_instruction(asm_line *line) {
+    asm_effect effect;
+    return !line->removed && asm_line_effect(line, &effect) != ASM_FLOW_UNKNOWN;
+}
+
+size_t assembler_count_instructions(ds_dynamic_array *lines) {
+    size_t count = 0;
+    for (size_t i = 0; i < lines->count; i++) {
+        count += asm_is_instruction(asm_line_at(lines, i));
+    }
+
+    return count;
+}
+
+static void asm_remove(asm_line *line) { line->removed = 1; }
+
+// whether source can take the place of the register in operand k
+static int asm_can_forward(asm_line *use, int k, const char *source) {
+    const char *mnemonic = use->mnemonic;
+    int size = 0;
+    if (asm_operand_register(source, &size) >= 0) {
+        return size == 0;
+    }
+
+    int plain = strcmp(mnemonic, "test") != 0 && strcmp(mnemonic, "lea") != 0 &&
+                strcmp(mnemonic, "movzx") != 0;
+    if (asm_is_memory(source)) {
+        return plain;
+    }
+
+    // an immediate can only be the last operand, and it needs the size of
+    // an address it is stored to
+    const char *first = use->operands[0];
+    if (k != use->operand_count - 1) {
+        return 0;
+    }
+
+    if (asm_is_small_immediate(source)) {
+        return plain && strcmp(mnemonic, "imul") != 0 &&
+               (k == 0 || !asm_is_memory(first) ||
+                strstr(first, "qword") != NULL);
+    }
+
+    // a label is a 64 bit immediate, only a move into a register takes it
+    size = 0;
+    return strcmp(mnemonic, "mov") == 0 && k == 1 &&
+           asm_operand_register(first, &size) >= 0 && size == 0;
+}
+
+// `mov A, S` followed by an instruction that reads A: the instruction
+// reads S instead and the move goes when nothing else needs A
+static int asm_forward_move(ds_dynamic_array *lines, size_t i, size_t j) {
+    asm_line *move = asm_line_at(lines, i);
+    asm_line *use = asm_line_at(lines, j);
+
+    if (strcmp(move->mnemonic, "mov") != 0 || move->operand_count != 2 ||
+        use->kind != ASM_LINE_CODE || use->mnemonic == NULL ||
+        !asm_is_one_of(use->mnemonic, asm_forwardable)) {
+        return 0;
+    }
+
+    int size = 0;
+    int reg = asm_operand_register(move->operands[0], &size);
+    const char *source = move->operands[1];
+    if (reg < 0 || size != 0 || reg == ASM_RSP || reg == ASM_RBP ||
+        (asm_operand_registers(source) & 1u << reg) != 0) {
+        return 0;
+    }
+
+    int source_size = 0;
+    int source_reg = asm_operand_register(source, &source_size);
+    int pure_write = asm_is_one_of(use->mnemonic, asm_moves);
+
+    char *operands[ASM_MAX_OPERANDS] = {NULL};
+    int count = use->operand_count;
+    int memory = 0;
+    for (int k = 0; k < count; k++) {
+        const char *operand = use->operands[k];
+        int destination = k == 0 && count == 2 &&
+                          strcmp(use->mnemonic, "cmp") != 0 &&
+                          strcmp(use->mnemonic, "test") != 0;
+        operands[k] = use->operands[k];
+
+        if ((asm_operand_registers(operand) & 1u << reg) == 0) {
+            // nothing to replace
+        } else if (destination && !asm_is_memory(operand)) {
+            // a move overwrites A, anything else reads it as well
+            int operand_size = 0;
+            asm_operand_register(operand, &operand_size);
+            if (!pure_write || operand_size > 1) {
+                return 0;
+            }
+        } else if (asm_is_memory(operand)) {
+            // only a register can take its place in an address
+            if (source_reg < 0 || source_size != 0) {
+                return 0;
+            }
+            operands[k] =
+                asm_replace_register(operand, reg, asm_registers[source_reg][0]);
+        } else if (strcmp(operand, asm_registers[reg][0]) == 0 &&
+                   asm_can_forward(use, k, source)) {
+            operands[k] = strdup(source);
+        } else {
+            return 0;
+        }
+
+        memory += asm_is_memory(operands[k]);
+    }
+
+    if (memory > 1) {
+        return 0;
+    }
+
+    // the value of the move must not be needed after the instruction
+    asm_line rewritten = *use;
+    for (int k = 0; k < count; k++) {
+        rewritten.operands[k] = operands[k];
+    }
+
+    asm_effect effect;
+    asm_line_effect(&rewritten, &effect);
+    if ((effect.reads & 1u << reg) != 0 ||
+        ((effect.writes & 1u << reg) == 0 && asm_is_live(lines, j, 1u << reg))) {
+        return 0;
+    }
+
+    for (int k = 0; k < count; k++) {
+        use->operands[k] = operands[k];
+    }
+    asm_line_format(use);
+    if (use->comment == NULL) {
+        use->comment = move->comment;
+    }
+    asm_remove(move);
+
+    return 1;
+}
+
+// `mov X, A` followed by `mov A, X`: A still holds the value
+static int asm_drop_reload(ds_dynamic_array *lines, size_t i, size_t j) {
+    asm_line *store = asm_line_at(lines, i);
+    asm_line *load = asm_line_at(lines, j);
+
+    if (strcmp(store->mnemonic, "mov") != 0 || store->operand_count != 2 ||
+        load->kind != ASM_LINE_CODE || load->mnemonic == NULL ||
+        strcmp(load->mnemonic, "mov") != 0 || load->operand_count != 2) {
+        return 0;
+    }
+
+    int size = 0;
+    int reg = asm_operand_register(store->operands[1], &size);
+    if (reg < 0 || size != 0 ||
+        strcmp(load->operands[0], store->operands[1]) != 0 ||
+        strcmp(load->operands[1], store->operands[0]) != 0 ||
+        (asm_operand_registers(store->operands[0]) & 1u << reg) != 0) {
+        return 0;
+    }
+
+    asm_remove(load);
+    return 1;
+}
+
+// a move, or a load of an address, into a register nobody reads
+static int asm_drop_dead_move(ds_dynamic_array *lines, size_t i) {
+    asm_line *line = asm_line_at(lines, i);
+    if (!asm_is_one_of(line->mnemonic, asm_moves) || line->operand_count != 2) {
+        return 0;
+    }
+
+    int size = 0;
+    int reg = asm_operand_register(line->operands[0], &size);
+    if (reg < 0 || size > 1 || reg == ASM_RSP || reg == ASM_RBP ||
+        asm_is_live(lines, i, 1u << reg)) {
+        return 0;
+    }
+
+    asm_remove(line);
+    return 1;
+}
+
+// `mov R, 0` is `xor R, R` when the flags are not needed and `cmp R, 0` is
+// `test R, R`, both are shorter
+static int asm_use_zero_idioms(ds_dynamic_array *lines, size_t i) {
+    asm_line *line = asm_line_at(lines, i);
+    if (line->operand_count != 2 || strcmp(line->operands[1], "0") != 0) {
+        return 0;
+    }
+
+    int size = 0;
+    int reg = asm_operand_register(line->operands[0], &size);
+    if (reg < 0 || size != 0) {
+        return 0;
+    }
+
+    if (strcmp(line->mnemonic, "mov") == 0 &&
+        !asm_is_live(lines, i, ASM_FLAGS)) {
+        // writing the lower half clears the upper one
+        line->mnemonic = "xor";
+        line->operands[0] = (char *)asm_registers[reg][1];
+        line->operands[1] = (char *)asm_registers[reg][1];
+    } else if (strcmp(line->mnemonic, "cmp") == 0) {
+        line->mnemonic = "test";
+        line->operands[1] = line->operands[0];
+    } else {
+        return 0;
+    }
+
+    asm_line_format(line);
+    return 1;
+}
+
+// the instruction that runs after the line at i, past the labels of the
+// function, -1 at the end of the function
+static long asm_next_instruction(ds_dynamic_array *lines, size_t i) {
+    for (long j = asm_next_line(lines, i); j >= 0;
+         j = asm_next_line(lines, j)) {
+        asm_line *line = asm_line_at(lines, j);
+        if (asm_is_function_label(line)) {
+            return -1;
+        }
+        if (line->kind != ASM_LINE_LABEL) {
+            return j;
+        }
+    }
+
+    return -1;
+}
+
+// whether the text names the label
+static int asm_mentions(const char *text, const char *label) {
+    size_t length = strlen(label);
+    for (const char *p = strstr(text, label); p != NULL;
+         p = strstr(p + 1, label)) {
+        if ((p == text || !asm_is_token_char(p[-1])) &&
+            !asm_is_token_char(p[length])) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+// a local label that nothing in its function refers to
+static int asm_drop_label(ds_dynamic_array *lines, size_t i) {
+    asm_line *label = asm_line_at(lines, i);
+    if (asm_is_function_label(label)) {
+        return 0;
+    }
+
+    char *name = strndup(label->text, strlen(label->text) - 1);
+    int used = 0;
+
+    size_t start = i;
+    while (start > 0 && !asm_is_function_label(asm_line_at(lines, start))) {
+        start--;
+    }
+
+    for (size_t j = start + 1; j < lines->count && !used; j++) {
+        asm_line *line = asm_line_at(lines, j);
+        if (asm_is_function_label(line)) {
+            break;
+        }
+
+        used = !line->removed && line->kind == ASM_LINE_CODE &&
+               asm_mentions(line->text, name);
+    }
+    free(name);
+
+    if (used) {
+        return 0;
+    }
+
+    asm_remove(label);
+    return 1;
+}
+
+// a jump to one of the labels right after it, a jump to another jump, and
+// the code after a jump or a return up to the next label
+static int asm_drop_jumps(ds_dynamic_array *lines, size_t i) {
+    asm_line *line = asm_line_at(lines, i);
+    int jump = strcmp(line->mnemonic, "jmp") == 0;
+    if (!jump && strcmp(line->mnemonic, "ret") != 0) {
+        if (line->mnemonic[0] != 'j' || line->operand_count != 1) {
+            return 0;
+        }
+    }
+
+    long j = asm_next_line(lines, i);
+    if ((jump || strcmp(line->mnemonic, "ret") == 0) && j >= 0 &&
+        asm_is_instruction(asm_line_at(lines, j))) {
+        for (; j >= 0 && asm_is_instruction(asm_line_at(lines, j));
+             j = asm_next_line(lines, j)) {
+            asm_remove(asm_line_at(lines, j));
+        }
+        return 1;
+    }
+
+    if (line->operand_count != 1) {
+        return 0;
+    }
+
+    for (; j >= 0; j = asm_next_line(lines, j)) {
+        asm_line *label = asm_line_at(lines, j);
+        if (label->kind != ASM_LINE_LABEL) {
+            break;
+        }
+
+        size_t length = strlen(label->text) - 1;
+        if (jump && strlen(line->operands[0]) == length &&
+            strncmp(line->operands[0], label->text, length) == 0) {
+            asm_remove(line);
+            return 1;
+        }
+    }
+
+    long target = asm_find_label(lines, i, line->operands[0]);
+    long next = target >= 0 ? asm_next_instruction(lines, target) : -1;
+    if (next < 0 || (size_t)next == i) {
+        return 0;
+    }
+
+    asm_line *other = asm_line_at(lines, next);
+    if (strcmp(other->mnemonic, "jmp") != 0 || other->operand_count != 1 ||
+        strcmp(other->operands[0], line->operands[0]) == 0 ||
+        asm_find_label(lines, i, other->operands[0]) < 0) {
+        return 0;
+    }
+
+    line->operands[0] = other->operands[0];
+    asm_line_format(line);
+    return 1;
+}
+
+static int asm_simplify(ds_dynamic_array *lines, size_t i) {
+    asm_line *line = asm_line_at(lines, i);
+    if (line->removed) {
+        return 0;
+    }
+
+    if (line->kind == ASM_LINE_LABEL) {
+        return asm_drop_label(lines, i);
+    }
+
+    if (!asm_is_instruction(line)) {
+        return 0;
+    }
+
+    if (asm_drop_jumps(lines, i) || asm_drop_dead_move(lines, i)) {
+        return 1;
+    }
+
+    if (strcmp(line->mnemonic, "mov") == 0 && line->operand_count == 2 &&
+        strcmp(line->operands[0], line->operands[1]) == 0) {
+        asm_remove(line);
+        return 1;
+    }
+
+    long j = asm_next_line(lines, i);
+    return j >= 0 &&
+           (asm_drop_reload(lines, i, j) || asm_forward_move(lines, i, j));
+}
+
+// returns the number of instructions removed
+size_t assembler_peephole(ds_dynamic_array *lines) {
+    size_t before = assembler_count_instructions(lines);
+
+    int changed = 1;
+    while (changed) {
+        changed = 0;
+        for (size_t i = 0; i < lines->count; i++) {
+            changed |= asm_simplify(lines, i);
+        }
+    }
+
+    // last, so that a zero can still be forwarded as an immediate
+    for (size_t i = 0; i < lines->count; i++) {
+        if (asm_is_instruction(asm_line_at(lines, i))) {
+            asm_use_zero_idioms(lines, i);
+        }
+    }
+
+    return before - assembler_count_instructions(lines);
+}
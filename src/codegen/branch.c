@@ -0,0 +1,250 @@
+#include "codegen.h"
+#include "ds.h"
+
+// A comparison whose result only feeds a conditional jump does not need to
+// be materialized as a Bool: the sequences
+//
+//     t <- a < b          t <- a < b          t <- isvoid a
+//     bt t L              u <- not t          bt t L
+//                         bt u L
+//
+// become a single `bt a < b L` (`bt a >= b L`, `bt isvoid a L`) which the
+// assembler emits as a compare followed by a conditional jump. `=` is fused
+// in the same way when it compares raw Int or Bool values.
+//
+// The type tests of a case expression are lowered in the same way: the chain
+//
+//     t1 <- e instanceof A
+//     bt t1 L1
+//     t2 <- e instanceof B
+//     bt t2 L2
+//     L1:
+//
+// becomes `case e A L1 B L2 else L1` and the assembler dispatches on the
+// class tag of e with a single load.
+
+static size_t tac_count_uses(tac_result *tac, const char *name) {
+    size_t count = 0;
+
+    for (size_t i = 0; i < tac->instrs.count; i++) {
+        tac_instr *instr = NULL;
+        ds_dynamic_array_get_ref(&tac->instrs, i, (void **)&instr);
+
+        ds_dynamic_array uses;
+        codegen_tac_instr_uses(instr, &uses);
+        for (size_t j = 0; j < uses.count; j++) {
+            char **operand = NULL;
+            ds_dynamic_array_get(&uses, j, &operand);
+
+            if (strcmp(*operand, name) == 0) {
+                count++;
+            }
+        }
+        ds_dynamic_array_free(&uses);
+    }
+
+    return count;
+}
+
+// a temporary that is read only by the next instruction
+static int tac_is_single_use(tac_result *tac, const char *name) {
+    return codegen_tac_find_local(tac, name) != NULL &&
+           tac_count_uses(tac, name) == 1;
+}
+
+static enum tac_cond tac_cond_negate(enum tac_cond cond) {
+    switch (cond) {
+    case TAC_COND_LT:
+        return TAC_COND_GE;
+    case TAC_COND_LE:
+        return TAC_COND_GT;
+    case TAC_COND_GE:
+        return TAC_COND_LT;
+    case TAC_COND_GT:
+        return TAC_COND_LE;
+    case TAC_COND_EQ:
+        return TAC_COND_NE;
+    case TAC_COND_NE:
+        return TAC_COND_EQ;
+    case TAC_COND_VOID:
+        return TAC_COND_NOT_VOID;
+    case TAC_COND_NOT_VOID:
+        return TAC_COND_VOID;
+    }
+
+    return cond;
+}
+
+// the condition computed by a comparison instruction
+static int tac_instr_cond(tac_instr *instr, tac_jump_if_cond *jump,
+                          char **ident) {
+    switch (instr->kind) {
+    case TAC_ASSIGN_LT:
+    case TAC_ASSIGN_LE:
+        jump->cond =
+            instr->kind == TAC_ASSIGN_LT ? TAC_COND_LT : TAC_COND_LE;
+        jump->lhs = instr->assign_binary.lhs;
+        jump->rhs = instr->assign_binary.rhs;
+        *ident = instr->assign_binary.ident;
+        return 1;
+    case TAC_ASSIGN_EQ:
+        if (codegen_tac_eq_kind(instr->assign_eq.type) != TAC_EQ_VALUE) {
+            return 0;
+        }
+        jump->cond = TAC_COND_EQ;
+        jump->lhs = instr->assign_eq.lhs;
+        jump->rhs = instr->assign_eq.rhs;
+        *ident = instr->assign_eq.ident;
+        return 1;
+    case TAC_ASSIGN_ISVOID:
+        jump->cond = TAC_COND_VOID;
+        jump->lhs = instr->assign_unary.expr;
+        jump->rhs = NULL;
+        *ident = instr->assign_unary.ident;
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+// try to fuse the instructions starting at index i, returns the number of
+// instructions replaced by the jump
+static size_t tac_fuse_at(tac_result *tac, size_t i, tac_instr *result) {
+    tac_instr *instr = NULL;
+    ds_dynamic_array_get_ref(&tac->instrs, i, (void **)&instr);
+
+    tac_jump_if_cond jump;
+    char *ident = NULL;
+    if (!tac_instr_cond(instr, &jump, &ident) ||
+        !tac_is_single_use(tac, ident)) {
+        return 0;
+    }
+
+    size_t next = i + 1;
+    if (next >= tac->instrs.count) {
+        return 0;
+    }
+
+    tac_instr *negate = NULL;
+    ds_dynamic_array_get_ref(&tac->instrs, next, (void **)&negate);
+    if (negate->kind == TAC_ASSIGN_NOT &&
+        strcmp(negate->assign_unary.expr, ident) == 0 &&
+        tac_is_single_use(tac, negate->assign_unary.ident)) {
+        jump.cond = tac_cond_negate(jump.cond);
+        ident = negate->assign_unary.ident;
+        next++;
+    }
+
+    if (next >= tac->instrs.count) {
+        return 0;
+    }
+
+    tac_instr *branch = NULL;
+    ds_dynamic_array_get_ref(&tac->instrs, next, (void **)&branch);
+    if (branch->kind != TAC_JUMP_IF_TRUE ||
+        strcmp(branch->jump_if_true.expr, ident) != 0) {
+        return 0;
+    }
+
+    jump.label = branch->jump_if_true.label;
+    result->kind = TAC_JUMP_IF_COND;
+    result->jump_if_cond = jump;
+
+    return next - i + 1;
+}
+
+void codegen_tac_fuse_branches(tac_result *tac) {
+    ds_dynamic_array instrs;
+    ds_dynamic_array_init(&instrs, sizeof(tac_instr));
+
+    for (size_t i = 0; i < tac->instrs.count;) {
+        tac_instr instr;
+        size_t fused = tac_fuse_at(tac, i, &instr);
+        if (fused > 0) {
+            ds_dynamic_array_append(&instrs, &instr);
+            i += fused;
+            continue;
+        }
+
+        ds_dynamic_array_get(&tac->instrs, i, &instr);
+        ds_dynamic_array_append(&instrs, &instr);
+        i++;
+    }
+
+    ds_dynamic_array_free(&tac->instrs);
+    tac->instrs = instrs;
+}
+
+// try to lower the type tests starting at index i into a case jump, returns
+// the number of instructions replaced by the jump
+static size_t tac_lower_case_at(tac_result *tac, size_t i, tac_instr *result) {
+    tac_jump_case jump = {.expr = NULL, .default_label = NULL};
+    ds_dynamic_array_init(&jump.branches, sizeof(tac_case_branch));
+
+    size_t next = i;
+    while (next + 1 < tac->instrs.count) {
+        tac_instr *test = NULL;
+        ds_dynamic_array_get_ref(&tac->instrs, next, (void **)&test);
+
+        tac_instr *branch = NULL;
+        ds_dynamic_array_get_ref(&tac->instrs, next + 1, (void **)&branch);
+
+        if (test->kind != TAC_ASSIGN_ISINSTANCE ||
+            branch->kind != TAC_JUMP_IF_TRUE ||
+            strcmp(branch->jump_if_true.expr, test->isinstance.ident) != 0 ||
+            !tac_is_single_use(tac, test->isinstance.ident)) {
+            break;
+        }
+
+        if (jump.expr == NULL) {
+            jump.expr = test->isinstance.expr;
+        } else if (strcmp(jump.expr, test->isinstance.expr) != 0) {
+            break;
+        }
+
+        tac_case_branch case_branch = {.type = test->isinstance.type,
+                                       .label = branch->jump_if_true.label};
+        ds_dynamic_array_append(&jump.branches, &case_branch);
+        next += 2;
+    }
+
+    // when no branch matches the jump falls through to the next label
+    tac_instr *fallthrough = NULL;
+    if (next < tac->instrs.count) {
+        ds_dynamic_array_get_ref(&tac->instrs, next, (void **)&fallthrough);
+    }
+
+    if (jump.branches.count == 0 || fallthrough == NULL ||
+        fallthrough->kind != TAC_LABEL) {
+        ds_dynamic_array_free(&jump.branches);
+        return 0;
+    }
+
+    jump.default_label = fallthrough->label.label;
+    result->kind = TAC_JUMP_CASE;
+    result->jump_case = jump;
+
+    return next - i;
+}
+
+void codegen_tac_lower_case(tac_result *tac) {
+    ds_dynamic_array instrs;
+    ds_dynamic_array_init(&instrs, sizeof(tac_instr));
+
+    for (size_t i = 0; i < tac->instrs.count;) {
+        tac_instr instr;
+        size_t lowered = tac_lower_case_at(tac, i, &instr);
+        if (lowered > 0) {
+            ds_dynamic_array_append(&instrs, &instr);
+            i += lowered;
+            continue;
+        }
+
+        ds_dynamic_array_get(&tac->instrs, i, &instr);
+        ds_dynamic_array_append(&instrs, &instr);
+        i++;
+    }
+
+    ds_dynamic_array_free(&tac->instrs);
+    tac->instrs = instrs;
+}
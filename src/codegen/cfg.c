@@ -0,0 +1,471 @@
+#include "codegen.h"
+#include "ds.h"
+
+// The control flow graph of the TAC of a method and the analyses on top of
+// it: backward liveness of the locals, computed per block and then refined
+// to every instruction, forward reaching definitions, where a definition is
+// the index of the instruction that writes a local, and the dominator tree.
+
+static int tac_is_leader(tac_result *tac, size_t i) {
+    if (i == 0) {
+        return 1;
+    }
+
+    tac_instr *instr = NULL;
+    ds_dynamic_array_get_ref(&tac->instrs, i, (void **)&instr);
+    if (instr->kind == TAC_LABEL) {
+        return 1;
+    }
+
+    tac_instr *prev = NULL;
+    ds_dynamic_array_get_ref(&tac->instrs, i - 1, (void **)&prev);
+
+    ds_dynamic_array labels;
+    codegen_tac_instr_targets(prev, &labels);
+    int jumps = labels.count > 0;
+    ds_dynamic_array_free(&labels);
+
+    return jumps || !codegen_tac_instr_falls_through(prev);
+}
+
+static void tac_add_edge(tac_cfg *cfg, size_t from, size_t to) {
+    tac_basic_block *source = NULL;
+    ds_dynamic_array_get_ref(&cfg->blocks, from, (void **)&source);
+
+    // a case jump can reach the same block from several branches
+    for (size_t i = 0; i < source->successors.count; i++) {
+        size_t successor = 0;
+        ds_dynamic_array_get(&source->successors, i, &successor);
+        if (successor == to) {
+            return;
+        }
+    }
+
+    tac_basic_block *target = NULL;
+    ds_dynamic_array_get_ref(&cfg->blocks, to, (void **)&target);
+
+    ds_dynamic_array_append(&source->successors, &to);
+    ds_dynamic_array_append(&target->predecessors, &from);
+}
+
+void codegen_tac_cfg_build(tac_result *tac, tac_cfg *cfg) {
+    size_t n = tac->instrs.count;
+
+    cfg->tac = tac;
+    cfg->block_of = malloc(sizeof(size_t) * (n + 1));
+    ds_dynamic_array_init(&cfg->blocks, sizeof(tac_basic_block));
+
+    for (size_t i = 0; i < n; i++) {
+        if (tac_is_leader(tac, i)) {
+            tac_basic_block block = {.first = i, .last = i};
+            ds_dynamic_array_init(&block.successors, sizeof(size_t));
+            ds_dynamic_array_init(&block.predecessors, sizeof(size_t));
+            ds_dynamic_array_append(&cfg->blocks, &block);
+        }
+
+        tac_basic_block *block = NULL;
+        ds_dynamic_array_get_ref(&cfg->blocks, cfg->blocks.count - 1,
+                                 (void **)&block);
+        block->last = i + 1;
+        cfg->block_of[i] = cfg->blocks.count - 1;
+    }
+
+    for (size_t b = 0; b < cfg->blocks.count; b++) {
+        tac_basic_block *block = NULL;
+        ds_dynamic_array_get_ref(&cfg->blocks, b, (void **)&block);
+
+        tac_instr *instr = NULL;
+        ds_dynamic_array_get_ref(&tac->instrs, block->last - 1,
+                                 (void **)&instr);
+
+        ds_dynamic_array labels;
+        codegen_tac_instr_targets(instr, &labels);
+        for (size_t j = 0; j < labels.count; j++) {
+            char **label = NULL;
+            ds_dynamic_array_get(&labels, j, &label);
+
+            int target = codegen_tac_label_block(cfg, *label);
+            if (target >= 0) {
+                tac_add_edge(cfg, b, target);
+            }
+        }
+        ds_dynamic_array_free(&labels);
+
+        if (codegen_tac_instr_falls_through(instr) &&
+            b + 1 < cfg->blocks.count) {
+            tac_add_edge(cfg, b, b + 1);
+        }
+    }
+}
+
+void codegen_tac_cfg_free(tac_cfg *cfg) {
+    for (size_t b = 0; b < cfg->blocks.count; b++) {
+        tac_basic_block *block = NULL;
+        ds_dynamic_array_get_ref(&cfg->blocks, b, (void **)&block);
+
+        ds_dynamic_array_free(&block->successors);
+        ds_dynamic_array_free(&block->predecessors);
+    }
+
+    ds_dynamic_array_free(&cfg->blocks);
+    free(cfg->block_of);
+}
+
+tac_instr *codegen_tac_get_instr(tac_result *tac, size_t i) {
+    tac_instr *instr = NULL;
+    ds_dynamic_array_get_ref(&tac->instrs, i, (void **)&instr);
+    return instr;
+}
+
+tac_basic_block *codegen_tac_get_block(tac_cfg *cfg, size_t b) {
+    tac_basic_block *block = NULL;
+    ds_dynamic_array_get_ref(&cfg->blocks, b, (void **)&block);
+    return block;
+}
+
+// the index of a local in tac->locals, -1 for formals, attributes and self
+int codegen_tac_local_index(tac_result *tac, const char *name) {
+    tac_local *local = codegen_tac_find_local(tac, name);
+    if (local == NULL) {
+        return -1;
+    }
+
+    return local - (tac_local *)tac->locals.items;
+}
+
+// the block that starts with the label, -1 if there is none
+int codegen_tac_label_block(tac_cfg *cfg, const char *label) {
+    for (size_t b = 0; b < cfg->blocks.count; b++) {
+        tac_basic_block *block = NULL;
+        ds_dynamic_array_get_ref(&cfg->blocks, b, (void **)&block);
+
+        tac_instr *instr = NULL;
+        ds_dynamic_array_get_ref(&cfg->tac->instrs, block->first,
+                                 (void **)&instr);
+
+        if (instr->kind == TAC_LABEL && strcmp(instr->label.label, label) == 0) {
+            return b;
+        }
+    }
+
+    return -1;
+}
+
+// the locals read and written by every instruction
+static void tac_uses_defs(tac_result *tac, size_t words, uint64_t *use,
+                          uint64_t *def) {
+    for (size_t i = 0; i < tac->instrs.count; i++) {
+        tac_instr *instr = NULL;
+        ds_dynamic_array_get_ref(&tac->instrs, i, (void **)&instr);
+
+        ds_dynamic_array uses;
+        codegen_tac_instr_uses(instr, &uses);
+        for (size_t j = 0; j < uses.count; j++) {
+            char **operand = NULL;
+            ds_dynamic_array_get(&uses, j, &operand);
+
+            int v = codegen_tac_local_index(tac, *operand);
+            if (v >= 0) {
+                tac_set_add(use + i * words, v);
+            }
+        }
+        ds_dynamic_array_free(&uses);
+
+        char **ident = codegen_tac_instr_def(instr);
+        if (ident != NULL) {
+            int v = codegen_tac_local_index(tac, *ident);
+            if (v >= 0) {
+                tac_set_add(def + i * words, v);
+            }
+        }
+    }
+}
+
+// the liveness before and after every instruction
+void codegen_tac_liveness(tac_cfg *cfg, tac_liveness *liveness) {
+    tac_result *tac = cfg->tac;
+    size_t n = tac->instrs.count;
+    size_t words = tac_set_words(tac->locals.count);
+    size_t blocks = cfg->blocks.count;
+
+    liveness->words = words;
+    liveness->in = calloc(n * words + 1, sizeof(uint64_t));
+    liveness->out = calloc(n * words + 1, sizeof(uint64_t));
+
+    uint64_t *use = calloc(n * words + 1, sizeof(uint64_t));
+    uint64_t *def = calloc(n * words + 1, sizeof(uint64_t));
+    tac_uses_defs(tac, words, use, def);
+
+    uint64_t *block_in = calloc(blocks * words + 1, sizeof(uint64_t));
+    uint64_t *set = calloc(words + 1, sizeof(uint64_t));
+
+    int changed = 1;
+    while (changed) {
+        changed = 0;
+
+        for (size_t k = 0; k < blocks; k++) {
+            size_t b = blocks - k - 1;
+
+            tac_basic_block *block = NULL;
+            ds_dynamic_array_get_ref(&cfg->blocks, b, (void **)&block);
+
+            memset(set, 0, words * sizeof(uint64_t));
+            for (size_t s = 0; s < block->successors.count; s++) {
+                size_t successor = 0;
+                ds_dynamic_array_get(&block->successors, s, &successor);
+
+                for (size_t w = 0; w < words; w++) {
+                    set[w] |= block_in[successor * words + w];
+                }
+            }
+
+            // in <- use + (out - def), from the last instruction back
+            for (size_t i = block->last; i > block->first; i--) {
+                uint64_t *out = liveness->out + (i - 1) * words;
+                uint64_t *in = liveness->in + (i - 1) * words;
+
+                memcpy(out, set, words * sizeof(uint64_t));
+                for (size_t w = 0; w < words; w++) {
+                    set[w] = use[(i - 1) * words + w] |
+                             (set[w] & ~def[(i - 1) * words + w]);
+                }
+                memcpy(in, set, words * sizeof(uint64_t));
+            }
+
+            if (memcmp(block_in + b * words, set, words * sizeof(uint64_t)) !=
+                0) {
+                memcpy(block_in + b * words, set, words * sizeof(uint64_t));
+                changed = 1;
+            }
+        }
+    }
+
+    free(set);
+    free(block_in);
+    free(use);
+    free(def);
+}
+
+void codegen_tac_liveness_free(tac_liveness *liveness) {
+    free(liveness->in);
+    free(liveness->out);
+}
+
+// the definitions reaching the instruction after i, given the ones
+// reaching i
+void codegen_tac_reaching_step(tac_cfg *cfg, tac_reaching *reaching,
+                               size_t i, uint64_t *set) {
+    (void)cfg;
+
+    int v = reaching->local_of[i];
+    if (v < 0) {
+        return;
+    }
+
+    uint64_t *defs = reaching->defs + v * reaching->words;
+    for (size_t w = 0; w < reaching->words; w++) {
+        set[w] &= ~defs[w];
+    }
+    tac_set_add(set, i);
+}
+
+void codegen_tac_reaching(tac_cfg *cfg, tac_reaching *reaching) {
+    tac_result *tac = cfg->tac;
+    size_t n = tac->instrs.count;
+    size_t words = tac_set_words(n);
+    size_t blocks = cfg->blocks.count;
+
+    reaching->words = words;
+    reaching->in = calloc(blocks * words + 1, sizeof(uint64_t));
+    reaching->out = calloc(blocks * words + 1, sizeof(uint64_t));
+    reaching->defs = calloc(tac->locals.count * words + 1, sizeof(uint64_t));
+    reaching->local_of = malloc(sizeof(int) * (n + 1));
+
+    for (size_t i = 0; i < n; i++) {
+        tac_instr *instr = NULL;
+        ds_dynamic_array_get_ref(&tac->instrs, i, (void **)&instr);
+
+        char **ident = codegen_tac_instr_def(instr);
+        int v = ident != NULL ? codegen_tac_local_index(tac, *ident) : -1;
+
+        reaching->local_of[i] = v;
+        if (v >= 0) {
+            tac_set_add(reaching->defs + v * words, i);
+        }
+    }
+
+    uint64_t *set = calloc(words + 1, sizeof(uint64_t));
+
+    int changed = 1;
+    while (changed) {
+        changed = 0;
+
+        for (size_t b = 0; b < blocks; b++) {
+            tac_basic_block *block = NULL;
+            ds_dynamic_array_get_ref(&cfg->blocks, b, (void **)&block);
+
+            uint64_t *in = reaching->in + b * words;
+            memset(in, 0, words * sizeof(uint64_t));
+            for (size_t p = 0; p < block->predecessors.count; p++) {
+                size_t predecessor = 0;
+                ds_dynamic_array_get(&block->predecessors, p, &predecessor);
+
+                for (size_t w = 0; w < words; w++) {
+                    in[w] |= reaching->out[predecessor * words + w];
+                }
+            }
+
+            memcpy(set, in, words * sizeof(uint64_t));
+            for (size_t i = block->first; i < block->last; i++) {
+                codegen_tac_reaching_step(cfg, reaching, i, set);
+            }
+
+            uint64_t *out = reaching->out + b * words;
+            if (memcmp(out, set, words * sizeof(uint64_t)) != 0) {
+                memcpy(out, set, words * sizeof(uint64_t));
+                changed = 1;
+            }
+        }
+    }
+
+    free(set);
+}
+
+void codegen_tac_reaching_free(tac_reaching *reaching) {
+    free(reaching->in);
+    free(reaching->out);
+    free(reaching->defs);
+    free(reaching->local_of);
+}
+
+static void tac_postorder(tac_cfg *cfg, size_t b, int *visited,
+                          ds_dynamic_array *order) {
+    visited[b] = 1;
+
+    tac_basic_block *block = NULL;
+    ds_dynamic_array_get_ref(&cfg->blocks, b, (void **)&block);
+
+    for (size_t s = 0; s < block->successors.count; s++) {
+        size_t successor = 0;
+        ds_dynamic_array_get(&block->successors, s, &successor);
+
+        if (!visited[successor]) {
+            tac_postorder(cfg, successor, visited, order);
+        }
+    }
+
+    ds_dynamic_array_append(order, &b);
+}
+
+static int tac_intersect(int *idom, int *rpo, int a, int b) {
+    while (a != b) {
+        while (rpo[a] > rpo[b]) {
+            a = idom[a];
+        }
+        while (rpo[b] > rpo[a]) {
+            b = idom[b];
+        }
+    }
+
+    return a;
+}
+
+// the dominators by the iterative algorithm of Cooper, Harvey and Kennedy
+void codegen_tac_dominators(tac_cfg *cfg, tac_dominators *dominators) {
+    size_t blocks = cfg->blocks.count;
+
+    dominators->blocks = blocks;
+    dominators->idom = malloc(sizeof(int) * (blocks + 1));
+    dominators->rpo = malloc(sizeof(int) * (blocks + 1));
+    dominators->children = malloc(sizeof(ds_dynamic_array) * (blocks + 1));
+    for (size_t b = 0; b < blocks; b++) {
+        dominators->idom[b] = -1;
+        dominators->rpo[b] = -1;
+        ds_dynamic_array_init(&dominators->children[b], sizeof(size_t));
+    }
+
+    if (blocks == 0) {
+        return;
+    }
+
+    int *visited = calloc(blocks + 1, sizeof(int));
+    ds_dynamic_array order; // size_t, postorder
+    ds_dynamic_array_init(&order, sizeof(size_t));
+    tac_postorder(cfg, 0, visited, &order);
+
+    int *idom = dominators->idom;
+    int *rpo = dominators->rpo;
+    for (size_t i = 0; i < order.count; i++) {
+        size_t b = 0;
+        ds_dynamic_array_get(&order, i, &b);
+        rpo[b] = order.count - i - 1;
+    }
+    idom[0] = 0;
+
+    int changed = 1;
+    while (changed) {
+        changed = 0;
+
+        for (size_t k = order.count; k > 0; k--) {
+            size_t b = 0;
+            ds_dynamic_array_get(&order, k - 1, &b);
+            if (b == 0) {
+                continue;
+            }
+
+            tac_basic_block *block = NULL;
+            ds_dynamic_array_get_ref(&cfg->blocks, b, (void **)&block);
+
+            int dominator = -1;
+            for (size_t p = 0; p < block->predecessors.count; p++) {
+                size_t predecessor = 0;
+                ds_dynamic_array_get(&block->predecessors, p, &predecessor);
+
+                if (idom[predecessor] < 0) {
+                    continue;
+                }
+
+                dominator = dominator < 0 ? (int)predecessor
+                                          : tac_intersect(idom, rpo,
+                                                          predecessor,
+                                                          dominator);
+            }
+
+            if (idom[b] != dominator) {
+                idom[b] = dominator;
+                changed = 1;
+            }
+        }
+    }
+
+    idom[0] = -1;
+    for (size_t b = 1; b < blocks; b++) {
+        if (idom[b] >= 0) {
+            ds_dynamic_array_append(&dominators->children[idom[b]], &b);
+        }
+    }
+
+    free(visited);
+    ds_dynamic_array_free(&order);
+}
+
+// a dominates b, every block dominates itself
+int codegen_tac_dominates(tac_dominators *dominators, size_t a, size_t b) {
+    for (int d = b; d >= 0; d = dominators->idom[d]) {
+        if ((size_t)d == a) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+void codegen_tac_dominators_free(tac_dominators *dominators) {
+    for (size_t b = 0; b < dominators->blocks; b++) {
+        ds_dynamic_array_free(&dominators->children[b]);
+    }
+
+    free(dominators->children);
+    free(dominators->rpo);
+    free(dominators->idom);
+}
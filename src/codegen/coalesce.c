@@ -0,0 +1,215 @@
+#include "codegen.h"
+#include "ds.h"
+
+// Copy propagation by coalescing. The two sides of a copy `x <- y` between
+// locals of the same type become one local when they do not interfere,
+// that is when neither is written while the other one holds a different
+// value; the copy is then `x <- x` and is dropped. This covers propagating
+// a copy into the uses of its destination as well as writing a result
+// straight into the variable it is copied to, like `s <- s + i`.
+
+typedef struct tac_coalesce_context {
+        tac_result *tac;
+        size_t words;
+        uint64_t *interferes; // a set of locals for every local
+        int *parent;          // union find of the merged locals
+} tac_coalesce_context;
+
+static int tac_coalesce_find(tac_coalesce_context *context, int v) {
+    while (context->parent[v] != v) {
+        context->parent[v] = context->parent[context->parent[v]];
+        v = context->parent[v];
+    }
+
+    return v;
+}
+
+static void tac_interfere(tac_coalesce_context *context, int v, int w) {
+    if (v == w) {
+        return;
+    }
+
+    tac_set_add(context->interferes + v * context->words, w);
+    tac_set_add(context->interferes + w * context->words, v);
+}
+
+// the local copied by a copy instruction, -1 if it is not one
+static int tac_copy_source(tac_result *tac, tac_instr *instr) {
+    switch (instr->kind) {
+    case TAC_ASSIGN_VALUE:
+        return codegen_tac_local_index(tac, instr->assign_value.expr);
+    case TAC_CAST:
+        return codegen_tac_local_index(tac, instr->cast.expr);
+    default:
+        return -1;
+    }
+}
+
+// a local interferes with the ones that are live where it is written, but
+// not with the source of a copy into it
+static void tac_build_interference(tac_coalesce_context *context) {
+    tac_result *tac = context->tac;
+
+    tac_cfg cfg;
+    codegen_tac_cfg_build(tac, &cfg);
+
+    tac_liveness liveness;
+    codegen_tac_liveness(&cfg, &liveness);
+
+    for (size_t i = 0; i < tac->instrs.count; i++) {
+        tac_instr *instr = NULL;
+        ds_dynamic_array_get_ref(&tac->instrs, i, (void **)&instr);
+
+        char **ident = codegen_tac_instr_def(instr);
+        int v = ident != NULL ? codegen_tac_local_index(tac, *ident) : -1;
+        if (v < 0) {
+            continue;
+        }
+
+        int source = tac_copy_source(tac, instr);
+        uint64_t *out = liveness.out + i * liveness.words;
+        for (size_t w = 0; w < tac->locals.count; w++) {
+            if ((int)w != source && tac_set_has(out, w)) {
+                tac_interfere(context, v, w);
+            }
+        }
+    }
+
+    // the locals that are read before they are written hold whatever was
+    // there at the start, so they can not share a place either
+    for (size_t v = 0; tac->instrs.count > 0 && v < tac->locals.count; v++) {
+        if (!tac_set_has(liveness.in, v)) {
+            continue;
+        }
+
+        for (size_t w = 0; w < tac->locals.count; w++) {
+            tac_interfere(context, v, w);
+        }
+    }
+
+    codegen_tac_liveness_free(&liveness);
+    codegen_tac_cfg_free(&cfg);
+}
+
+static int tac_same_type(tac_result *tac, int v, int w) {
+    tac_local *lhs = NULL;
+    tac_local *rhs = NULL;
+    ds_dynamic_array_get_ref(&tac->locals, v, (void **)&lhs);
+    ds_dynamic_array_get_ref(&tac->locals, w, (void **)&rhs);
+
+    if (lhs->unboxed != rhs->unboxed) {
+        return 0;
+    }
+
+    if (lhs->type == NULL || rhs->type == NULL) {
+        return lhs->type == rhs->type;
+    }
+
+    return strcmp(lhs->type, rhs->type) == 0;
+}
+
+// merge w into v, v keeps the interferences of both
+static void tac_merge(tac_coalesce_context *context, int v, int w) {
+    size_t words = context->words;
+    uint64_t *set = context->interferes + w * words;
+
+    for (size_t u = 0; u < context->tac->locals.count; u++) {
+        if (tac_set_has(set, u)) {
+            tac_interfere(context, v, u);
+        }
+    }
+
+    context->parent[w] = v;
+}
+
+static void tac_rename(tac_coalesce_context *context, char **operand) {
+    tac_result *tac = context->tac;
+
+    int v = codegen_tac_local_index(tac, *operand);
+    if (v < 0) {
+        return;
+    }
+
+    tac_local *local = NULL;
+    ds_dynamic_array_get_ref(&tac->locals, tac_coalesce_find(context, v),
+                             (void **)&local);
+    *operand = local->name;
+}
+
+void codegen_tac_coalesce_copies(tac_result *tac) {
+    codegen_tac_from_ssa(tac);
+
+    size_t locals = tac->locals.count;
+    if (locals == 0) {
+        return;
+    }
+
+    tac_coalesce_context context = {.tac = tac,
+                                    .words = tac_set_words(locals)};
+    context.interferes = calloc(locals * context.words + 1, sizeof(uint64_t));
+    context.parent = malloc(sizeof(int) * locals);
+    for (size_t v = 0; v < locals; v++) {
+        context.parent[v] = v;
+    }
+
+    tac_build_interference(&context);
+
+    for (size_t i = 0; i < tac->instrs.count; i++) {
+        tac_instr *instr = NULL;
+        ds_dynamic_array_get_ref(&tac->instrs, i, (void **)&instr);
+
+        int source = tac_copy_source(tac, instr);
+        if (source < 0) {
+            continue;
+        }
+
+        int dest = codegen_tac_local_index(tac, *codegen_tac_instr_def(instr));
+        if (dest < 0 || !tac_same_type(tac, dest, source)) {
+            continue;
+        }
+
+        int v = tac_coalesce_find(&context, dest);
+        int w = tac_coalesce_find(&context, source);
+        if (v != w && !tac_set_has(context.interferes + v * context.words, w)) {
+            tac_merge(&context, v, w);
+        }
+    }
+
+    ds_dynamic_array instrs;
+    ds_dynamic_array_init(&instrs, sizeof(tac_instr));
+
+    for (size_t i = 0; i < tac->instrs.count; i++) {
+        tac_instr *instr = NULL;
+        ds_dynamic_array_get_ref(&tac->instrs, i, (void **)&instr);
+
+        ds_dynamic_array uses;
+        codegen_tac_instr_uses(instr, &uses);
+        for (size_t j = 0; j < uses.count; j++) {
+            char **operand = NULL;
+            ds_dynamic_array_get(&uses, j, &operand);
+            tac_rename(&context, operand);
+        }
+        ds_dynamic_array_free(&uses);
+
+        char **ident = codegen_tac_instr_def(instr);
+        if (ident != NULL) {
+            tac_rename(&context, ident);
+        }
+
+        int source = tac_copy_source(tac, instr);
+        if (source >= 0 && ident != NULL &&
+            codegen_tac_local_index(tac, *ident) == source) {
+            continue;
+        }
+
+        ds_dynamic_array_append(&instrs, instr);
+    }
+
+    ds_dynamic_array_free(&tac->instrs);
+    tac->instrs = instrs;
+
+    free(context.parent);
+    free(context.interferes);
+
+    codegen_tac_pack_slots(tac);
+}
@@ -8,7 +8,7 @@ typedef struct tac_context {
         int result;
         int temp_count;
         int label_count;
-        ds_dynamic_array locals; // char *
+        ds_dynamic_array locals; // tac_local
 
         ds_dynamic_array mapping; // tac_assign_value
         semantic_mapping *semantic_mapping;
@@ -20,7 +20,26 @@ static void tac_new_var(tac_context *context, char **ident) {
     *ident = malloc(needed);
     snprintf(*ident, needed, "$t%d", context->temp_count++);
 
-    ds_dynamic_array_append(&context->locals, *ident);
+    tac_local local = {.name = *ident,
+                       .type = NULL,
+                       .unboxed = 0,
+                       .reg = NULL,
+                       .slot = context->locals.count};
+    ds_dynamic_array_append(&context->locals, &local);
+}
+
+static void tac_set_type(tac_context *context, char *ident, const char *type) {
+    for (size_t i = 0; i < context->locals.count; i++) {
+        tac_local *local = NULL;
+        ds_dynamic_array_get_ref(&context->locals, i, (void **)&local);
+
+        if (local->name == ident) {
+            if (local->type == NULL) {
+                local->type = type;
+            }
+            return;
+        }
+    }
 }
 
 static void tac_new_label(tac_context *context, char **label) {
@@ -250,6 +269,7 @@ static void tac_loop(tac_context *context, loop_node *loop,
 
     char *not_predicate_ident;
     tac_new_var(context, &not_predicate_ident);
+    tac_set_type(context, not_predicate_ident, "Bool");
     tac_instr not_predicate = {
         .kind = TAC_ASSIGN_NOT,
         .assign_unary =
@@ -334,6 +354,7 @@ static void tac_let(tac_context *context, let_node *let,
         } else {
             char *ident;
             tac_new_var(context, &ident);
+            tac_set_type(context, ident, let_init.type.value);
             tac_assign_new assign = {
                 .ident = ident,
                 .type = let_init.type.value,
@@ -345,6 +366,7 @@ static void tac_let(tac_context *context, let_node *let,
 
         char *ident;
         tac_new_var(context, &ident);
+        tac_set_type(context, ident, let_init.type.value);
         tac_instr instr = {
             .kind = TAC_ASSIGN_VALUE,
             .assign_value =
@@ -409,6 +431,7 @@ static void tac_case(tac_context *context, case_node *case_,
 
         char *ident;
         tac_new_var(context, &ident);
+        tac_set_type(context, ident, "Bool");
 
         char *case_label;
         tac_new_label(context, &case_label);
@@ -464,6 +487,7 @@ static void tac_case(tac_context *context, case_node *case_,
 
         char *branch_ident = NULL;
         tac_new_var(context, &branch_ident);
+        tac_set_type(context, branch_ident, branch.type.value);
         tac_instr cast_instr = {
             .kind = TAC_CAST,
             .cast =
@@ -698,8 +722,8 @@ static void tac_null(tac_context *context, expr_null *null,
     result->ident.name = ident;
 }
 
-static void tac_expr(tac_context *context, expr_node *expr,
-                     ds_dynamic_array *instrs, tac_instr *result) {
+static void tac_expr_kind(tac_context *context, expr_node *expr,
+                          ds_dynamic_array *instrs, tac_instr *result) {
     switch (expr->kind) {
     case EXPR_ASSIGN:
         return tac_assign(context, &expr->assign, instrs, result);
@@ -759,9 +783,19 @@ static void tac_expr(tac_context *context, expr_node *expr,
     }
 }
 
+static void tac_expr(tac_context *context, expr_node *expr,
+                     ds_dynamic_array *instrs, tac_instr *result) {
+    tac_expr_kind(context, expr, instrs, result);
+
+    // the temporary holding the result has the static type of the expression
+    if (result->kind == TAC_IDENT) {
+        tac_set_type(context, result->ident.name, expr->type);
+    }
+}
+
 int codegen_expr_to_tac(semantic_mapping *mapping, const expr_node *expr, tac_result *tac) {
     tac_context context = {.result = 0, .temp_count = 0, .label_count = 0, .semantic_mapping = mapping};
-    ds_dynamic_array_init(&context.locals, sizeof(char *));
+    ds_dynamic_array_init(&context.locals, sizeof(tac_local));
     ds_dynamic_array_init(&context.mapping, sizeof(tac_assign_value));
 
     ds_dynamic_array_init(&tac->instrs, sizeof(tac_instr));
@@ -770,7 +804,427 @@ int codegen_expr_to_tac(semantic_mapping *mapping, const expr_node *expr, tac_re
     tac_expr(&context, (expr_node *)expr, &tac->instrs, &result);
 
     ds_dynamic_array_append(&tac->instrs, &result);
-    ds_dynamic_array_copy(&context.locals, &tac->locals);
+    tac->locals = context.locals;
+    tac->label_count = context.label_count;
+    tac->ssa = 0;
 
     return context.result;
 }
+
+char *codegen_tac_new_local(tac_result *tac, const char *type, int unboxed) {
+    int needed = snprintf(NULL, 0, "$t%d", tac->locals.count) + 1;
+
+    char *ident = malloc(needed);
+    snprintf(ident, needed, "$t%d", tac->locals.count);
+
+    // the slots can be packed, so the new one goes after all of them
+    int slot = 0;
+    for (size_t i = 0; i < tac->locals.count; i++) {
+        tac_local *local = NULL;
+        ds_dynamic_array_get_ref(&tac->locals, i, (void **)&local);
+
+        if (local->slot + 1 > slot) {
+            slot = local->slot + 1;
+        }
+    }
+
+    tac_local local = {.name = ident,
+                       .type = type,
+                       .unboxed = unboxed,
+                       .reg = NULL,
+                       .slot = slot};
+    ds_dynamic_array_append(&tac->locals, &local);
+
+    return ident;
+}
+
+// give a stack slot only to the locals that are still used after a pass
+// removed some of them
+void codegen_tac_pack_slots(tac_result *tac) {
+    int *used = calloc(tac->locals.count + 1, sizeof(int));
+
+    for (size_t i = 0; i < tac->instrs.count; i++) {
+        tac_instr *instr = NULL;
+        ds_dynamic_array_get_ref(&tac->instrs, i, (void **)&instr);
+
+        ds_dynamic_array uses;
+        codegen_tac_instr_uses(instr, &uses);
+        for (size_t j = 0; j < uses.count; j++) {
+            char **operand = NULL;
+            ds_dynamic_array_get(&uses, j, &operand);
+
+            int v = codegen_tac_local_index(tac, *operand);
+            if (v >= 0) {
+                used[v] = 1;
+            }
+        }
+        ds_dynamic_array_free(&uses);
+
+        char **ident = codegen_tac_instr_def(instr);
+        int v = ident != NULL ? codegen_tac_local_index(tac, *ident) : -1;
+        if (v >= 0) {
+            used[v] = 1;
+        }
+    }
+
+    int slots = 0;
+    for (size_t v = 0; v < tac->locals.count; v++) {
+        tac_local *local = NULL;
+        ds_dynamic_array_get_ref(&tac->locals, v, (void **)&local);
+
+        local->slot = used[v] ? slots++ : -1;
+    }
+
+    free(used);
+}
+
+char *codegen_tac_new_label(tac_result *tac) {
+    int needed = snprintf(NULL, 0, "L%d", tac->label_count) + 1;
+
+    char *label = malloc(needed);
+    snprintf(label, needed, "L%d", tac->label_count++);
+
+    return label;
+}
+
+tac_local *codegen_tac_find_local(tac_result *tac, const char *name) {
+    for (size_t i = 0; i < tac->locals.count; i++) {
+        tac_local *local = NULL;
+        ds_dynamic_array_get_ref(&tac->locals, i, (void **)&local);
+
+        if (strcmp(local->name, name) == 0) {
+            return local;
+        }
+    }
+
+    return NULL;
+}
+
+semantic_mapping_item *codegen_tac_find_class(semantic_mapping *mapping,
+                                              const char *class_name) {
+    for (size_t i = 0; i < mapping->classes.count; i++) {
+        semantic_mapping_item *item = NULL;
+        ds_dynamic_array_get_ref(&mapping->classes, i, (void **)&item);
+
+        if (strcmp(item->class_name, class_name) == 0) {
+            return item;
+        }
+    }
+
+    return NULL;
+}
+
+// the implementation of a method that the class has, its own or inherited
+implementation_mapping_item *
+codegen_tac_find_method(semantic_mapping_item *item, const char *method_name) {
+    for (size_t j = 0; j < item->methods.count; j++) {
+        implementation_mapping_item *method = NULL;
+        ds_dynamic_array_get_ref(&item->methods, j, (void **)&method);
+
+        if (strcmp(method->method_name, method_name) == 0) {
+            return method;
+        }
+    }
+
+    return NULL;
+}
+
+static void tac_add_use(ds_dynamic_array *uses, ds_dynamic_array *reprs,
+                        char **operand, enum tac_repr repr) {
+    ds_dynamic_array_append(uses, &operand);
+    if (reprs != NULL) {
+        ds_dynamic_array_append(reprs, &repr);
+    }
+}
+
+// the variables read by an instruction (char ** into the instruction) and,
+// when reprs is not NULL, the representation each of them is needed in
+void codegen_tac_instr_uses_repr(tac_instr *instr, ds_dynamic_array *uses,
+                                 ds_dynamic_array *reprs) {
+    ds_dynamic_array_init(uses, sizeof(char **));
+    if (reprs != NULL) {
+        ds_dynamic_array_init(reprs, sizeof(enum tac_repr));
+    }
+
+    switch (instr->kind) {
+    case TAC_JUMP_IF_TRUE:
+        tac_add_use(uses, reprs, &instr->jump_if_true.expr, TAC_REPR_RAW);
+        break;
+    case TAC_ASSIGN_ISINSTANCE:
+        tac_add_use(uses, reprs, &instr->isinstance.expr, TAC_REPR_BOXED);
+        break;
+    case TAC_CAST:
+        tac_add_use(uses, reprs, &instr->cast.expr, TAC_REPR_BOXED);
+        break;
+    case TAC_ASSIGN_VALUE:
+        tac_add_use(uses, reprs, &instr->assign_value.expr, TAC_REPR_COPY);
+        break;
+    case TAC_DISPATCH_CALL:
+        tac_add_use(uses, reprs, &instr->dispatch_call.expr, TAC_REPR_BOXED);
+        for (size_t i = 0; i < instr->dispatch_call.args.count; i++) {
+            char **operand = NULL;
+            ds_dynamic_array_get_ref(&instr->dispatch_call.args, i,
+                                     (void **)&operand);
+            tac_add_use(uses, reprs, operand, TAC_REPR_BOXED);
+        }
+        break;
+    case TAC_ASSIGN_ADD:
+    case TAC_ASSIGN_SUB:
+    case TAC_ASSIGN_MUL:
+    case TAC_ASSIGN_DIV:
+    case TAC_ASSIGN_LT:
+    case TAC_ASSIGN_LE:
+        tac_add_use(uses, reprs, &instr->assign_binary.lhs, TAC_REPR_RAW);
+        tac_add_use(uses, reprs, &instr->assign_binary.rhs, TAC_REPR_RAW);
+        break;
+    case TAC_ASSIGN_EQ: {
+        enum tac_repr repr =
+            codegen_tac_eq_kind(instr->assign_eq.type) == TAC_EQ_VALUE
+                ? TAC_REPR_RAW
+                : TAC_REPR_BOXED;
+        tac_add_use(uses, reprs, &instr->assign_eq.lhs, repr);
+        tac_add_use(uses, reprs, &instr->assign_eq.rhs, repr);
+        break;
+    }
+    case TAC_ASSIGN_ISVOID:
+        tac_add_use(uses, reprs, &instr->assign_unary.expr, TAC_REPR_BOXED);
+        break;
+    case TAC_ASSIGN_NEG:
+    case TAC_ASSIGN_NOT:
+        tac_add_use(uses, reprs, &instr->assign_unary.expr, TAC_REPR_RAW);
+        break;
+    case TAC_IDENT:
+        tac_add_use(uses, reprs, &instr->ident.name, TAC_REPR_BOXED);
+        break;
+    case TAC_BOX:
+        tac_add_use(uses, reprs, &instr->box.expr, TAC_REPR_RAW);
+        break;
+    case TAC_UNBOX:
+        tac_add_use(uses, reprs, &instr->unbox.expr, TAC_REPR_BOXED);
+        break;
+    case TAC_JUMP_IF_COND: {
+        // the void tests look at the object, the comparisons at the value
+        enum tac_repr repr = instr->jump_if_cond.rhs == NULL
+                                 ? TAC_REPR_BOXED
+                                 : TAC_REPR_RAW;
+        tac_add_use(uses, reprs, &instr->jump_if_cond.lhs, repr);
+        if (instr->jump_if_cond.rhs != NULL) {
+            tac_add_use(uses, reprs, &instr->jump_if_cond.rhs, repr);
+        }
+        break;
+    }
+    case TAC_JUMP_CASE:
+        tac_add_use(uses, reprs, &instr->jump_case.expr, TAC_REPR_BOXED);
+        break;
+    case TAC_ATTR_LOAD:
+        tac_add_use(uses, reprs, &instr->attr.object, TAC_REPR_BOXED);
+        break;
+    case TAC_ATTR_STORE:
+        tac_add_use(uses, reprs, &instr->attr.object, TAC_REPR_BOXED);
+        tac_add_use(uses, reprs, &instr->attr.ident, TAC_REPR_BOXED);
+        break;
+    case TAC_PHI:
+        for (size_t i = 0; i < instr->phi.args.count; i++) {
+            tac_phi_arg *arg = NULL;
+            ds_dynamic_array_get_ref(&instr->phi.args, i, (void **)&arg);
+            if (arg->value != NULL) {
+                tac_add_use(uses, reprs, &arg->value, TAC_REPR_COPY);
+            }
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+void codegen_tac_instr_uses(tac_instr *instr, ds_dynamic_array *uses) {
+    codegen_tac_instr_uses_repr(instr, uses, NULL);
+}
+
+// the variable written by an instruction, NULL if there is none, and the
+// representation of the value it writes
+char **codegen_tac_instr_def_repr(tac_instr *instr, enum tac_repr *repr) {
+    *repr = TAC_REPR_RAW;
+
+    switch (instr->kind) {
+    case TAC_ASSIGN_ISINSTANCE:
+        return &instr->isinstance.ident;
+    case TAC_CAST:
+        *repr = TAC_REPR_BOXED;
+        return &instr->cast.ident;
+    case TAC_ASSIGN_VALUE:
+        *repr = TAC_REPR_COPY;
+        return &instr->assign_value.ident;
+    case TAC_DISPATCH_CALL:
+        *repr = TAC_REPR_BOXED;
+        return &instr->dispatch_call.ident;
+    case TAC_ASSIGN_NEW:
+        *repr = TAC_REPR_BOXED;
+        return &instr->assign_new.ident;
+    case TAC_ASSIGN_DEFAULT:
+        *repr = codegen_tac_is_value_type(instr->assign_default.type)
+                    ? TAC_REPR_FREE
+                    : TAC_REPR_BOXED;
+        return &instr->assign_default.ident;
+    case TAC_ASSIGN_ISVOID:
+    case TAC_ASSIGN_NEG:
+    case TAC_ASSIGN_NOT:
+        return &instr->assign_unary.ident;
+    case TAC_ASSIGN_ADD:
+    case TAC_ASSIGN_SUB:
+    case TAC_ASSIGN_MUL:
+    case TAC_ASSIGN_DIV:
+    case TAC_ASSIGN_LT:
+    case TAC_ASSIGN_LE:
+        return &instr->assign_binary.ident;
+    case TAC_ASSIGN_EQ:
+        if (codegen_tac_eq_kind(instr->assign_eq.type) == TAC_EQ_DISPATCH) {
+            *repr = TAC_REPR_BOXED;
+        }
+        return &instr->assign_eq.ident;
+    case TAC_ASSIGN_INT:
+        *repr = TAC_REPR_FREE;
+        return &instr->assign_int.ident;
+    case TAC_ASSIGN_STRING:
+        *repr = TAC_REPR_BOXED;
+        return &instr->assign_string.ident;
+    case TAC_ASSIGN_BOOL:
+        *repr = TAC_REPR_FREE;
+        return &instr->assign_bool.ident;
+    case TAC_BOX:
+        *repr = TAC_REPR_BOXED;
+        return &instr->box.ident;
+    case TAC_UNBOX:
+        return &instr->unbox.ident;
+    case TAC_ATTR_LOAD:
+        *repr = TAC_REPR_BOXED;
+        return &instr->attr.ident;
+    case TAC_PHI:
+        *repr = TAC_REPR_COPY;
+        return &instr->phi.ident;
+    default:
+        *repr = TAC_REPR_NONE;
+        return NULL;
+    }
+}
+
+char **codegen_tac_instr_def(tac_instr *instr) {
+    enum tac_repr repr;
+    return codegen_tac_instr_def_repr(instr, &repr);
+}
+
+// instructions that call into other code and may clobber the caller saved
+// registers (and run the garbage collector)
+int codegen_tac_instr_is_call(tac_instr *instr) {
+    switch (instr->kind) {
+    case TAC_DISPATCH_CALL:
+        return 1;
+    // a new Int, Bool or String or of a stateless class is a constant and a
+    // Bool is boxed without a call
+    case TAC_ASSIGN_NEW:
+        return !codegen_tac_is_basic_class(instr->assign_new.type) &&
+               !instr->assign_new.shared;
+    case TAC_BOX:
+        return strcmp(instr->box.type, "Bool") != 0;
+    case TAC_ASSIGN_EQ:
+        return codegen_tac_eq_kind(instr->assign_eq.type) == TAC_EQ_DISPATCH;
+    default:
+        return 0;
+    }
+}
+
+// the labels an instruction can jump to (char ** into the instruction)
+void codegen_tac_instr_targets(tac_instr *instr, ds_dynamic_array *labels) {
+    ds_dynamic_array_init(labels, sizeof(char **));
+
+    char **label = NULL;
+    switch (instr->kind) {
+    case TAC_JUMP:
+        label = &instr->jump.label;
+        ds_dynamic_array_append(labels, &label);
+        break;
+    case TAC_JUMP_IF_TRUE:
+        label = &instr->jump_if_true.label;
+        ds_dynamic_array_append(labels, &label);
+        break;
+    case TAC_JUMP_IF_COND:
+        label = &instr->jump_if_cond.label;
+        ds_dynamic_array_append(labels, &label);
+        break;
+    case TAC_JUMP_CASE:
+        for (size_t i = 0; i < instr->jump_case.branches.count; i++) {
+            tac_case_branch *branch = NULL;
+            ds_dynamic_array_get_ref(&instr->jump_case.branches, i,
+                                     (void **)&branch);
+            label = &branch->label;
+            ds_dynamic_array_append(labels, &label);
+        }
+        label = &instr->jump_case.default_label;
+        ds_dynamic_array_append(labels, &label);
+        break;
+    default:
+        break;
+    }
+}
+
+// whether the next instruction can run after this one
+int codegen_tac_instr_falls_through(tac_instr *instr) {
+    return instr->kind != TAC_JUMP && instr->kind != TAC_JUMP_CASE;
+}
+
+const char *codegen_tac_cond_name(enum tac_cond cond) {
+    switch (cond) {
+    case TAC_COND_LT:
+        return "<";
+    case TAC_COND_LE:
+        return "<=";
+    case TAC_COND_GE:
+        return ">=";
+    case TAC_COND_GT:
+        return ">";
+    case TAC_COND_EQ:
+        return "=";
+    case TAC_COND_NE:
+        return "!=";
+    case TAC_COND_VOID:
+        return "isvoid";
+    case TAC_COND_NOT_VOID:
+        return "not isvoid";
+    }
+
+    return NULL;
+}
+
+// Int, Bool and String: their objects hold a raw value instead of
+// attributes, and a new one is the default value of the class
+int codegen_tac_is_basic_class(const char *type) {
+    return type != NULL &&
+           (strcmp(type, "Int") == 0 || strcmp(type, "Bool") == 0 ||
+            strcmp(type, "String") == 0);
+}
+
+// Int and Bool: the values that can be kept raw instead of boxed
+int codegen_tac_is_value_type(const char *type) {
+    return type != NULL &&
+           (strcmp(type, "Int") == 0 || strcmp(type, "Bool") == 0);
+}
+
+enum tac_eq_kind codegen_tac_eq_kind(const char *type) {
+    if (type == NULL) {
+        return TAC_EQ_DISPATCH;
+    }
+
+    if (strcmp(type, "Int") == 0 || strcmp(type, "Bool") == 0) {
+        return TAC_EQ_VALUE;
+    }
+
+    if (strcmp(type, "Byte") == 0) {
+        return TAC_EQ_BYTE;
+    }
+
+    if (strcmp(type, "String") == 0) {
+        return TAC_EQ_STRING;
+    }
+
+    return TAC_EQ_DISPATCH;
+}
@@ -0,0 +1,384 @@
+#include "codegen.h"
+#include "ds.h"
+#include <limits.h>
+
+// Constant folding and propagation. A forward dataflow over the
+// instructions finds the Int and Bool locals that hold the same constant on
+// every path; the arithmetic, comparisons and copies that only read
+// constants are replaced by `t <- 42` or `t <- true`. The successors of a
+// `bt` on a constant are followed only along the edge that is taken, so the
+// branch becomes a jump (or goes away) and the code that is no longer
+// reachable is removed.
+
+enum tac_const_state {
+    TAC_CONST_UNDEF,  // no definition reaches yet
+    TAC_CONST_KNOWN,  // the same value on every path
+    TAC_CONST_VARYING // not a constant
+};
+
+typedef struct tac_const {
+        enum tac_const_state state;
+        long long value;
+} tac_const;
+
+typedef struct tac_fold_context {
+        tac_result *tac;
+        int *tracked;   // index of each local in a state, -1 if not tracked
+        size_t count;   // tracked locals in a state
+        tac_const *in;  // state before each instruction
+        int *reachable; // instructions reached along taken edges
+} tac_fold_context;
+
+#define state_of(context, i) ((context)->in + (i) * (context)->count)
+
+static int tac_label_index(tac_result *tac, const char *label) {
+    for (size_t i = 0; i < tac->instrs.count; i++) {
+        tac_instr *instr = NULL;
+        ds_dynamic_array_get_ref(&tac->instrs, i, (void **)&instr);
+
+        if (instr->kind == TAC_LABEL && strcmp(instr->label.label, label) == 0) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+// the state slot of a variable, -1 for the ones that are not tracked
+// (formals, attributes, self and locals of other types)
+static int tac_tracked_index(tac_fold_context *context, const char *name) {
+    tac_local *local = codegen_tac_find_local(context->tac, name);
+    if (local == NULL) {
+        return -1;
+    }
+
+    return context->tracked[local - (tac_local *)context->tac->locals.items];
+}
+
+static tac_const tac_const_lookup(tac_fold_context *context, tac_const *state,
+                                  const char *name) {
+    int index = tac_tracked_index(context, name);
+    if (index < 0) {
+        return (tac_const){.state = TAC_CONST_VARYING};
+    }
+
+    return state[index];
+}
+
+static tac_const tac_const_known(long long value) {
+    // the values must fit the immediate of `t <- n`
+    if (value < INT_MIN || value > INT_MAX) {
+        return (tac_const){.state = TAC_CONST_VARYING};
+    }
+
+    return (tac_const){.state = TAC_CONST_KNOWN, .value = value};
+}
+
+static tac_const tac_fold_binary(enum tac_kind kind, tac_const lhs,
+                                 tac_const rhs) {
+    if (lhs.state == TAC_CONST_VARYING || rhs.state == TAC_CONST_VARYING) {
+        return (tac_const){.state = TAC_CONST_VARYING};
+    }
+
+    if (lhs.state == TAC_CONST_UNDEF || rhs.state == TAC_CONST_UNDEF) {
+        return (tac_const){.state = TAC_CONST_UNDEF};
+    }
+
+    switch (kind) {
+    case TAC_ASSIGN_ADD:
+        return tac_const_known(lhs.value + rhs.value);
+    case TAC_ASSIGN_SUB:
+        return tac_const_known(lhs.value - rhs.value);
+    case TAC_ASSIGN_MUL:
+        return tac_const_known(lhs.value * rhs.value);
+    case TAC_ASSIGN_DIV:
+        // the division by zero is left to fail at runtime
+        if (rhs.value == 0) {
+            return (tac_const){.state = TAC_CONST_VARYING};
+        }
+        return tac_const_known(lhs.value / rhs.value);
+    case TAC_ASSIGN_LT:
+        return tac_const_known(lhs.value < rhs.value);
+    case TAC_ASSIGN_LE:
+        return tac_const_known(lhs.value <= rhs.value);
+    case TAC_ASSIGN_EQ:
+        return tac_const_known(lhs.value == rhs.value);
+    default:
+        return (tac_const){.state = TAC_CONST_VARYING};
+    }
+}
+
+static tac_const tac_fold_unary(enum tac_kind kind, tac_const expr) {
+    if (expr.state != TAC_CONST_KNOWN) {
+        return expr;
+    }
+
+    switch (kind) {
+    case TAC_ASSIGN_NEG:
+        return tac_const_known(-expr.value);
+    case TAC_ASSIGN_NOT:
+        return tac_const_known(!expr.value);
+    default:
+        return (tac_const){.state = TAC_CONST_VARYING};
+    }
+}
+
+// the value an instruction assigns to its definition
+static tac_const tac_fold_instr(tac_fold_context *context, tac_const *state,
+                                tac_instr *instr) {
+    switch (instr->kind) {
+    case TAC_ASSIGN_INT:
+        return tac_const_known(instr->assign_int.value);
+    case TAC_ASSIGN_BOOL:
+        return tac_const_known(instr->assign_bool.value);
+    case TAC_ASSIGN_DEFAULT:
+        if (codegen_tac_is_value_type(instr->assign_default.type)) {
+            return tac_const_known(0);
+        }
+        break;
+    case TAC_ASSIGN_VALUE:
+        return tac_const_lookup(context, state, instr->assign_value.expr);
+    case TAC_ASSIGN_ADD:
+    case TAC_ASSIGN_SUB:
+    case TAC_ASSIGN_MUL:
+    case TAC_ASSIGN_DIV:
+    case TAC_ASSIGN_LT:
+    case TAC_ASSIGN_LE:
+        return tac_fold_binary(
+            instr->kind,
+            tac_const_lookup(context, state, instr->assign_binary.lhs),
+            tac_const_lookup(context, state, instr->assign_binary.rhs));
+    case TAC_ASSIGN_EQ:
+        if (codegen_tac_eq_kind(instr->assign_eq.type) == TAC_EQ_VALUE) {
+            return tac_fold_binary(
+                instr->kind,
+                tac_const_lookup(context, state, instr->assign_eq.lhs),
+                tac_const_lookup(context, state, instr->assign_eq.rhs));
+        }
+        break;
+    case TAC_ASSIGN_NEG:
+    case TAC_ASSIGN_NOT:
+        return tac_fold_unary(
+            instr->kind,
+            tac_const_lookup(context, state, instr->assign_unary.expr));
+    default:
+        break;
+    }
+
+    return (tac_const){.state = TAC_CONST_VARYING};
+}
+
+static int tac_const_meet(tac_const *into, tac_const value) {
+    if (value.state == TAC_CONST_UNDEF || into->state == TAC_CONST_VARYING) {
+        return 0;
+    }
+
+    if (into->state == TAC_CONST_UNDEF) {
+        *into = value;
+        return 1;
+    }
+
+    if (value.state == TAC_CONST_VARYING || value.value != into->value) {
+        into->state = TAC_CONST_VARYING;
+        return 1;
+    }
+
+    return 0;
+}
+
+// merge the state after an instruction into the state before successor j
+static int tac_flow_into(tac_fold_context *context, tac_const *out, int j) {
+    if (j < 0) {
+        return 0;
+    }
+
+    int changed = !context->reachable[j];
+    context->reachable[j] = 1;
+
+    tac_const *in = state_of(context, j);
+    for (size_t v = 0; v < context->count; v++) {
+        changed |= tac_const_meet(&in[v], out[v]);
+    }
+
+    return changed;
+}
+
+static int tac_flow_instr(tac_fold_context *context, size_t i,
+                          tac_const *out) {
+    tac_result *tac = context->tac;
+
+    tac_instr *instr = NULL;
+    ds_dynamic_array_get_ref(&tac->instrs, i, (void **)&instr);
+
+    memcpy(out, state_of(context, i), context->count * sizeof(tac_const));
+
+    char **ident = codegen_tac_instr_def(instr);
+    if (ident != NULL) {
+        int index = tac_tracked_index(context, *ident);
+        if (index >= 0) {
+            out[index] = tac_fold_instr(context, state_of(context, i), instr);
+        }
+    }
+
+    int changed = 0;
+    if (instr->kind == TAC_JUMP_IF_TRUE) {
+        tac_const cond = tac_const_lookup(context, state_of(context, i),
+                                          instr->jump_if_true.expr);
+        if (cond.state == TAC_CONST_UNDEF) {
+            return 0;
+        }
+
+        if (cond.state == TAC_CONST_VARYING || cond.value) {
+            changed |= tac_flow_into(
+                context, out, tac_label_index(tac, instr->jump_if_true.label));
+        }
+        if ((cond.state == TAC_CONST_VARYING || !cond.value) &&
+            i + 1 < tac->instrs.count) {
+            changed |= tac_flow_into(context, out, i + 1);
+        }
+
+        return changed;
+    }
+
+    ds_dynamic_array labels;
+    codegen_tac_instr_targets(instr, &labels);
+    for (size_t j = 0; j < labels.count; j++) {
+        char **label = NULL;
+        ds_dynamic_array_get(&labels, j, &label);
+
+        changed |= tac_flow_into(context, out, tac_label_index(tac, *label));
+    }
+    ds_dynamic_array_free(&labels);
+
+    if (codegen_tac_instr_falls_through(instr) && i + 1 < tac->instrs.count) {
+        changed |= tac_flow_into(context, out, i + 1);
+    }
+
+    return changed;
+}
+
+// the instruction that replaces instruction i, returns 0 to drop it
+static int tac_fold_rewrite(tac_fold_context *context, size_t i,
+                            tac_instr *result) {
+    tac_result *tac = context->tac;
+    tac_const *state = state_of(context, i);
+
+    ds_dynamic_array_get(&tac->instrs, i, result);
+
+    // the result of the expression is read after the last instruction
+    if (!context->reachable[i]) {
+        return result->kind == TAC_LABEL || result->kind == TAC_IDENT;
+    }
+
+    if (result->kind == TAC_JUMP_IF_TRUE) {
+        tac_const cond =
+            tac_const_lookup(context, state, result->jump_if_true.expr);
+        if (cond.state != TAC_CONST_KNOWN) {
+            return 1;
+        }
+        if (!cond.value) {
+            return 0;
+        }
+
+        char *label = result->jump_if_true.label;
+        result->kind = TAC_JUMP;
+        result->jump.label = label;
+        return 1;
+    }
+
+    switch (result->kind) {
+    case TAC_ASSIGN_VALUE:
+    case TAC_ASSIGN_ADD:
+    case TAC_ASSIGN_SUB:
+    case TAC_ASSIGN_MUL:
+    case TAC_ASSIGN_DIV:
+    case TAC_ASSIGN_NEG:
+    case TAC_ASSIGN_LT:
+    case TAC_ASSIGN_LE:
+    case TAC_ASSIGN_EQ:
+    case TAC_ASSIGN_NOT:
+        break;
+    default:
+        return 1;
+    }
+
+    char *ident = *codegen_tac_instr_def(result);
+    tac_local *local = codegen_tac_find_local(tac, ident);
+    if (local == NULL || tac_tracked_index(context, ident) < 0) {
+        return 1;
+    }
+
+    tac_const value = tac_fold_instr(context, state, result);
+    if (value.state != TAC_CONST_KNOWN) {
+        return 1;
+    }
+
+    if (strcmp(local->type, "Int") == 0) {
+        result->kind = TAC_ASSIGN_INT;
+        result->assign_int.ident = ident;
+        result->assign_int.value = value.value;
+    } else {
+        result->kind = TAC_ASSIGN_BOOL;
+        result->assign_bool.ident = ident;
+        result->assign_bool.value = value.value != 0;
+    }
+
+    return 1;
+}
+
+void codegen_tac_fold_constants(tac_result *tac) {
+    size_t n = tac->instrs.count;
+    if (n == 0) {
+        return;
+    }
+
+    tac_fold_context context = {.tac = tac, .count = 0};
+    context.tracked = malloc(sizeof(int) * (tac->locals.count + 1));
+    for (size_t v = 0; v < tac->locals.count; v++) {
+        tac_local *local = NULL;
+        ds_dynamic_array_get_ref(&tac->locals, v, (void **)&local);
+
+        context.tracked[v] =
+            codegen_tac_is_value_type(local->type) ? (int)context.count++ : -1;
+    }
+
+    if (context.count == 0) {
+        free(context.tracked);
+        return;
+    }
+
+    context.in = calloc(n * context.count, sizeof(tac_const));
+    context.reachable = calloc(n, sizeof(int));
+    context.reachable[0] = 1;
+
+    tac_const *out = malloc(sizeof(tac_const) * context.count);
+
+    int changed = 1;
+    while (changed) {
+        changed = 0;
+
+        for (size_t i = 0; i < n; i++) {
+            if (context.reachable[i]) {
+                changed |= tac_flow_instr(&context, i, out);
+            }
+        }
+    }
+
+    ds_dynamic_array instrs;
+    ds_dynamic_array_init(&instrs, sizeof(tac_instr));
+
+    for (size_t i = 0; i < n; i++) {
+        tac_instr instr;
+        if (tac_fold_rewrite(&context, i, &instr)) {
+            ds_dynamic_array_append(&instrs, &instr);
+        }
+    }
+
+    ds_dynamic_array_free(&tac->instrs);
+    tac->instrs = instrs;
+
+    free(out);
+    free(context.reachable);
+    free(context.in);
+    free(context.tracked);
+}
@@ -0,0 +1,136 @@
+#include "codegen.h"
+#include "ds.h"
+
+// Dead code elimination. The blocks that can not be reached from the entry
+// are dropped, and so are the pure instructions whose result is a local
+// that is not live after them. Removing an instruction can make the ones
+// computing its operands dead, so this runs until nothing changes.
+
+// the instructions that only write their result; a division can abort on
+// zero and `=` on objects calls equals, so those stay
+static int tac_is_pure(tac_instr *instr) {
+    switch (instr->kind) {
+    case TAC_ASSIGN_INT:
+    case TAC_ASSIGN_STRING:
+    case TAC_ASSIGN_BOOL:
+    case TAC_ASSIGN_DEFAULT:
+    case TAC_ASSIGN_VALUE:
+    case TAC_CAST:
+    case TAC_ASSIGN_ADD:
+    case TAC_ASSIGN_SUB:
+    case TAC_ASSIGN_MUL:
+    case TAC_ASSIGN_NEG:
+    case TAC_ASSIGN_LT:
+    case TAC_ASSIGN_LE:
+    case TAC_ASSIGN_NOT:
+    case TAC_ASSIGN_ISVOID:
+    case TAC_ASSIGN_ISINSTANCE:
+    case TAC_BOX:
+    case TAC_UNBOX:
+    case TAC_PHI:
+        return 1;
+    case TAC_ASSIGN_EQ:
+        return codegen_tac_eq_kind(instr->assign_eq.type) != TAC_EQ_DISPATCH;
+    default:
+        return 0;
+    }
+}
+
+// the blocks reachable from the entry
+static int *tac_reachable_blocks(tac_cfg *cfg) {
+    size_t blocks = cfg->blocks.count;
+    int *reachable = calloc(blocks + 1, sizeof(int));
+
+    ds_dynamic_array work; // size_t
+    ds_dynamic_array_init(&work, sizeof(size_t));
+
+    if (blocks > 0) {
+        size_t entry = 0;
+        reachable[entry] = 1;
+        ds_dynamic_array_append(&work, &entry);
+    }
+
+    while (work.count > 0) {
+        size_t b = 0;
+        ds_dynamic_array_get(&work, work.count - 1, &b);
+        work.count--;
+
+        tac_basic_block *block = NULL;
+        ds_dynamic_array_get_ref(&cfg->blocks, b, (void **)&block);
+
+        for (size_t s = 0; s < block->successors.count; s++) {
+            size_t successor = 0;
+            ds_dynamic_array_get(&block->successors, s, &successor);
+
+            if (!reachable[successor]) {
+                reachable[successor] = 1;
+                ds_dynamic_array_append(&work, &successor);
+            }
+        }
+    }
+
+    ds_dynamic_array_free(&work);
+    return reachable;
+}
+
+// returns 1 when the instruction is kept
+static int tac_dce_keep(tac_result *tac, tac_liveness *liveness, size_t i) {
+    tac_instr *instr = NULL;
+    ds_dynamic_array_get_ref(&tac->instrs, i, (void **)&instr);
+
+    if (!tac_is_pure(instr)) {
+        return 1;
+    }
+
+    // writes to formals and attributes are seen outside of the locals
+    int v = codegen_tac_local_index(tac, *codegen_tac_instr_def(instr));
+    if (v < 0) {
+        return 1;
+    }
+
+    return tac_set_has(liveness->out + i * liveness->words, v);
+}
+
+// returns the number of instructions removed
+static size_t tac_dce_round(tac_result *tac) {
+    tac_cfg cfg;
+    codegen_tac_cfg_build(tac, &cfg);
+
+    tac_liveness liveness;
+    codegen_tac_liveness(&cfg, &liveness);
+
+    int *reachable = tac_reachable_blocks(&cfg);
+
+    ds_dynamic_array instrs;
+    ds_dynamic_array_init(&instrs, sizeof(tac_instr));
+
+    for (size_t i = 0; i < tac->instrs.count; i++) {
+        if (!reachable[cfg.block_of[i]] || !tac_dce_keep(tac, &liveness, i)) {
+            continue;
+        }
+
+        tac_instr *instr = NULL;
+        ds_dynamic_array_get_ref(&tac->instrs, i, (void **)&instr);
+        ds_dynamic_array_append(&instrs, instr);
+    }
+
+    size_t removed = tac->instrs.count - instrs.count;
+
+    free(reachable);
+    codegen_tac_liveness_free(&liveness);
+    codegen_tac_cfg_free(&cfg);
+
+    ds_dynamic_array_free(&tac->instrs);
+    tac->instrs = instrs;
+
+    return removed;
+}
+
+void codegen_tac_eliminate_dead_code(tac_result *tac) {
+    size_t removed = 0;
+    do {
+        removed = tac->instrs.count > 0 ? tac_dce_round(tac) : 0;
+    } while (removed > 0);
+
+    codegen_tac_pack_slots(tac);
+}
@@ -0,0 +1,83 @@
+#include "codegen.h"
+#include "ds.h"
+
+// Class hierarchy analysis: a dynamic dispatch whose method is not
+// overridden by any class that conforms to the static type of the receiver
+// always calls the same implementation, so it can be a direct call to it.
+
+static int tac_conforms_to(semantic_mapping_item *item,
+                           semantic_mapping_item *ancestor) {
+    for (; item != NULL; item = item->parent) {
+        if (item == ancestor) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+// the class that implements the method for every receiver of the static
+// type, NULL if a subclass overrides it
+static const char *tac_unique_implementation(semantic_mapping *mapping,
+                                             semantic_mapping_item *type,
+                                             const char *method_name) {
+    implementation_mapping_item *method =
+        codegen_tac_find_method(type, method_name);
+    if (method == NULL) {
+        return NULL;
+    }
+
+    for (size_t i = 0; i < mapping->classes.count; i++) {
+        semantic_mapping_item *item = NULL;
+        ds_dynamic_array_get_ref(&mapping->classes, i, (void **)&item);
+
+        if (!tac_conforms_to(item, type)) {
+            continue;
+        }
+
+        implementation_mapping_item *override =
+            codegen_tac_find_method(item, method_name);
+        if (override == NULL ||
+            strcmp(override->from_class, method->from_class) != 0) {
+            return NULL;
+        }
+    }
+
+    return method->from_class;
+}
+
+void codegen_tac_devirtualize(semantic_mapping *mapping,
+                              const char *class_name, tac_result *tac,
+                              tac_stats *stats) {
+    for (size_t i = 0; i < tac->instrs.count; i++) {
+        tac_instr *instr = NULL;
+        ds_dynamic_array_get_ref(&tac->instrs, i, (void **)&instr);
+
+        if (instr->kind != TAC_DISPATCH_CALL ||
+            instr->dispatch_call.type != NULL) {
+            continue;
+        }
+
+        stats->dispatches++;
+
+        const char *expr_type = instr->dispatch_call.expr_type;
+        if (strcmp(expr_type, SELF_TYPE) == 0) {
+            expr_type = class_name;
+        }
+
+        semantic_mapping_item *type =
+            codegen_tac_find_class(mapping, expr_type);
+        if (type == NULL) {
+            continue;
+        }
+
+        const char *from_class = tac_unique_implementation(
+            mapping, type, instr->dispatch_call.method);
+        if (from_class == NULL) {
+            continue;
+        }
+
+        instr->dispatch_call.type = (char *)from_class;
+        stats->devirtualized++;
+    }
+}
@@ -0,0 +1,177 @@
+#include "codegen.h"
+#include "ds.h"
+
+// Escape analysis. An object made by `new` that is only copied between
+// locals, tested and read or written through its attributes can not be
+// reached once the method returns, so it is allocated in the frame of the
+// method instead of on the heap. Storing it in an attribute or a formal,
+// returning it, passing it to a call (also as the receiver) or comparing
+// it with equals lets it escape. The locals connected by copies share the
+// objects they hold, so they escape together.
+//
+// The same `new` can run again in a loop and reuse the slots of the object
+// it made before; it only can when none of the locals that may hold that
+// object are live there. An X_init that runs more than the constants
+// already in the prototype sees the object as self and could keep it, so
+// those classes stay on the heap.
+
+// objects larger than this are left on the heap to keep the frame small
+#define TAC_STACK_OBJECT_WORDS 16
+
+// a class whose constructor only sets constants, and small enough
+static int tac_is_stack_class(semantic_mapping *mapping, const char *type) {
+    if (codegen_tac_is_basic_class(type)) {
+        return 0;
+    }
+
+    semantic_mapping_item *item = codegen_tac_find_class(mapping, type);
+    if (item == NULL || item->attributes.count + 3 > TAC_STACK_OBJECT_WORDS) {
+        return 0;
+    }
+
+    for (size_t j = 0; j < item->attributes.count; j++) {
+        class_mapping_attribute *attr = NULL;
+        ds_dynamic_array_get_ref(&item->attributes, j, (void **)&attr);
+
+        switch (attr->attribute->value.kind) {
+        case EXPR_NULL:
+        case EXPR_INT:
+        case EXPR_BOOL:
+        case EXPR_STRING:
+        case EXPR_EXTERN:
+            break;
+        default:
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+static int tac_find_group(int *groups, int v) {
+    while (groups[v] != v) {
+        groups[v] = groups[groups[v]];
+        v = groups[v];
+    }
+    return v;
+}
+
+// whether the object in the local used by the operand can outlive the
+// method through this instruction
+static int tac_use_escapes(tac_result *tac, tac_instr *instr, char **operand) {
+    switch (instr->kind) {
+    case TAC_ASSIGN_VALUE:
+    case TAC_CAST:
+        // a copy to a local is followed, one to an attribute or a formal not
+        return codegen_tac_local_index(tac, *codegen_tac_instr_def(instr)) < 0;
+    case TAC_ATTR_STORE:
+        return operand != &instr->attr.object;
+    case TAC_ATTR_LOAD:
+    case TAC_ASSIGN_ISVOID:
+    case TAC_ASSIGN_ISINSTANCE:
+    case TAC_JUMP_IF_COND:
+    case TAC_JUMP_CASE:
+        return 0;
+    default:
+        return 1;
+    }
+}
+
+void codegen_tac_stack_allocate(semantic_mapping *mapping,
+                                const char *method_name, tac_result *tac,
+                                tac_stats *stats) {
+    // the attribute initializers share the frame of X_init
+    if (method_name == NULL || tac->instrs.count == 0) {
+        return;
+    }
+
+    size_t locals = tac->locals.count;
+    int *groups = malloc(sizeof(int) * (locals + 1));
+    int *escapes = calloc(locals + 1, sizeof(int));
+    for (size_t v = 0; v < locals; v++) {
+        groups[v] = v;
+    }
+
+    // the locals connected by copies
+    for (size_t i = 0; i < tac->instrs.count; i++) {
+        tac_instr *instr = NULL;
+        ds_dynamic_array_get_ref(&tac->instrs, i, (void **)&instr);
+
+        if (instr->kind != TAC_ASSIGN_VALUE && instr->kind != TAC_CAST) {
+            continue;
+        }
+
+        const char *expr = instr->kind == TAC_CAST ? instr->cast.expr
+                                                   : instr->assign_value.expr;
+        int from = codegen_tac_local_index(tac, expr);
+        int to = codegen_tac_local_index(tac, *codegen_tac_instr_def(instr));
+        if (from >= 0 && to >= 0) {
+            groups[tac_find_group(groups, from)] = tac_find_group(groups, to);
+        }
+    }
+
+    for (size_t i = 0; i < tac->instrs.count; i++) {
+        tac_instr *instr = NULL;
+        ds_dynamic_array_get_ref(&tac->instrs, i, (void **)&instr);
+
+        ds_dynamic_array uses;
+        codegen_tac_instr_uses(instr, &uses);
+        for (size_t j = 0; j < uses.count; j++) {
+            char **operand = NULL;
+            ds_dynamic_array_get(&uses, j, &operand);
+
+            int v = codegen_tac_local_index(tac, *operand);
+            if (v >= 0 && tac_use_escapes(tac, instr, operand)) {
+                escapes[tac_find_group(groups, v)] = 1;
+            }
+        }
+        ds_dynamic_array_free(&uses);
+
+        // the value of the method is returned
+        if (i == tac->instrs.count - 1 && instr->kind == TAC_IDENT) {
+            int v = codegen_tac_local_index(tac, instr->ident.name);
+            if (v >= 0) {
+                escapes[tac_find_group(groups, v)] = 1;
+            }
+        }
+    }
+
+    tac_cfg cfg;
+    codegen_tac_cfg_build(tac, &cfg);
+    tac_liveness liveness;
+    codegen_tac_liveness(&cfg, &liveness);
+
+    for (size_t i = 0; i < tac->instrs.count; i++) {
+        tac_instr *instr = NULL;
+        ds_dynamic_array_get_ref(&tac->instrs, i, (void **)&instr);
+
+        if (instr->kind != TAC_ASSIGN_NEW || instr->assign_new.shared ||
+            !tac_is_stack_class(mapping, instr->assign_new.type)) {
+            continue;
+        }
+
+        int v = codegen_tac_local_index(tac, instr->assign_new.ident);
+        if (v < 0 || escapes[tac_find_group(groups, v)]) {
+            continue;
+        }
+
+        // an object made here before may still be in use
+        int reused = 0;
+        uint64_t *live = liveness.in + i * liveness.words;
+        for (size_t w = 0; w < locals && !reused; w++) {
+            reused = tac_set_has(live, w) &&
+                     tac_find_group(groups, w) == tac_find_group(groups, v);
+        }
+        if (reused) {
+            continue;
+        }
+
+        instr->assign_new.stack = 1;
+        stats->stack_objects++;
+    }
+
+    codegen_tac_liveness_free(&liveness);
+    codegen_tac_cfg_free(&cfg);
+    free(groups);
+    free(escapes);
+}
@@ -0,0 +1,86 @@
+#include "codegen.h"
+#include "ds.h"
+
+// Formals in locals. The first TAC_REGISTER_ARGS arguments of a method
+// come in registers that the body clobbers, so every formal the method
+// uses is copied into a new local at the start and the body works on the
+// local; the register allocator can then keep it in a register for the
+// whole method. After this only the copies name the formals.
+
+// renames the formal in the operands of every instruction, returns 1 when
+// the method uses it
+static int tac_rename_formal(tac_result *tac, const char *formal,
+                             char *local) {
+    int used = 0;
+
+    for (size_t i = 0; i < tac->instrs.count; i++) {
+        tac_instr *instr = NULL;
+        ds_dynamic_array_get_ref(&tac->instrs, i, (void **)&instr);
+
+        ds_dynamic_array uses;
+        codegen_tac_instr_uses(instr, &uses);
+        for (size_t j = 0; j < uses.count; j++) {
+            char **operand = NULL;
+            ds_dynamic_array_get(&uses, j, &operand);
+
+            if (strcmp(*operand, formal) == 0) {
+                *operand = local;
+                used = 1;
+            }
+        }
+        ds_dynamic_array_free(&uses);
+
+        char **ident = codegen_tac_instr_def(instr);
+        if (ident != NULL && strcmp(*ident, formal) == 0) {
+            *ident = local;
+            used = 1;
+        }
+    }
+
+    return used;
+}
+
+void codegen_tac_lower_formals(semantic_mapping *mapping,
+                               const char *class_name,
+                               const char *method_name, tac_result *tac) {
+    if (method_name == NULL) {
+        return;
+    }
+
+    semantic_mapping_item *item = codegen_tac_find_class(mapping, class_name);
+    implementation_mapping_item *method =
+        item != NULL ? codegen_tac_find_method(item, method_name) : NULL;
+    if (method == NULL) {
+        return;
+    }
+
+    ds_dynamic_array copies; // tac_instr
+    ds_dynamic_array_init(&copies, sizeof(tac_instr));
+
+    method_node *node = (method_node *)method->method;
+    for (size_t i = 0; i < node->formals.count; i++) {
+        formal_node *formal = NULL;
+        ds_dynamic_array_get_ref(&node->formals, i, (void **)&formal);
+
+        char *local = codegen_tac_new_local(tac, formal->type.value, 0);
+        if (!tac_rename_formal(tac, formal->name.value, local)) {
+            continue;
+        }
+
+        tac_instr copy = {.kind = TAC_ASSIGN_VALUE,
+                          .assign_value = {.ident = local,
+                                           .expr = formal->name.value}};
+        ds_dynamic_array_append(&copies, &copy);
+    }
+
+    for (size_t i = 0; i < tac->instrs.count; i++) {
+        tac_instr *instr = NULL;
+        ds_dynamic_array_get_ref(&tac->instrs, i, (void **)&instr);
+        ds_dynamic_array_append(&copies, instr);
+    }
+
+    ds_dynamic_array_free(&tac->instrs);
+    tac->instrs = copies;
+
+    codegen_tac_pack_slots(tac);
+}
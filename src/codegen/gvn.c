@@ -0,0 +1,431 @@
+#include "codegen.h"
+#include "ds.h"
+
+// Global value numbering on the SSA form. The blocks are visited in the
+// order of the dominator tree, and every local written once gets a value
+// number: the same constant or the same operation on the same values gets
+// the same number. A computation whose value is already held by a local
+// written in a dominating block becomes a copy of that local, which the
+// copy pass then removes.
+//
+// Besides the arithmetic, the loads of the attributes of String, Int and
+// Bool (which never change once the object exists) and the direct calls to
+// the methods below are numbered, since their result only depends on the
+// receiver and the arguments.
+
+static const char *tac_pure_methods[][2] = {
+    {"Object", "type_name"}, {"String", "length"}, {"String", "concat"},
+    {"String", "substr"},    {"Int", "abs"},       {"Int", "mod"},
+    {"Int", "to_string"},    {"Bool", "to_int"},   {"Bool", "to_string"},
+    {"Bool", "and"},         {"Bool", "or"},       {"Bool", "xor"},
+};
+
+#define TAC_PURE_METHOD_COUNT                                                 \
+    (sizeof(tac_pure_methods) / sizeof(tac_pure_methods[0]))
+
+typedef struct tac_value {
+        char *key;    // the operation and the value numbers of its operands
+        int number;
+        char *holder; // the local holding the value, NULL for constants
+} tac_value;
+
+typedef struct tac_gvn_context {
+        tac_result *tac;
+        tac_cfg cfg;
+        tac_dominators dominators;
+
+        int *numbers;               // value number of each local, -1 if none
+        int *defs;                  // definitions of each local
+        ds_dynamic_array stable;    // char *, self and unassigned formals
+        ds_dynamic_array constants; // tac_value, seen anywhere
+        ds_dynamic_array values;    // tac_value, held in a dominating block
+        int count;                  // value numbers given
+        tac_stats *stats;
+} tac_gvn_context;
+
+static int tac_is_written(tac_result *tac, const char *name) {
+    for (size_t i = 0; i < tac->instrs.count; i++) {
+        tac_instr *instr = NULL;
+        ds_dynamic_array_get_ref(&tac->instrs, i, (void **)&instr);
+
+        char **ident = codegen_tac_instr_def(instr);
+        if (ident != NULL && strcmp(*ident, name) == 0) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+// self and the formals that are never assigned hold the same value in the
+// whole method; the attributes can change on every call
+static void tac_find_stable(tac_gvn_context *context,
+                            semantic_mapping *mapping, const char *class_name,
+                            const char *method_name) {
+    char *self = "self";
+    ds_dynamic_array_append(&context->stable, &self);
+
+    if (method_name == NULL) {
+        return;
+    }
+
+    semantic_mapping_item *item = codegen_tac_find_class(mapping, class_name);
+    implementation_mapping_item *method =
+        item != NULL ? codegen_tac_find_method(item, method_name) : NULL;
+    if (method == NULL) {
+        return;
+    }
+
+    method_node *node = (method_node *)method->method;
+    for (size_t i = 0; i < node->formals.count; i++) {
+        formal_node *formal = NULL;
+        ds_dynamic_array_get_ref(&node->formals, i, (void **)&formal);
+
+        char *name = formal->name.value;
+        if (!tac_is_written(context->tac, name)) {
+            ds_dynamic_array_append(&context->stable, &name);
+        }
+    }
+}
+
+// the value number of an operand, -1 if it can change
+static int tac_operand_number(tac_gvn_context *context, const char *name) {
+    int v = codegen_tac_local_index(context->tac, name);
+    if (v >= 0) {
+        return context->defs[v] == 1 ? context->numbers[v] : -1;
+    }
+
+    // the stable names are numbered after all the locals
+    for (size_t i = 0; i < context->stable.count; i++) {
+        char *stable = NULL;
+        ds_dynamic_array_get(&context->stable, i, &stable);
+
+        if (strcmp(stable, name) == 0) {
+            return context->tac->locals.count + i;
+        }
+    }
+
+    return -1;
+}
+
+// a direct call whose result only depends on the receiver and the
+// arguments, and that does nothing else
+int codegen_tac_is_pure_call(tac_dispatch_call *call) {
+    if (call->type == NULL) {
+        return 0;
+    }
+
+    for (size_t i = 0; i < TAC_PURE_METHOD_COUNT; i++) {
+        if (strcmp(call->type, tac_pure_methods[i][0]) == 0 &&
+            strcmp(call->method, tac_pure_methods[i][1]) == 0) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+// the attributes of the basic classes are never written after the object
+// is created
+int codegen_tac_is_immutable_attribute(tac_attr *attr) {
+    return strcmp(attr->type, "String") == 0 ||
+           strcmp(attr->type, "Int") == 0 || strcmp(attr->type, "Bool") == 0;
+}
+
+// appends the value numbers of the operands to the key, 0 if one of them
+// can change
+static int tac_key_operands(tac_gvn_context *context, ds_string_builder *sb,
+                            char **operands, size_t count, int commutative) {
+    int numbers[2] = {0, 0};
+
+    for (size_t i = 0; i < count; i++) {
+        int number = tac_operand_number(context, operands[i]);
+        if (number < 0) {
+            return 0;
+        }
+
+        if (commutative) {
+            numbers[i] = number;
+        } else {
+            ds_string_builder_append(sb, " %d", number);
+        }
+    }
+
+    if (commutative) {
+        int lhs = numbers[0] < numbers[1] ? numbers[0] : numbers[1];
+        int rhs = numbers[0] < numbers[1] ? numbers[1] : numbers[0];
+        ds_string_builder_append(sb, " %d %d", lhs, rhs);
+    }
+
+    return 1;
+}
+
+// the key of a constant, NULL if the instruction does not load one
+static char *tac_constant_key(tac_instr *instr) {
+    ds_string_builder sb;
+    ds_string_builder_init(&sb);
+
+    switch (instr->kind) {
+    case TAC_ASSIGN_INT:
+        ds_string_builder_append(&sb, "int %d", instr->assign_int.value);
+        break;
+    case TAC_ASSIGN_BOOL:
+        ds_string_builder_append(&sb, "bool %d", instr->assign_bool.value);
+        break;
+    case TAC_ASSIGN_STRING:
+        ds_string_builder_append(&sb, "string %s",
+                                 instr->assign_string.value);
+        break;
+    case TAC_ASSIGN_DEFAULT:
+        ds_string_builder_append(&sb, "default %s",
+                                 instr->assign_default.type);
+        break;
+    default:
+        ds_string_builder_free(&sb);
+        return NULL;
+    }
+
+    char *key = NULL;
+    ds_string_builder_build(&sb, &key);
+    ds_string_builder_free(&sb);
+    return key;
+}
+
+// the key of a computation, NULL if it is not one or if one of its
+// operands can change
+static char *tac_expression_key(tac_gvn_context *context, tac_instr *instr) {
+    ds_string_builder sb;
+    ds_string_builder_init(&sb);
+
+    int ok = 0;
+    switch (instr->kind) {
+    case TAC_ASSIGN_ADD:
+    case TAC_ASSIGN_MUL: {
+        char *operands[] = {instr->assign_binary.lhs, instr->assign_binary.rhs};
+        ds_string_builder_append(&sb, "%d", instr->kind);
+        ok = tac_key_operands(context, &sb, operands, 2, 1);
+        break;
+    }
+    case TAC_ASSIGN_SUB:
+    case TAC_ASSIGN_DIV:
+    case TAC_ASSIGN_LT:
+    case TAC_ASSIGN_LE: {
+        char *operands[] = {instr->assign_binary.lhs, instr->assign_binary.rhs};
+        ds_string_builder_append(&sb, "%d", instr->kind);
+        ok = tac_key_operands(context, &sb, operands, 2, 0);
+        break;
+    }
+    case TAC_ASSIGN_EQ: {
+        if (codegen_tac_eq_kind(instr->assign_eq.type) == TAC_EQ_DISPATCH) {
+            break;
+        }
+
+        char *operands[] = {instr->assign_eq.lhs, instr->assign_eq.rhs};
+        ds_string_builder_append(&sb, "%d %s", instr->kind,
+                                 instr->assign_eq.type);
+        ok = tac_key_operands(context, &sb, operands, 2, 1);
+        break;
+    }
+    case TAC_ASSIGN_NEG:
+    case TAC_ASSIGN_NOT:
+    case TAC_ASSIGN_ISVOID:
+        ds_string_builder_append(&sb, "%d", instr->kind);
+        ok = tac_key_operands(context, &sb, &instr->assign_unary.expr, 1, 0);
+        break;
+    case TAC_ASSIGN_ISINSTANCE:
+        ds_string_builder_append(&sb, "%d %s", instr->kind,
+                                 instr->isinstance.type);
+        ok = tac_key_operands(context, &sb, &instr->isinstance.expr, 1, 0);
+        break;
+    case TAC_CAST:
+        ds_string_builder_append(&sb, "%d %s", instr->kind, instr->cast.type);
+        ok = tac_key_operands(context, &sb, &instr->cast.expr, 1, 0);
+        break;
+    case TAC_ATTR_LOAD:
+        if (!codegen_tac_is_immutable_attribute(&instr->attr)) {
+            break;
+        }
+
+        ds_string_builder_append(&sb, "%d %s.%s", instr->kind,
+                                 instr->attr.type, instr->attr.attribute);
+        ok = tac_key_operands(context, &sb, &instr->attr.object, 1, 0);
+        break;
+    case TAC_DISPATCH_CALL: {
+        tac_dispatch_call *call = &instr->dispatch_call;
+        if (!codegen_tac_is_pure_call(call)) {
+            break;
+        }
+
+        ds_string_builder_append(&sb, "%d %s.%s", instr->kind, call->type,
+                                 call->method);
+        ok = tac_key_operands(context, &sb, &call->expr, 1, 0);
+        for (size_t i = 0; ok && i < call->args.count; i++) {
+            char **arg = NULL;
+            ds_dynamic_array_get_ref(&call->args, i, (void **)&arg);
+            ok = tac_key_operands(context, &sb, arg, 1, 0);
+        }
+        break;
+    }
+    default:
+        break;
+    }
+
+    char *key = NULL;
+    if (ok) {
+        ds_string_builder_build(&sb, &key);
+    }
+    ds_string_builder_free(&sb);
+    return key;
+}
+
+static tac_value *tac_find_value(ds_dynamic_array *values, const char *key) {
+    for (size_t i = values->count; i > 0; i--) {
+        tac_value *value = NULL;
+        ds_dynamic_array_get_ref(values, i - 1, (void **)&value);
+
+        if (strcmp(value->key, key) == 0) {
+            return value;
+        }
+    }
+
+    return NULL;
+}
+
+// the value number of a constant, the same for every load of it
+static int tac_number_constant(tac_gvn_context *context, char *key) {
+    tac_value *value = tac_find_value(&context->constants, key);
+    if (value != NULL) {
+        free(key);
+        return value->number;
+    }
+
+    tac_value constant = {.key = key, .number = context->count++};
+    ds_dynamic_array_append(&context->constants, &constant);
+    return constant.number;
+}
+
+static void tac_number_instr(tac_gvn_context *context, tac_instr *instr) {
+    tac_result *tac = context->tac;
+
+    char **ident = codegen_tac_instr_def(instr);
+    int v = ident != NULL ? codegen_tac_local_index(tac, *ident) : -1;
+    if (v < 0 || context->defs[v] != 1) {
+        return;
+    }
+
+    if (instr->kind == TAC_ASSIGN_VALUE) {
+        int number = tac_operand_number(context, instr->assign_value.expr);
+        context->numbers[v] = number >= 0 ? number : context->count++;
+        return;
+    }
+
+    char *key = tac_constant_key(instr);
+    if (key != NULL) {
+        context->numbers[v] = tac_number_constant(context, key);
+        return;
+    }
+
+    key = tac_expression_key(context, instr);
+    if (key == NULL) {
+        context->numbers[v] = context->count++;
+        return;
+    }
+
+    tac_value *value = tac_find_value(&context->values, key);
+    if (value != NULL) {
+        free(key);
+        context->numbers[v] = value->number;
+        context->stats->redundant++;
+
+        *instr = (tac_instr){.kind = TAC_ASSIGN_VALUE,
+                             .assign_value = {.ident = *ident,
+                                              .expr = value->holder}};
+        return;
+    }
+
+    tac_value computed = {
+        .key = key, .number = context->count++, .holder = *ident};
+    ds_dynamic_array_append(&context->values, &computed);
+    context->numbers[v] = computed.number;
+}
+
+static void tac_number_block(tac_gvn_context *context, size_t b) {
+    size_t scope = context->values.count;
+
+    tac_basic_block *block = NULL;
+    ds_dynamic_array_get_ref(&context->cfg.blocks, b, (void **)&block);
+
+    for (size_t i = block->first; i < block->last; i++) {
+        tac_instr *instr = NULL;
+        ds_dynamic_array_get_ref(&context->tac->instrs, i, (void **)&instr);
+        tac_number_instr(context, instr);
+    }
+
+    ds_dynamic_array *children = &context->dominators.children[b];
+    for (size_t c = 0; c < children->count; c++) {
+        size_t child = 0;
+        ds_dynamic_array_get(children, c, &child);
+        tac_number_block(context, child);
+    }
+
+    // the values computed here are not available to the siblings
+    for (size_t i = scope; i < context->values.count; i++) {
+        tac_value *value = NULL;
+        ds_dynamic_array_get_ref(&context->values, i, (void **)&value);
+        free(value->key);
+    }
+    context->values.count = scope;
+}
+
+void codegen_tac_number_values(semantic_mapping *mapping,
+                               const char *class_name, const char *method_name,
+                               tac_result *tac, tac_stats *stats) {
+    codegen_tac_to_ssa(tac);
+    if (tac->instrs.count == 0) {
+        return;
+    }
+
+    size_t locals = tac->locals.count;
+    tac_gvn_context context = {.tac = tac, .stats = stats};
+    context.numbers = malloc(sizeof(int) * (locals + 1));
+    context.defs = calloc(locals + 1, sizeof(int));
+    for (size_t v = 0; v < locals; v++) {
+        context.numbers[v] = -1;
+    }
+
+    for (size_t i = 0; i < tac->instrs.count; i++) {
+        tac_instr *instr = NULL;
+        ds_dynamic_array_get_ref(&tac->instrs, i, (void **)&instr);
+
+        char **ident = codegen_tac_instr_def(instr);
+        int v = ident != NULL ? codegen_tac_local_index(tac, *ident) : -1;
+        if (v >= 0) {
+            context.defs[v]++;
+        }
+    }
+
+    ds_dynamic_array_init(&context.stable, sizeof(char *));
+    ds_dynamic_array_init(&context.constants, sizeof(tac_value));
+    ds_dynamic_array_init(&context.values, sizeof(tac_value));
+    tac_find_stable(&context, mapping, class_name, method_name);
+    context.count = locals + context.stable.count;
+
+    codegen_tac_cfg_build(tac, &context.cfg);
+    codegen_tac_dominators(&context.cfg, &context.dominators);
+
+    tac_number_block(&context, 0);
+
+    for (size_t i = 0; i < context.constants.count; i++) {
+        tac_value *value = NULL;
+        ds_dynamic_array_get_ref(&context.constants, i, (void **)&value);
+        free(value->key);
+    }
+
+    codegen_tac_dominators_free(&context.dominators);
+    codegen_tac_cfg_free(&context.cfg);
+    ds_dynamic_array_free(&context.values);
+    ds_dynamic_array_free(&context.constants);
+    ds_dynamic_array_free(&context.stable);
+    free(context.defs);
+    free(context.numbers);
+}
@@ -0,0 +1,403 @@
+#include "codegen.h"
+#include "ds.h"
+
+// Statically bound calls (`@Type` dispatch or devirtualized ones) to small
+// methods are replaced by the TAC of the method body. The locals and labels
+// of the callee get fresh names in the caller, the receiver and the
+// arguments are copied into new locals that stand for self and the formals,
+// and the attributes of self become loads and stores on the receiver.
+
+// the largest callee that is inlined, in instructions
+#define INLINE_MAX_INSTRS 16
+// how much a method may grow because of inlining, in instructions
+#define INLINE_MAX_GROWTH 256
+// calls in inlined code are inlined again up to this depth
+#define INLINE_MAX_DEPTH 2
+
+typedef struct tac_inline_context {
+        semantic_mapping *mapping;
+        tac_result *tac; // the caller
+
+        semantic_mapping_item *callee_class;
+        method_node *callee;
+        tac_result body; // the TAC of the callee
+
+        char *self;              // local holding the receiver
+        ds_dynamic_array formals; // char *, locals holding the arguments
+        ds_dynamic_array locals;  // char *, caller names of the callee locals
+        ds_dynamic_array labels;  // char *, callee label followed by its
+                                  // caller name
+        int has_labels;           // the body has control flow
+} tac_inline_context;
+
+static const class_mapping_attribute *
+tac_find_attribute(semantic_mapping_item *item, const char *name) {
+    for (size_t j = 0; j < item->attributes.count; j++) {
+        class_mapping_attribute *attribute = NULL;
+        ds_dynamic_array_get_ref(&item->attributes, j, (void **)&attribute);
+
+        if (strcmp(attribute->attribute_name, name) == 0) {
+            return attribute;
+        }
+    }
+
+    return NULL;
+}
+
+static size_t tac_count_instrs(tac_result *tac) {
+    size_t count = 0;
+    for (size_t i = 0; i < tac->instrs.count; i++) {
+        tac_instr *instr = NULL;
+        ds_dynamic_array_get_ref(&tac->instrs, i, (void **)&instr);
+
+        if (instr->kind != TAC_LABEL) {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+static char *tac_rename_label(tac_inline_context *context, const char *label) {
+    for (size_t i = 0; i < context->labels.count; i += 2) {
+        char *from = NULL;
+        ds_dynamic_array_get(&context->labels, i, &from);
+
+        if (strcmp(from, label) == 0) {
+            char *to = NULL;
+            ds_dynamic_array_get(&context->labels, i + 1, &to);
+            return to;
+        }
+    }
+
+    DS_PANIC("unknown label %s", label);
+}
+
+// the caller name of a local, self or a formal of the callee, NULL for the
+// attributes of self
+static char *tac_rename_variable(tac_inline_context *context,
+                                 const char *name) {
+    tac_local *local = codegen_tac_find_local(&context->body, name);
+    if (local != NULL) {
+        size_t index = local - (tac_local *)context->body.locals.items;
+        char *renamed = NULL;
+        ds_dynamic_array_get(&context->locals, index, &renamed);
+        return renamed;
+    }
+
+    if (strcmp(name, "self") == 0) {
+        return context->self;
+    }
+
+    for (size_t i = 0; i < context->callee->formals.count; i++) {
+        formal_node *formal = NULL;
+        ds_dynamic_array_get_ref(&context->callee->formals, i,
+                                 (void **)&formal);
+
+        if (strcmp(formal->name.value, name) == 0) {
+            char *renamed = NULL;
+            ds_dynamic_array_get(&context->formals, i, &renamed);
+            return renamed;
+        }
+    }
+
+    return NULL;
+}
+
+static tac_instr tac_attribute_access(tac_inline_context *context,
+                                      enum tac_kind kind, const char *name,
+                                      char **ident) {
+    const class_mapping_attribute *attribute =
+        tac_find_attribute(context->callee_class, name);
+    if (attribute == NULL) {
+        DS_PANIC("unknown variable %s", name);
+    }
+
+    *ident = codegen_tac_new_local(context->tac,
+                                   attribute->attribute->type.value, 0);
+    return (tac_instr){
+        .kind = kind,
+        .attr =
+            {
+                .ident = *ident,
+                .object = context->self,
+                .type = context->callee_class->class_name,
+                .attribute = attribute->attribute_name,
+            },
+    };
+}
+
+// the caller name of a variable read by the callee, the attributes of self
+// are loaded into new locals first
+static char *tac_rename_use(tac_inline_context *context, const char *name,
+                            ds_dynamic_array *instrs) {
+    char *renamed = tac_rename_variable(context, name);
+    if (renamed != NULL) {
+        return renamed;
+    }
+
+    tac_instr load =
+        tac_attribute_access(context, TAC_ATTR_LOAD, name, &renamed);
+    ds_dynamic_array_append(instrs, &load);
+
+    return renamed;
+}
+
+static void tac_inline_instr(tac_inline_context *context, tac_instr instr,
+                             ds_dynamic_array *instrs) {
+    if (instr.kind == TAC_LABEL) {
+        instr.label.label = tac_rename_label(context, instr.label.label);
+        ds_dynamic_array_append(instrs, &instr);
+        return;
+    }
+
+    ds_dynamic_array labels;
+    codegen_tac_instr_targets(&instr, &labels);
+    for (size_t i = 0; i < labels.count; i++) {
+        char **label = NULL;
+        ds_dynamic_array_get(&labels, i, &label);
+        *label = tac_rename_label(context, *label);
+    }
+    ds_dynamic_array_free(&labels);
+
+    ds_dynamic_array uses;
+    codegen_tac_instr_uses(&instr, &uses);
+    for (size_t i = 0; i < uses.count; i++) {
+        char **operand = NULL;
+        ds_dynamic_array_get(&uses, i, &operand);
+        *operand = tac_rename_use(context, *operand, instrs);
+    }
+    ds_dynamic_array_free(&uses);
+
+    // the attributes of self are stored after the instruction
+    char **ident = codegen_tac_instr_def(&instr);
+    char *renamed = ident != NULL ? tac_rename_variable(context, *ident) : NULL;
+    if (ident == NULL || renamed != NULL) {
+        if (ident != NULL) {
+            *ident = renamed;
+        }
+        ds_dynamic_array_append(instrs, &instr);
+        return;
+    }
+
+    tac_instr store =
+        tac_attribute_access(context, TAC_ATTR_STORE, *ident, ident);
+    ds_dynamic_array_append(instrs, &instr);
+    ds_dynamic_array_append(instrs, &store);
+}
+
+// the callee of a statically bound call, NULL if it can not be inlined
+static method_node *tac_inline_callee(semantic_mapping *mapping,
+                                            const char *class_name,
+                                            const char *method_name,
+                                            tac_dispatch_call *call,
+                                            semantic_mapping_item **item) {
+    if (call->type == NULL) {
+        return NULL;
+    }
+
+    semantic_mapping_item *type = codegen_tac_find_class(mapping, call->type);
+    if (type == NULL) {
+        return NULL;
+    }
+
+    implementation_mapping_item *method =
+        codegen_tac_find_method(type, call->method);
+    if (method == NULL || method->method->body.kind == EXPR_EXTERN) {
+        return NULL;
+    }
+
+    if (method_name != NULL && strcmp(method->from_class, class_name) == 0 &&
+        strcmp(method->method_name, method_name) == 0) {
+        return NULL;
+    }
+
+    *item = codegen_tac_find_class(mapping, method->from_class);
+    return (method_node *)method->method;
+}
+
+// replaces the call with the body of the callee, returns the number of
+// instructions added or 0 if the call was not inlined
+static size_t tac_inline_call(tac_inline_context *context,
+                              tac_dispatch_call *call,
+                              ds_dynamic_array *instrs) {
+    codegen_expr_to_tac(context->mapping, &context->callee->body,
+                        &context->body);
+
+    // self dispatches in the callee are on the callee class
+    tac_stats stats = {.dispatches = 0, .devirtualized = 0, .inlined = 0};
+    codegen_tac_devirtualize(context->mapping,
+                             context->callee_class->class_name,
+                             &context->body, &stats);
+    for (size_t i = 0; i < context->body.instrs.count; i++) {
+        tac_instr *instr = NULL;
+        ds_dynamic_array_get_ref(&context->body.instrs, i, (void **)&instr);
+
+        if (instr->kind == TAC_DISPATCH_CALL &&
+            strcmp(instr->dispatch_call.expr_type, SELF_TYPE) == 0) {
+            instr->dispatch_call.expr_type =
+                (char *)context->callee_class->class_name;
+        }
+    }
+
+    size_t size = tac_count_instrs(&context->body);
+    if (size > INLINE_MAX_INSTRS) {
+        return 0;
+    }
+
+    ds_dynamic_array_init(&context->formals, sizeof(char *));
+    ds_dynamic_array_init(&context->locals, sizeof(char *));
+    ds_dynamic_array_init(&context->labels, sizeof(char *));
+
+    for (size_t i = 0; i < context->body.locals.count; i++) {
+        tac_local *local = NULL;
+        ds_dynamic_array_get_ref(&context->body.locals, i, (void **)&local);
+
+        char *ident = codegen_tac_new_local(context->tac, local->type, 0);
+        ds_dynamic_array_append(&context->locals, &ident);
+    }
+
+    for (size_t i = 0; i < context->body.instrs.count; i++) {
+        tac_instr *instr = NULL;
+        ds_dynamic_array_get_ref(&context->body.instrs, i, (void **)&instr);
+
+        if (instr->kind == TAC_LABEL) {
+            char *label = codegen_tac_new_label(context->tac);
+            ds_dynamic_array_append(&context->labels, &instr->label.label);
+            ds_dynamic_array_append(&context->labels, &label);
+        }
+    }
+
+    context->has_labels = context->labels.count > 0;
+    size_t start = instrs->count;
+
+    // self <- receiver, formals <- arguments
+    context->self = codegen_tac_new_local(
+        context->tac, context->callee_class->class_name, 0);
+    tac_instr self = {
+        .kind = TAC_ASSIGN_VALUE,
+        .assign_value = {.ident = context->self, .expr = call->expr},
+    };
+    ds_dynamic_array_append(instrs, &self);
+
+    for (size_t i = 0; i < context->callee->formals.count; i++) {
+        formal_node *formal = NULL;
+        ds_dynamic_array_get_ref(&context->callee->formals, i,
+                                 (void **)&formal);
+
+        char *arg = NULL;
+        ds_dynamic_array_get(&call->args, i, &arg);
+
+        char *ident =
+            codegen_tac_new_local(context->tac, formal->type.value, 0);
+        ds_dynamic_array_append(&context->formals, &ident);
+
+        tac_instr copy = {
+            .kind = TAC_ASSIGN_VALUE,
+            .assign_value = {.ident = ident, .expr = arg},
+        };
+        ds_dynamic_array_append(instrs, &copy);
+    }
+
+    // the last instruction of the body is the value of the call
+    for (size_t i = 0; i + 1 < context->body.instrs.count; i++) {
+        tac_instr instr;
+        ds_dynamic_array_get(&context->body.instrs, i, &instr);
+        tac_inline_instr(context, instr, instrs);
+    }
+
+    tac_instr result;
+    ds_dynamic_array_get(&context->body.instrs,
+                         context->body.instrs.count - 1, &result);
+    tac_instr value = {
+        .kind = TAC_ASSIGN_VALUE,
+        .assign_value =
+            {
+                .ident = call->ident,
+                .expr = tac_rename_use(context, result.ident.name, instrs),
+            },
+    };
+    ds_dynamic_array_append(instrs, &value);
+
+    ds_dynamic_array_free(&context->formals);
+    ds_dynamic_array_free(&context->locals);
+    ds_dynamic_array_free(&context->labels);
+
+    return instrs->count - start;
+}
+
+void codegen_tac_inline(semantic_mapping *mapping, const char *class_name,
+                        const char *method_name, tac_result *tac,
+                        tac_stats *stats) {
+    size_t growth = 0;
+
+    for (int depth = 0; depth < INLINE_MAX_DEPTH; depth++) {
+        ds_dynamic_array instrs;
+        ds_dynamic_array_init(&instrs, sizeof(tac_instr));
+
+        // in SSA form, the block label the phis know followed by the one
+        // that now ends the block
+        ds_dynamic_array retargets; // char *
+        ds_dynamic_array_init(&retargets, sizeof(char *));
+        char *block = NULL;
+
+        size_t inlined = 0;
+        for (size_t i = 0; i < tac->instrs.count; i++) {
+            tac_instr instr;
+            ds_dynamic_array_get(&tac->instrs, i, &instr);
+
+            if (instr.kind == TAC_LABEL) {
+                block = instr.label.label;
+            }
+
+            tac_inline_context context = {.mapping = mapping, .tac = tac};
+            if (instr.kind == TAC_DISPATCH_CALL && growth < INLINE_MAX_GROWTH) {
+                context.callee =
+                    tac_inline_callee(mapping, class_name, method_name,
+                                      &instr.dispatch_call,
+                                      &context.callee_class);
+            }
+
+            if (context.callee != NULL) {
+                size_t added =
+                    tac_inline_call(&context, &instr.dispatch_call, &instrs);
+                if (added > 0) {
+                    growth += added;
+                    inlined++;
+
+                    // the rest of the block comes after the labels of the
+                    // body, so it starts a block with a label of its own
+                    if (tac->ssa && block != NULL && context.has_labels) {
+                        char *tail = codegen_tac_new_label(tac);
+                        tac_instr label = {.kind = TAC_LABEL,
+                                           .label = {tail}};
+                        ds_dynamic_array_append(&instrs, &label);
+                        ds_dynamic_array_append(&retargets, &block);
+                        ds_dynamic_array_append(&retargets, &tail);
+                        block = tail;
+                    }
+                    continue;
+                }
+            }
+
+            ds_dynamic_array_append(&instrs, &instr);
+        }
+
+        ds_dynamic_array_free(&tac->instrs);
+        tac->instrs = instrs;
+        stats->inlined += inlined;
+
+        for (size_t r = 0; r < retargets.count; r += 2) {
+            char *from = NULL;
+            char *to = NULL;
+            ds_dynamic_array_get(&retargets, r, &from);
+            ds_dynamic_array_get(&retargets, r + 1, &to);
+            codegen_tac_retarget_phis(tac, from, to);
+        }
+        ds_dynamic_array_free(&retargets);
+
+        if (inlined == 0) {
+            break;
+        }
+    }
+}
@@ -0,0 +1,457 @@
+#include "codegen.h"
+#include "ds.h"
+
+// Loop invariant code motion. A back edge goes to a block that dominates
+// its source, and the natural loop of the edge is that header with every
+// block that reaches the source without going through it. The computations
+// of a loop whose operands do not change in it move to a new block right
+// before the header, the preheader, that the edges from outside the loop
+// now go to.
+//
+// A computation moves when it writes a local that is written nowhere else
+// in the loop and that is not live when the loop starts, so every use sees
+// the moved value. The instructions that can not fail move even if they
+// would not have run (a loop that ends right away); a division, an
+// attribute load or a call can abort, so those only move from the header
+// when nothing before them in it has an effect.
+
+typedef struct tac_loop {
+        size_t header;
+        int *blocks; // 1 for the blocks in the loop
+        size_t size;
+} tac_loop;
+
+typedef struct tac_licm_context {
+        tac_result *tac;
+        tac_cfg cfg;
+        tac_dominators dominators;
+        tac_liveness liveness;
+
+        ds_dynamic_array formals; // char *, the formals of the method
+
+        tac_loop *loop;
+        int *defs;       // definitions of each local in the loop
+        int *hoisted;    // the instructions that move
+        int *invariant;  // the locals written by the moved instructions
+        int effects;     // the loop has instructions with effects
+        ds_dynamic_array order; // size_t, the moved instructions in order
+} tac_licm_context;
+
+static void tac_find_formals(tac_licm_context *context,
+                             semantic_mapping *mapping, const char *class_name,
+                             const char *method_name) {
+    if (method_name == NULL) {
+        return;
+    }
+
+    semantic_mapping_item *item = codegen_tac_find_class(mapping, class_name);
+    implementation_mapping_item *method =
+        item != NULL ? codegen_tac_find_method(item, method_name) : NULL;
+    if (method == NULL) {
+        return;
+    }
+
+    method_node *node = (method_node *)method->method;
+    for (size_t i = 0; i < node->formals.count; i++) {
+        formal_node *formal = NULL;
+        ds_dynamic_array_get_ref(&node->formals, i, (void **)&formal);
+        ds_dynamic_array_append(&context->formals, &formal->name.value);
+    }
+}
+
+// the natural loops, one for each header with all of its back edges
+static void tac_find_loops(tac_licm_context *context,
+                           ds_dynamic_array *loops) {
+    tac_cfg *cfg = &context->cfg;
+    size_t blocks = cfg->blocks.count;
+
+    ds_dynamic_array_init(loops, sizeof(tac_loop));
+
+    ds_dynamic_array work; // size_t
+    ds_dynamic_array_init(&work, sizeof(size_t));
+
+    for (size_t h = 0; h < blocks; h++) {
+        tac_loop loop = {.header = h, .blocks = NULL, .size = 0};
+
+        tac_basic_block *header = codegen_tac_get_block(cfg, h);
+        for (size_t p = 0; p < header->predecessors.count; p++) {
+            size_t latch = 0;
+            ds_dynamic_array_get(&header->predecessors, p, &latch);
+
+            if (context->dominators.rpo[latch] < 0 ||
+                !codegen_tac_dominates(&context->dominators, h, latch)) {
+                continue;
+            }
+
+            if (loop.blocks == NULL) {
+                loop.blocks = calloc(blocks + 1, sizeof(int));
+                loop.blocks[h] = 1;
+                loop.size = 1;
+            }
+
+            if (!loop.blocks[latch]) {
+                loop.blocks[latch] = 1;
+                loop.size++;
+                ds_dynamic_array_append(&work, &latch);
+            }
+
+            while (work.count > 0) {
+                size_t b = 0;
+                ds_dynamic_array_get(&work, work.count - 1, &b);
+                work.count--;
+
+                tac_basic_block *block = codegen_tac_get_block(cfg, b);
+                for (size_t q = 0; q < block->predecessors.count; q++) {
+                    size_t predecessor = 0;
+                    ds_dynamic_array_get(&block->predecessors, q,
+                                         &predecessor);
+
+                    if (!loop.blocks[predecessor] &&
+                        context->dominators.rpo[predecessor] >= 0) {
+                        loop.blocks[predecessor] = 1;
+                        loop.size++;
+                        ds_dynamic_array_append(&work, &predecessor);
+                    }
+                }
+            }
+        }
+
+        if (loop.blocks != NULL) {
+            ds_dynamic_array_append(loops, &loop);
+        }
+    }
+
+    ds_dynamic_array_free(&work);
+}
+
+static int tac_in_loop(tac_licm_context *context, size_t i) {
+    return context->loop->blocks[context->cfg.block_of[i]];
+}
+
+static int tac_has_effects(tac_instr *instr) {
+    switch (instr->kind) {
+    case TAC_DISPATCH_CALL:
+        return !codegen_tac_is_pure_call(&instr->dispatch_call);
+    case TAC_ATTR_STORE:
+        return 1;
+    default:
+        return codegen_tac_instr_is_call(instr);
+    }
+}
+
+// the instructions that compute a value and can not fail
+static int tac_is_speculable(tac_instr *instr) {
+    switch (instr->kind) {
+    case TAC_ASSIGN_INT:
+    case TAC_ASSIGN_STRING:
+    case TAC_ASSIGN_BOOL:
+    case TAC_ASSIGN_DEFAULT:
+    case TAC_ASSIGN_VALUE:
+    case TAC_CAST:
+    case TAC_ASSIGN_ADD:
+    case TAC_ASSIGN_SUB:
+    case TAC_ASSIGN_MUL:
+    case TAC_ASSIGN_NEG:
+    case TAC_ASSIGN_LT:
+    case TAC_ASSIGN_LE:
+    case TAC_ASSIGN_NOT:
+    case TAC_ASSIGN_ISVOID:
+        return 1;
+    case TAC_ASSIGN_EQ:
+        return codegen_tac_eq_kind(instr->assign_eq.type) == TAC_EQ_VALUE;
+    default:
+        return 0;
+    }
+}
+
+// the computations that can abort but have no other effect
+static int tac_is_guarded(tac_licm_context *context, tac_instr *instr) {
+    switch (instr->kind) {
+    case TAC_ASSIGN_DIV:
+        return 1;
+    case TAC_ATTR_LOAD:
+        return codegen_tac_is_immutable_attribute(&instr->attr) ||
+               !context->effects;
+    case TAC_DISPATCH_CALL:
+        return codegen_tac_is_pure_call(&instr->dispatch_call);
+    default:
+        return 0;
+    }
+}
+
+static int tac_is_formal(tac_licm_context *context, const char *name) {
+    for (size_t i = 0; i < context->formals.count; i++) {
+        char *formal = NULL;
+        ds_dynamic_array_get(&context->formals, i, &formal);
+
+        if (strcmp(formal, name) == 0) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+static int tac_is_written_in_loop(tac_licm_context *context,
+                                  const char *name) {
+    for (size_t i = 0; i < context->tac->instrs.count; i++) {
+        if (!tac_in_loop(context, i)) {
+            continue;
+        }
+
+        char **ident =
+            codegen_tac_instr_def(codegen_tac_get_instr(context->tac, i));
+        if (ident != NULL && strcmp(*ident, name) == 0) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+static int tac_is_invariant(tac_licm_context *context, const char *name) {
+    int v = codegen_tac_local_index(context->tac, name);
+    if (v >= 0) {
+        return context->defs[v] == 0 || context->invariant[v];
+    }
+
+    if (tac_is_written_in_loop(context, name)) {
+        return 0;
+    }
+
+    // the attributes of self can change on any call
+    return strcmp(name, "self") == 0 || tac_is_formal(context, name) ||
+           !context->effects;
+}
+
+// nothing before the instruction in the header can have an effect or fail
+static int tac_runs_first(tac_licm_context *context, size_t i) {
+    tac_basic_block *header =
+        codegen_tac_get_block(&context->cfg, context->loop->header);
+    if (context->cfg.block_of[i] != context->loop->header) {
+        return 0;
+    }
+
+    for (size_t j = header->first; j < i; j++) {
+        tac_instr *instr = codegen_tac_get_instr(context->tac, j);
+        if (!context->hoisted[j] && instr->kind != TAC_LABEL &&
+            !tac_is_speculable(instr)) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+static int tac_can_hoist(tac_licm_context *context, size_t i) {
+    tac_result *tac = context->tac;
+    tac_instr *instr = codegen_tac_get_instr(tac, i);
+
+    int speculable = tac_is_speculable(instr);
+    if (!speculable && !tac_is_guarded(context, instr)) {
+        return 0;
+    }
+
+    char **ident = codegen_tac_instr_def(instr);
+    int v = ident != NULL ? codegen_tac_local_index(tac, *ident) : -1;
+    if (v < 0 || context->defs[v] != 1) {
+        return 0;
+    }
+
+    tac_basic_block *header =
+        codegen_tac_get_block(&context->cfg, context->loop->header);
+    uint64_t *live = context->liveness.in + header->first * context->liveness.words;
+    if (tac_set_has(live, v)) {
+        return 0;
+    }
+
+    ds_dynamic_array uses;
+    codegen_tac_instr_uses(instr, &uses);
+    int invariant = 1;
+    for (size_t j = 0; j < uses.count && invariant; j++) {
+        char **operand = NULL;
+        ds_dynamic_array_get(&uses, j, &operand);
+        invariant = tac_is_invariant(context, *operand);
+    }
+    ds_dynamic_array_free(&uses);
+
+    return invariant && (speculable || tac_runs_first(context, i));
+}
+
+// returns the number of instructions moved out of the loop
+static size_t tac_hoist_loop(tac_licm_context *context) {
+    tac_result *tac = context->tac;
+    size_t n = tac->instrs.count;
+
+    context->defs = calloc(tac->locals.count + 1, sizeof(int));
+    context->invariant = calloc(tac->locals.count + 1, sizeof(int));
+    context->hoisted = calloc(n + 1, sizeof(int));
+    context->effects = 0;
+    ds_dynamic_array_init(&context->order, sizeof(size_t));
+
+    for (size_t i = 0; i < n; i++) {
+        if (!tac_in_loop(context, i)) {
+            continue;
+        }
+
+        tac_instr *instr = codegen_tac_get_instr(tac, i);
+        context->effects |= tac_has_effects(instr);
+
+        char **ident = codegen_tac_instr_def(instr);
+        int v = ident != NULL ? codegen_tac_local_index(tac, *ident) : -1;
+        if (v >= 0) {
+            context->defs[v]++;
+        }
+    }
+
+    // a moved instruction can make the ones using it invariant
+    int changed = 1;
+    while (changed) {
+        changed = 0;
+
+        for (size_t i = 0; i < n; i++) {
+            if (!tac_in_loop(context, i) || context->hoisted[i] ||
+                !tac_can_hoist(context, i)) {
+                continue;
+            }
+
+            context->hoisted[i] = 1;
+            char **ident = codegen_tac_instr_def(codegen_tac_get_instr(tac, i));
+            context->invariant[codegen_tac_local_index(tac, *ident)] = 1;
+            ds_dynamic_array_append(&context->order, &i);
+            changed = 1;
+        }
+    }
+
+    size_t count = context->order.count;
+    tac_basic_block *header =
+        codegen_tac_get_block(&context->cfg, context->loop->header);
+    tac_instr *label = codegen_tac_get_instr(tac, header->first);
+
+    if (count > 0 && label->kind == TAC_LABEL) {
+        char *header_label = label->label.label;
+        char *preheader = codegen_tac_new_label(tac);
+
+        // the edges from outside the loop go to the preheader
+        for (size_t b = 0; b < context->cfg.blocks.count; b++) {
+            if (context->loop->blocks[b]) {
+                continue;
+            }
+
+            tac_basic_block *block = codegen_tac_get_block(&context->cfg, b);
+            ds_dynamic_array labels;
+            codegen_tac_instr_targets(
+                codegen_tac_get_instr(tac, block->last - 1), &labels);
+            for (size_t j = 0; j < labels.count; j++) {
+                char **target = NULL;
+                ds_dynamic_array_get(&labels, j, &target);
+                if (strcmp(*target, header_label) == 0) {
+                    *target = preheader;
+                }
+            }
+            ds_dynamic_array_free(&labels);
+        }
+
+        ds_dynamic_array instrs;
+        ds_dynamic_array_init(&instrs, sizeof(tac_instr));
+        for (size_t i = 0; i < n; i++) {
+            if (i == header->first) {
+                // the loop does not fall into the preheader
+                if (i > 0 && tac_in_loop(context, i - 1) &&
+                    codegen_tac_instr_falls_through(
+                        codegen_tac_get_instr(tac, i - 1))) {
+                    tac_instr jump = {.kind = TAC_JUMP,
+                                      .jump = {header_label}};
+                    ds_dynamic_array_append(&instrs, &jump);
+                }
+
+                tac_instr start = {.kind = TAC_LABEL, .label = {preheader}};
+                ds_dynamic_array_append(&instrs, &start);
+                for (size_t j = 0; j < count; j++) {
+                    size_t moved = 0;
+                    ds_dynamic_array_get(&context->order, j, &moved);
+                    ds_dynamic_array_append(&instrs,
+                                            codegen_tac_get_instr(tac, moved));
+                }
+            }
+
+            if (!context->hoisted[i]) {
+                ds_dynamic_array_append(&instrs, codegen_tac_get_instr(tac, i));
+            }
+        }
+
+        ds_dynamic_array_free(&tac->instrs);
+        tac->instrs = instrs;
+    } else {
+        count = 0;
+    }
+
+    ds_dynamic_array_free(&context->order);
+    free(context->hoisted);
+    free(context->invariant);
+    free(context->defs);
+
+    return count;
+}
+
+static int tac_loop_compare(const void *a, const void *b) {
+    const tac_loop *lhs = a;
+    const tac_loop *rhs = b;
+
+    return (int)lhs->size - (int)rhs->size;
+}
+
+// hoists from the innermost loop that has something to move, returns the
+// number of instructions moved
+static size_t tac_hoist_round(tac_licm_context *context) {
+    tac_result *tac = context->tac;
+
+    codegen_tac_cfg_build(tac, &context->cfg);
+    codegen_tac_dominators(&context->cfg, &context->dominators);
+    codegen_tac_liveness(&context->cfg, &context->liveness);
+
+    ds_dynamic_array loops; // tac_loop
+    tac_find_loops(context, &loops);
+    ds_dynamic_array_sort(&loops, tac_loop_compare);
+
+    size_t hoisted = 0;
+    for (size_t l = 0; l < loops.count && hoisted == 0; l++) {
+        ds_dynamic_array_get_ref(&loops, l, (void **)&context->loop);
+        hoisted = tac_hoist_loop(context);
+    }
+
+    for (size_t l = 0; l < loops.count; l++) {
+        tac_loop *loop = NULL;
+        ds_dynamic_array_get_ref(&loops, l, (void **)&loop);
+        free(loop->blocks);
+    }
+    ds_dynamic_array_free(&loops);
+
+    codegen_tac_liveness_free(&context->liveness);
+    codegen_tac_dominators_free(&context->dominators);
+    codegen_tac_cfg_free(&context->cfg);
+
+    return hoisted;
+}
+
+void codegen_tac_hoist_invariants(semantic_mapping *mapping,
+                                  const char *class_name,
+                                  const char *method_name, tac_result *tac,
+                                  tac_stats *stats) {
+    codegen_tac_from_ssa(tac);
+    if (tac->instrs.count == 0) {
+        return;
+    }
+
+    tac_licm_context context = {.tac = tac};
+    ds_dynamic_array_init(&context.formals, sizeof(char *));
+    tac_find_formals(&context, mapping, class_name, method_name);
+
+    size_t hoisted = 0;
+    do {
+        hoisted = tac_hoist_round(&context);
+        stats->hoisted += hoisted;
+    } while (hoisted > 0);
+
+    ds_dynamic_array_free(&context.formals);
+}
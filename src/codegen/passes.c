@@ -0,0 +1,288 @@
+#include "codegen.h"
+#include "ds.h"
+
+// The pass manager. Every optimization is registered here under the name
+// used by `--passes` and `--tac-after`; the `-O` levels are lists of these
+// names. A pipeline keeps the order it was given in, but the boxed passes
+// always run before the unbox lowering and the unboxed ones after it. The
+// boxed passes after `ssa` see the TAC in SSA form; it is translated back
+// before unbox. The unbox lowering and then the formals lowering always
+// run between the two stages. The alloc and peephole passes are left to the
+// assembler.
+
+#define TAC_PASS_UNBOX "unbox"
+#define TAC_PASS_FORMALS "formals"
+
+static void tac_pass_devirtualize(tac_pass_context *context, tac_result *tac) {
+    codegen_tac_devirtualize(context->mapping, context->class_name, tac,
+                             context->stats);
+}
+
+static void tac_pass_inline(tac_pass_context *context, tac_result *tac) {
+    codegen_tac_inline(context->mapping, context->class_name,
+                       context->method_name, tac, context->stats);
+}
+
+static void tac_pass_fold(tac_pass_context *context, tac_result *tac) {
+    (void)context;
+    codegen_tac_fold_constants(tac);
+}
+
+static void tac_pass_gvn(tac_pass_context *context, tac_result *tac) {
+    codegen_tac_number_values(context->mapping, context->class_name,
+                              context->method_name, tac, context->stats);
+}
+
+static void tac_pass_licm(tac_pass_context *context, tac_result *tac) {
+    codegen_tac_hoist_invariants(context->mapping, context->class_name,
+                                 context->method_name, tac, context->stats);
+}
+
+static void tac_pass_dce(tac_pass_context *context, tac_result *tac) {
+    (void)context;
+    codegen_tac_eliminate_dead_code(tac);
+}
+
+static void tac_pass_copy(tac_pass_context *context, tac_result *tac) {
+    (void)context;
+    codegen_tac_coalesce_copies(tac);
+}
+
+static void tac_pass_ssa(tac_pass_context *context, tac_result *tac) {
+    (void)context;
+    codegen_tac_to_ssa(tac);
+}
+
+static void tac_pass_unbox(tac_pass_context *context, tac_result *tac) {
+    (void)context;
+    codegen_tac_unbox(tac);
+}
+
+static void tac_pass_formals(tac_pass_context *context, tac_result *tac) {
+    codegen_tac_lower_formals(context->mapping, context->class_name,
+                              context->method_name, tac);
+}
+
+static void tac_pass_fuse(tac_pass_context *context, tac_result *tac) {
+    (void)context;
+    codegen_tac_fuse_branches(tac);
+}
+
+static void tac_pass_case(tac_pass_context *context, tac_result *tac) {
+    (void)context;
+    codegen_tac_lower_case(tac);
+}
+
+static void tac_pass_tail(tac_pass_context *context, tac_result *tac) {
+    codegen_tac_mark_tail_calls(context->mapping, context->class_name,
+                                context->method_name, tac, context->stats);
+}
+
+static void tac_pass_singleton(tac_pass_context *context, tac_result *tac) {
+    codegen_tac_share_stateless(context->mapping, tac, context->stats);
+}
+
+static void tac_pass_escape(tac_pass_context *context, tac_result *tac) {
+    codegen_tac_stack_allocate(context->mapping, context->method_name, tac,
+                               context->stats);
+}
+
+static void tac_pass_regalloc(tac_pass_context *context, tac_result *tac) {
+    (void)context;
+    codegen_tac_regalloc(tac);
+}
+
+// the assembler emits the allocations inline
+static void tac_pass_alloc(tac_pass_context *context, tac_result *tac) {
+    (void)context;
+    (void)tac;
+}
+
+// the assembler runs it on the instructions it emits
+static void tac_pass_peephole(tac_pass_context *context, tac_result *tac) {
+    (void)context;
+    (void)tac;
+}
+
+static const tac_pass tac_passes[] = {
+    {"devirt", "direct calls for methods that are never overridden",
+     TAC_STAGE_BOXED, tac_pass_devirtualize},
+    {"inline", "replace calls to small methods by their body",
+     TAC_STAGE_BOXED, tac_pass_inline},
+    {"fold", "constant folding and propagation", TAC_STAGE_BOXED,
+     tac_pass_fold},
+    {"gvn", "reuse values computed before (enters SSA)", TAC_STAGE_BOXED,
+     tac_pass_gvn},
+    {"licm", "hoist loop invariant computations (leaves SSA)",
+     TAC_STAGE_BOXED, tac_pass_licm},
+    {"dce", "remove unreachable code and unused results", TAC_STAGE_BOXED,
+     tac_pass_dce},
+    {"copy", "propagate copies by coalescing locals (leaves SSA)",
+     TAC_STAGE_BOXED, tac_pass_copy},
+    {"ssa", "static single assignment form (left before unbox)",
+     TAC_STAGE_BOXED, tac_pass_ssa},
+    {TAC_PASS_UNBOX, "raw Int and Bool values (always runs)",
+     TAC_STAGE_UNBOXED, tac_pass_unbox},
+    {TAC_PASS_FORMALS, "copy the register arguments to locals (always runs)",
+     TAC_STAGE_UNBOXED, tac_pass_formals},
+    {"fuse", "fuse comparisons with conditional jumps", TAC_STAGE_UNBOXED,
+     tac_pass_fuse},
+    {"case", "dispatch case on the class tag", TAC_STAGE_UNBOXED,
+     tac_pass_case},
+    {"singleton", "share one object of every class without state",
+     TAC_STAGE_UNBOXED, tac_pass_singleton},
+    {"escape", "allocate objects that do not escape on the stack",
+     TAC_STAGE_UNBOXED, tac_pass_escape},
+    {"tail", "jump to calls in tail position", TAC_STAGE_UNBOXED,
+     tac_pass_tail},
+    {"regalloc", "keep locals in registers", TAC_STAGE_UNBOXED,
+     tac_pass_regalloc},
+    {"alloc", "allocate small objects inline", TAC_STAGE_EMITTED,
+     tac_pass_alloc},
+    {"peephole", "simplify the emitted instructions", TAC_STAGE_EMITTED,
+     tac_pass_peephole},
+};
+
+#define TAC_PASS_COUNT (sizeof(tac_passes) / sizeof(tac_passes[0]))
+
+static const char *tac_levels[TAC_OPT_LEVEL_MAX + 1] = {
+    "",
+    "fuse,case,tail,regalloc,alloc,peephole",
+    "devirt,inline,fold,gvn,licm,dce,copy,fuse,case,singleton,escape,tail,"
+    "regalloc,alloc,peephole",
+};
+
+static const tac_pass *tac_find_pass(const char *name, size_t length) {
+    for (size_t i = 0; i < TAC_PASS_COUNT; i++) {
+        if (strlen(tac_passes[i].name) == length &&
+            strncmp(tac_passes[i].name, name, length) == 0) {
+            return &tac_passes[i];
+        }
+    }
+
+    return NULL;
+}
+
+static void tac_print_passes(void) {
+    fprintf(stderr, "available passes:\n");
+    for (size_t i = 0; i < TAC_PASS_COUNT; i++) {
+        fprintf(stderr, "  %-10s %s\n", tac_passes[i].name,
+                tac_passes[i].description);
+    }
+}
+
+// the pipeline of an optimization level
+int codegen_tac_pipeline_level(int level, tac_pipeline *pipeline) {
+    if (level < 0 || level > TAC_OPT_LEVEL_MAX) {
+        DS_LOG_ERROR("invalid optimization level: %d", level);
+        return 1;
+    }
+
+    return codegen_tac_pipeline_parse(tac_levels[level], pipeline);
+}
+
+// the pipeline of a comma separated list of pass names
+int codegen_tac_pipeline_parse(const char *names, tac_pipeline *pipeline) {
+    ds_dynamic_array_init(&pipeline->passes, sizeof(const tac_pass *));
+
+    const char *name = names;
+    while (*name != '\0') {
+        size_t length = strcspn(name, ",");
+        if (length > 0) {
+            const tac_pass *pass = tac_find_pass(name, length);
+            if (pass == NULL) {
+                DS_LOG_ERROR("unknown pass: %.*s", (int)length, name);
+                tac_print_passes();
+                ds_dynamic_array_free(&pipeline->passes);
+                return 1;
+            }
+
+            ds_dynamic_array_append(&pipeline->passes, &pass);
+        }
+
+        name += length;
+        if (*name == ',') {
+            name++;
+        }
+    }
+
+    return 0;
+}
+
+// the passes that run in every pipeline
+static int tac_is_lowering(const char *name) {
+    return strcmp(name, TAC_PASS_UNBOX) == 0 ||
+           strcmp(name, TAC_PASS_FORMALS) == 0;
+}
+
+int codegen_tac_pipeline_has(tac_pipeline *pipeline, const char *name) {
+    if (tac_is_lowering(name)) {
+        return 1;
+    }
+
+    for (size_t i = 0; i < pipeline->passes.count; i++) {
+        const tac_pass *pass = NULL;
+        ds_dynamic_array_get(&pipeline->passes, i, &pass);
+
+        if (strcmp(pass->name, name) == 0) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+// returns 1 when the pass was stop_after
+static int tac_run_pass(const tac_pass *pass, tac_pass_context *context,
+                        tac_result *tac, const char *stop_after) {
+    pass->run(context, tac);
+
+    return stop_after != NULL && strcmp(pass->name, stop_after) == 0;
+}
+
+static int tac_run_stage(tac_pipeline *pipeline, enum tac_stage stage,
+                         tac_pass_context *context, tac_result *tac,
+                         const char *stop_after) {
+    for (size_t i = 0; i < pipeline->passes.count; i++) {
+        const tac_pass *pass = NULL;
+        ds_dynamic_array_get(&pipeline->passes, i, &pass);
+
+        if (pass->stage != stage || tac_is_lowering(pass->name)) {
+            continue;
+        }
+
+        if (tac_run_pass(pass, context, tac, stop_after)) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+// run the pipeline on the TAC of a method, stopping right after the pass
+// named stop_after when it is not NULL
+void codegen_tac_pipeline_run(tac_pipeline *pipeline, tac_pass_context *context,
+                              tac_result *tac, const char *stop_after) {
+    if (tac_run_stage(pipeline, TAC_STAGE_BOXED, context, tac, stop_after)) {
+        return;
+    }
+
+    codegen_tac_from_ssa(tac);
+
+    const tac_pass *unbox = tac_find_pass(TAC_PASS_UNBOX, strlen(TAC_PASS_UNBOX));
+    if (tac_run_pass(unbox, context, tac, stop_after)) {
+        return;
+    }
+
+    const tac_pass *formals =
+        tac_find_pass(TAC_PASS_FORMALS, strlen(TAC_PASS_FORMALS));
+    if (tac_run_pass(formals, context, tac, stop_after)) {
+        return;
+    }
+
+    tac_run_stage(pipeline, TAC_STAGE_UNBOXED, context, tac, stop_after);
+}
+
+void codegen_tac_pipeline_free(tac_pipeline *pipeline) {
+    ds_dynamic_array_free(&pipeline->passes);
+}
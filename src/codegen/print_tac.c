@@ -1,144 +1,222 @@
 #include "codegen.h"
 #include "parser.h"
 
-static void print_tac_label(tac_label label) { printf("%s:\n", label.label); }
+static void print_tac_label(FILE *out, tac_label label) {
+    fprintf(out, "%s:\n", label.label);
+}
 
-static void print_tac_jump(tac_jump jump) { printf("jump %s\n", jump.label); }
+static void print_tac_jump(FILE *out, tac_jump jump) {
+    fprintf(out, "jump %s\n", jump.label);
+}
 
-static void print_tac_jump_if_true(tac_jump_if_true jump_if_true) {
-    printf("bt %s %s\n", jump_if_true.expr, jump_if_true.label);
+static void print_tac_jump_if_true(FILE *out, tac_jump_if_true jump_if_true) {
+    fprintf(out, "bt %s %s\n", jump_if_true.expr, jump_if_true.label);
 }
 
-static void print_tac_assign_isinstance(tac_isinstance isinstance) {
-    printf("%s <- %s instanceof %s\n", isinstance.ident, isinstance.expr,
-           isinstance.type);
+static void print_tac_assign_isinstance(FILE *out, tac_isinstance isinstance) {
+    fprintf(out, "%s <- %s instanceof %s\n", isinstance.ident,
+            isinstance.expr, isinstance.type);
 }
 
-static void print_tac_cast(tac_cast cast) {
-    printf("%s <- %s as %s\n", cast.ident, cast.expr, cast.type);
+static void print_tac_cast(FILE *out, tac_cast cast) {
+    fprintf(out, "%s <- %s as %s\n", cast.ident, cast.expr, cast.type);
 }
 
-static void print_tac_assign_value(tac_assign_value assign_value) {
-    printf("%s <- %s\n", assign_value.ident, assign_value.expr);
+static void print_tac_assign_value(FILE *out, tac_assign_value assign_value) {
+    fprintf(out, "%s <- %s\n", assign_value.ident, assign_value.expr);
 }
 
-static void print_tac_dispatch_call(tac_dispatch_call dispatch_call) {
-    printf("%s <- ", dispatch_call.ident);
+static void print_tac_dispatch_call(FILE *out,
+                                    tac_dispatch_call dispatch_call) {
+    fprintf(out, "%s <- ", dispatch_call.ident);
+    if (dispatch_call.tail) {
+        fprintf(out, "tail ");
+    }
 
     if (dispatch_call.expr != NULL) {
-        printf("%s", dispatch_call.expr);
+        fprintf(out, "%s", dispatch_call.expr);
         if (dispatch_call.type != NULL) {
-            printf("@%s", dispatch_call.type);
+            fprintf(out, "@%s", dispatch_call.type);
         }
-        printf(".");
+        fprintf(out, ".");
     }
 
-    printf("%s(", dispatch_call.method);
+    fprintf(out, "%s(", dispatch_call.method);
 
     for (unsigned int i = 0; i < dispatch_call.args.count; i++) {
         char *arg;
         ds_dynamic_array_get(&dispatch_call.args, i, &arg);
-        printf("%s", arg);
+        fprintf(out, "%s", arg);
         if (i < dispatch_call.args.count - 1) {
-            printf(", ");
+            fprintf(out, ", ");
         }
     }
-    printf(")\n");
+    fprintf(out, ")\n");
 }
 
-static void print_tac_assign_new(tac_assign_new assign_new) {
-    printf("%s <- new %s\n", assign_new.ident, assign_new.type);
+static void print_tac_assign_new(FILE *out, tac_assign_new assign_new) {
+    fprintf(out, "%s <- new %s%s%s\n", assign_new.ident, assign_new.type,
+            assign_new.stack ? " on the stack" : "",
+            assign_new.shared ? " shared" : "");
 }
 
-static void print_tac_assign_default(tac_assign_new assign_new) {
-    printf("%s <- default %s\n", assign_new.ident, assign_new.type);
+static void print_tac_assign_default(FILE *out, tac_assign_new assign_new) {
+    fprintf(out, "%s <- default %s\n", assign_new.ident, assign_new.type);
 }
 
-static void print_tac_assign_binary(tac_assign_binary assign_binary,
+static void print_tac_assign_binary(FILE *out, tac_assign_binary assign_binary,
                                     const char *op) {
-    printf("%s <- %s %s %s\n", assign_binary.ident, assign_binary.lhs, op,
-           assign_binary.rhs);
+    fprintf(out, "%s <- %s %s %s\n", assign_binary.ident, assign_binary.lhs,
+            op, assign_binary.rhs);
 }
 
-static void print_tac_assign_eq(tac_assign_eq assign_binary) {
-    printf("%s <- %s = %s\n", assign_binary.ident, assign_binary.lhs,
-           assign_binary.rhs);
+static void print_tac_assign_eq(FILE *out, tac_assign_eq assign_binary) {
+    fprintf(out, "%s <- %s = %s\n", assign_binary.ident, assign_binary.lhs,
+            assign_binary.rhs);
 }
 
-static void print_tac_assign_unary(tac_assign_unary assign_unary,
+static void print_tac_assign_unary(FILE *out, tac_assign_unary assign_unary,
                                    const char *op) {
-    printf("%s <- %s %s\n", assign_unary.ident, op, assign_unary.expr);
+    fprintf(out, "%s <- %s %s\n", assign_unary.ident, op, assign_unary.expr);
+}
+
+static void print_tac_ident(FILE *out, tac_ident ident) {
+    fprintf(out, "%s\n", ident.name);
+}
+
+static void print_tac_assign_int(FILE *out, tac_assign_int assign_int) {
+    fprintf(out, "%s <- int %d\n", assign_int.ident, assign_int.value);
+}
+
+static void print_tac_assign_string(FILE *out,
+                                    tac_assign_string assign_string) {
+    fprintf(out, "%s <- string \"%s\"\n", assign_string.ident,
+            assign_string.value);
 }
 
-static void print_tac_ident(tac_ident ident) { printf("%s\n", ident.name); }
+static void print_tac_assign_bool(FILE *out, tac_assign_bool assign_bool) {
+    fprintf(out, "%s <- bool %s\n", assign_bool.ident,
+            assign_bool.value ? "true" : "false");
+}
+
+static void print_tac_box(FILE *out, tac_box box) {
+    fprintf(out, "%s <- box %s %s\n", box.ident, box.type, box.expr);
+}
+
+static void print_tac_jump_if_cond(FILE *out, tac_jump_if_cond jump) {
+    if (jump.rhs == NULL) {
+        fprintf(out, "bt %s %s %s\n", codegen_tac_cond_name(jump.cond),
+                jump.lhs, jump.label);
+    } else {
+        fprintf(out, "bt %s %s %s %s\n", jump.lhs,
+                codegen_tac_cond_name(jump.cond), jump.rhs, jump.label);
+    }
+}
+
+static void print_tac_jump_case(FILE *out, tac_jump_case jump) {
+    fprintf(out, "case %s", jump.expr);
+    for (size_t i = 0; i < jump.branches.count; i++) {
+        tac_case_branch *branch = NULL;
+        ds_dynamic_array_get_ref(&jump.branches, i, (void **)&branch);
+
+        fprintf(out, " %s %s", branch->type, branch->label);
+    }
+    fprintf(out, " else %s\n", jump.default_label);
+}
 
-static void print_tac_assign_int(tac_assign_int assign_int) {
-    printf("%s <- int %d\n", assign_int.ident, assign_int.value);
+static void print_tac_attr_load(FILE *out, tac_attr attr) {
+    fprintf(out, "%s <- %s.%s\n", attr.ident, attr.object, attr.attribute);
 }
 
-static void print_tac_assign_string(tac_assign_string assign_string) {
-    printf("%s <- string \"%s\"\n", assign_string.ident, assign_string.value);
+static void print_tac_attr_store(FILE *out, tac_attr attr) {
+    fprintf(out, "%s.%s <- %s\n", attr.object, attr.attribute, attr.ident);
 }
 
-static void print_tac_assign_bool(tac_assign_bool assign_bool) {
-    printf("%s <- bool %s\n", assign_bool.ident,
-           assign_bool.value ? "true" : "false");
+static void print_tac_phi(FILE *out, tac_phi phi) {
+    fprintf(out, "%s <- phi(", phi.ident);
+    for (size_t i = 0; i < phi.args.count; i++) {
+        tac_phi_arg *arg = NULL;
+        ds_dynamic_array_get_ref(&phi.args, i, (void **)&arg);
+
+        fprintf(out, "%s%s %s", i > 0 ? ", " : "",
+                arg->value != NULL ? arg->value : "undef", arg->label);
+    }
+    fprintf(out, ")\n");
 }
 
-static void print_tac(tac_instr tac) {
+static void print_tac(FILE *out, tac_instr tac) {
     switch (tac.kind) {
     case TAC_LABEL:
-        return print_tac_label(tac.label);
+        return print_tac_label(out, tac.label);
     case TAC_JUMP:
-        return print_tac_jump(tac.jump);
+        return print_tac_jump(out, tac.jump);
     case TAC_JUMP_IF_TRUE:
-        return print_tac_jump_if_true(tac.jump_if_true);
+        return print_tac_jump_if_true(out, tac.jump_if_true);
     case TAC_ASSIGN_ISINSTANCE:
-        return print_tac_assign_isinstance(tac.isinstance);
+        return print_tac_assign_isinstance(out, tac.isinstance);
     case TAC_CAST:
-        return print_tac_cast(tac.cast);
+        return print_tac_cast(out, tac.cast);
     case TAC_ASSIGN_VALUE:
-        return print_tac_assign_value(tac.assign_value);
+        return print_tac_assign_value(out, tac.assign_value);
     case TAC_DISPATCH_CALL:
-        return print_tac_dispatch_call(tac.dispatch_call);
+        return print_tac_dispatch_call(out, tac.dispatch_call);
     case TAC_ASSIGN_NEW:
-        return print_tac_assign_new(tac.assign_new);
+        return print_tac_assign_new(out, tac.assign_new);
     case TAC_ASSIGN_DEFAULT:
-        return print_tac_assign_default(tac.assign_default);
+        return print_tac_assign_default(out, tac.assign_default);
     case TAC_ASSIGN_ISVOID:
-        return print_tac_assign_unary(tac.assign_unary, "isvoid");
+        return print_tac_assign_unary(out, tac.assign_unary, "isvoid");
     case TAC_ASSIGN_ADD:
-        return print_tac_assign_binary(tac.assign_binary, "+");
+        return print_tac_assign_binary(out, tac.assign_binary, "+");
     case TAC_ASSIGN_SUB:
-        return print_tac_assign_binary(tac.assign_binary, "-");
+        return print_tac_assign_binary(out, tac.assign_binary, "-");
     case TAC_ASSIGN_MUL:
-        return print_tac_assign_binary(tac.assign_binary, "*");
+        return print_tac_assign_binary(out, tac.assign_binary, "*");
     case TAC_ASSIGN_DIV:
-        return print_tac_assign_binary(tac.assign_binary, "/");
+        return print_tac_assign_binary(out, tac.assign_binary, "/");
     case TAC_ASSIGN_NEG:
-        return print_tac_assign_unary(tac.assign_unary, "~");
+        return print_tac_assign_unary(out, tac.assign_unary, "~");
     case TAC_ASSIGN_LT:
-        return print_tac_assign_binary(tac.assign_binary, "<");
+        return print_tac_assign_binary(out, tac.assign_binary, "<");
     case TAC_ASSIGN_LE:
-        return print_tac_assign_binary(tac.assign_binary, "<=");
+        return print_tac_assign_binary(out, tac.assign_binary, "<=");
     case TAC_ASSIGN_EQ:
-        return print_tac_assign_eq(tac.assign_eq);
+        return print_tac_assign_eq(out, tac.assign_eq);
     case TAC_ASSIGN_NOT:
-        return print_tac_assign_unary(tac.assign_unary, "not");
+        return print_tac_assign_unary(out, tac.assign_unary, "not");
     case TAC_IDENT:
-        return print_tac_ident(tac.ident);
+        return print_tac_ident(out, tac.ident);
     case TAC_ASSIGN_INT:
-        return print_tac_assign_int(tac.assign_int);
+        return print_tac_assign_int(out, tac.assign_int);
     case TAC_ASSIGN_STRING:
-        return print_tac_assign_string(tac.assign_string);
+        return print_tac_assign_string(out, tac.assign_string);
     case TAC_ASSIGN_BOOL:
-        return print_tac_assign_bool(tac.assign_bool);
+        return print_tac_assign_bool(out, tac.assign_bool);
+    case TAC_BOX:
+        return print_tac_box(out, tac.box);
+    case TAC_UNBOX:
+        return print_tac_assign_unary(out, tac.unbox, "unbox");
+    case TAC_JUMP_IF_COND:
+        return print_tac_jump_if_cond(out, tac.jump_if_cond);
+    case TAC_JUMP_CASE:
+        return print_tac_jump_case(out, tac.jump_case);
+    case TAC_ATTR_LOAD:
+        return print_tac_attr_load(out, tac.attr);
+    case TAC_ATTR_STORE:
+        return print_tac_attr_store(out, tac.attr);
+    case TAC_PHI:
+        return print_tac_phi(out, tac.phi);
     default:
         DS_PANIC("Unknown tac kind");
     }
 }
 
-void codegen_tac_print(semantic_mapping *mapping, program_node *program) {
+// print the TAC of the methods of a program, after the passes of the
+// pipeline up to stop_after have run on it when stop_after is not NULL
+void codegen_tac_print(semantic_mapping *mapping, program_node *program,
+                       tac_pipeline *pipeline, const char *stop_after) {
+    tac_stats stats = {0};
+
     for (unsigned int i = 0; i < program->classes.count; i++) {
         class_node class;
         ds_dynamic_array_get(&program->classes, i, &class);
@@ -154,13 +232,142 @@ void codegen_tac_print(semantic_mapping *mapping, program_node *program) {
             tac_result tac;
             codegen_expr_to_tac(mapping, &method.body, &tac);
 
+            if (stop_after != NULL) {
+                tac_pass_context context = {.mapping = mapping,
+                                            .class_name = class.name.value,
+                                            .method_name = method.name.value,
+                                            .stats = &stats};
+                codegen_tac_pipeline_run(pipeline, &context, &tac, stop_after);
+            }
+
             printf("%s.%s\n", class.name.value, method.name.value);
             for (unsigned int k = 0; k < tac.instrs.count; k++) {
                 tac_instr instr;
                 ds_dynamic_array_get(&tac.instrs, k, &instr);
 
-                print_tac(instr);
+                print_tac(stdout, instr);
             }
         }
     }
 }
+
+// write the text of an instruction as part of a Graphviz label, with the
+// lines left justified
+static void print_dot_instr(FILE *out, tac_instr instr) {
+    char *text = NULL;
+    size_t length = 0;
+    FILE *stream = open_memstream(&text, &length);
+    print_tac(stream, instr);
+    fclose(stream);
+
+    for (size_t i = 0; i < length; i++) {
+        switch (text[i]) {
+        case '\n':
+            // only the last one ends the line, the others are in strings
+            fprintf(out, i + 1 == length ? "\\l" : "\\\\n");
+            break;
+        case '"':
+        case '\\':
+            fprintf(out, "\\%c", text[i]);
+            break;
+        default:
+            fputc(text[i], out);
+            break;
+        }
+    }
+
+    free(text);
+}
+
+static void print_dot_cfg(FILE *out, const char *name, tac_result *tac) {
+    tac_cfg cfg;
+    codegen_tac_cfg_build(tac, &cfg);
+
+    tac_liveness liveness;
+    codegen_tac_liveness(&cfg, &liveness);
+
+    fprintf(out, "    subgraph \"cluster_%s\" {\n", name);
+    fprintf(out, "        label=\"%s\";\n", name);
+
+    for (size_t b = 0; b < cfg.blocks.count; b++) {
+        tac_basic_block *block = NULL;
+        ds_dynamic_array_get_ref(&cfg.blocks, b, (void **)&block);
+
+        fprintf(out, "        \"%s:B%zu\" [label=\"B%zu\\l", name, b, b);
+        for (size_t i = block->first; i < block->last; i++) {
+            tac_instr instr;
+            ds_dynamic_array_get(&tac->instrs, i, &instr);
+            print_dot_instr(out, instr);
+        }
+
+        fprintf(out, "live out:");
+        uint64_t *live = liveness.out + (block->last - 1) * liveness.words;
+        for (size_t v = 0; v < tac->locals.count; v++) {
+            if (tac_set_has(live, v)) {
+                tac_local *local = NULL;
+                ds_dynamic_array_get_ref(&tac->locals, v, (void **)&local);
+                fprintf(out, " %s", local->name);
+            }
+        }
+        fprintf(out, "\\l\"];\n");
+
+        for (size_t s = 0; s < block->successors.count; s++) {
+            size_t successor = 0;
+            ds_dynamic_array_get(&block->successors, s, &successor);
+
+            fprintf(out, "        \"%s:B%zu\" -> \"%s:B%zu\";\n", name, b,
+                    name, successor);
+        }
+    }
+
+    fprintf(out, "    }\n");
+
+    codegen_tac_liveness_free(&liveness);
+    codegen_tac_cfg_free(&cfg);
+}
+
+// print the control flow graphs of the methods of a program in the
+// Graphviz format, one cluster for each method
+void codegen_tac_print_cfg(semantic_mapping *mapping, program_node *program,
+                           tac_pipeline *pipeline, const char *stop_after) {
+    tac_stats stats = {0};
+
+    printf("digraph tac {\n");
+    printf("    node [shape=box, fontname=monospace];\n");
+
+    for (unsigned int i = 0; i < program->classes.count; i++) {
+        class_node class;
+        ds_dynamic_array_get(&program->classes, i, &class);
+
+        for (unsigned int j = 0; j < class.methods.count; j++) {
+            method_node method;
+            ds_dynamic_array_get(&class.methods, j, &method);
+
+            if (method.body.kind == EXPR_EXTERN) {
+                continue;
+            }
+
+            tac_result tac;
+            codegen_expr_to_tac(mapping, &method.body, &tac);
+
+            if (stop_after != NULL) {
+                tac_pass_context context = {.mapping = mapping,
+                                            .class_name = class.name.value,
+                                            .method_name = method.name.value,
+                                            .stats = &stats};
+                codegen_tac_pipeline_run(pipeline, &context, &tac, stop_after);
+            }
+
+            char *name = NULL;
+            size_t length = 0;
+            FILE *stream = open_memstream(&name, &length);
+            fprintf(stream, "%s.%s", class.name.value, method.name.value);
+            fclose(stream);
+
+            print_dot_cfg(stdout, name, &tac);
+            free(name);
+        }
+    }
+
+    printf("}\n");
+}
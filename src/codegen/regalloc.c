@@ -0,0 +1,186 @@
+#include "codegen.h"
+#include "ds.h"
+
+// Linear scan register allocation of the TAC locals. The live interval of
+// every local is computed from the liveness of the instructions; the locals
+// that are live across a call can only be kept in callee saved registers,
+// the other ones prefer the caller saved registers that the emitted code
+// does not touch. When there are no registers left the interval that ends
+// last is spilled to a stack slot. The registers that carry arguments are
+// left out, so loading them for a call never overwrites an operand.
+
+static const char *caller_saved[] = {"rcx", "r10", "r11"};
+
+const char *codegen_tac_callee_saved[TAC_CALLEE_SAVED_COUNT] = {"r12", "r13",
+                                                                "r14", "r15"};
+
+#define CALLER_SAVED_COUNT (sizeof(caller_saved) / sizeof(caller_saved[0]))
+#define REGISTER_COUNT (CALLER_SAVED_COUNT + TAC_CALLEE_SAVED_COUNT)
+
+typedef struct tac_interval {
+        size_t local;
+        int start;
+        int end;
+        int crosses_call;
+        int reg; // index in caller_saved followed by callee_saved, -1 if none
+} tac_interval;
+
+static int tac_interval_compare(const void *a, const void *b) {
+    const tac_interval *lhs = a;
+    const tac_interval *rhs = b;
+
+    if (lhs->start != rhs->start) {
+        return lhs->start - rhs->start;
+    }
+
+    return (int)lhs->local - (int)rhs->local;
+}
+
+static void tac_build_intervals(tac_result *tac, tac_liveness *liveness,
+                                ds_dynamic_array *intervals) {
+    ds_dynamic_array_init(intervals, sizeof(tac_interval));
+
+    // the local written by each instruction
+    int *defs = malloc(sizeof(int) * (tac->instrs.count + 1));
+    for (size_t i = 0; i < tac->instrs.count; i++) {
+        tac_instr *instr = NULL;
+        ds_dynamic_array_get_ref(&tac->instrs, i, (void **)&instr);
+
+        char **ident = codegen_tac_instr_def(instr);
+        defs[i] = ident != NULL ? codegen_tac_local_index(tac, *ident) : -1;
+    }
+
+    for (size_t v = 0; v < tac->locals.count; v++) {
+        tac_interval interval = {
+            .local = v, .start = -1, .end = -1, .crosses_call = 0, .reg = -1};
+
+        for (size_t i = 0; i < tac->instrs.count; i++) {
+            tac_instr *instr = NULL;
+            ds_dynamic_array_get_ref(&tac->instrs, i, (void **)&instr);
+
+            int live_in =
+                tac_set_has(liveness->in + i * liveness->words, v);
+            int live_out =
+                tac_set_has(liveness->out + i * liveness->words, v);
+            int defined = defs[i] == (int)v;
+
+            if (live_in || defined) {
+                if (interval.start < 0) {
+                    interval.start = i;
+                }
+                interval.end = i;
+            }
+
+            if (codegen_tac_instr_is_call(instr) && live_out && !defined) {
+                interval.crosses_call = 1;
+            }
+        }
+
+        if (interval.start >= 0) {
+            ds_dynamic_array_append(intervals, &interval);
+        }
+    }
+
+    free(defs);
+    ds_dynamic_array_sort(intervals, tac_interval_compare);
+}
+
+static int tac_register_allowed(tac_interval *interval, int reg) {
+    return !interval->crosses_call || reg >= (int)CALLER_SAVED_COUNT;
+}
+
+static const char *tac_register_name(int reg) {
+    if (reg < (int)CALLER_SAVED_COUNT) {
+        return caller_saved[reg];
+    }
+
+    return codegen_tac_callee_saved[reg - CALLER_SAVED_COUNT];
+}
+
+void codegen_tac_regalloc(tac_result *tac) {
+    tac_cfg cfg;
+    codegen_tac_cfg_build(tac, &cfg);
+
+    tac_liveness liveness;
+    codegen_tac_liveness(&cfg, &liveness);
+
+    ds_dynamic_array intervals; // tac_interval
+    tac_build_intervals(tac, &liveness, &intervals);
+    codegen_tac_liveness_free(&liveness);
+    codegen_tac_cfg_free(&cfg);
+
+    tac_interval **active = calloc(REGISTER_COUNT, sizeof(tac_interval *));
+    int *spilled = calloc(tac->locals.count + 1, sizeof(int));
+
+    for (size_t i = 0; i < intervals.count; i++) {
+        tac_interval *current = NULL;
+        ds_dynamic_array_get_ref(&intervals, i, (void **)&current);
+
+        // free the registers of the intervals that ended
+        for (size_t r = 0; r < REGISTER_COUNT; r++) {
+            if (active[r] != NULL && active[r]->end < current->start) {
+                active[r] = NULL;
+            }
+        }
+
+        for (size_t r = 0; r < REGISTER_COUNT; r++) {
+            if (active[r] == NULL && tac_register_allowed(current, r)) {
+                current->reg = r;
+                active[r] = current;
+                break;
+            }
+        }
+
+        if (current->reg >= 0) {
+            continue;
+        }
+
+        // spill the interval that ends last
+        int victim = -1;
+        for (size_t r = 0; r < REGISTER_COUNT; r++) {
+            if (!tac_register_allowed(current, r)) {
+                continue;
+            }
+
+            if (victim < 0 || active[r]->end > active[victim]->end) {
+                victim = r;
+            }
+        }
+
+        if (victim >= 0 && active[victim]->end > current->end) {
+            spilled[active[victim]->local] = 1;
+            active[victim]->reg = -1;
+            current->reg = victim;
+            active[victim] = current;
+        } else {
+            spilled[current->local] = 1;
+        }
+    }
+
+    for (size_t v = 0; v < tac->locals.count; v++) {
+        tac_local *local = NULL;
+        ds_dynamic_array_get_ref(&tac->locals, v, (void **)&local);
+
+        local->reg = NULL;
+        local->slot = -1;
+    }
+
+    int slots = 0;
+    for (size_t i = 0; i < intervals.count; i++) {
+        tac_interval *interval = NULL;
+        ds_dynamic_array_get_ref(&intervals, i, (void **)&interval);
+
+        tac_local *local = NULL;
+        ds_dynamic_array_get_ref(&tac->locals, interval->local, (void **)&local);
+
+        if (spilled[interval->local]) {
+            local->slot = slots++;
+        } else {
+            local->reg = tac_register_name(interval->reg);
+        }
+    }
+
+    free(active);
+    free(spilled);
+    ds_dynamic_array_free(&intervals);
+}
@@ -0,0 +1,58 @@
+#include "codegen.h"
+#include "ds.h"
+
+// Stateless classes. An object of a class without attributes, its own or
+// inherited, carries nothing but its tag, so every `new` of the class can
+// hand out the same one: the prototype of the class in the data section,
+// which nothing ever writes to. Helpers like Linux, made again for every
+// call, are the ones this is meant for.
+//
+// A class with no methods besides those of Object is only good for its
+// identity (`new Object` as a unique marker), and one with a `copy` of its
+// own may count on fresh objects, so both are left alone.
+
+static int tac_is_stateless_class(semantic_mapping *mapping,
+                                  const char *type) {
+    if (codegen_tac_is_basic_class(type)) {
+        return 0;
+    }
+
+    semantic_mapping_item *item = codegen_tac_find_class(mapping, type);
+    if (item == NULL || item->attributes.count > 0) {
+        return 0;
+    }
+
+    int methods = 0;
+    for (size_t j = 0; j < item->methods.count; j++) {
+        implementation_mapping_item *method = NULL;
+        ds_dynamic_array_get_ref(&item->methods, j, (void **)&method);
+
+        if (strcmp(method->from_class, "Object") == 0) {
+            continue;
+        }
+
+        // a copy of its own may count on getting a fresh object
+        if (strcmp(method->method_name, "copy") == 0) {
+            return 0;
+        }
+        methods++;
+    }
+
+    return methods > 0;
+}
+
+void codegen_tac_share_stateless(semantic_mapping *mapping, tac_result *tac,
+                                 tac_stats *stats) {
+    for (size_t i = 0; i < tac->instrs.count; i++) {
+        tac_instr *instr = NULL;
+        ds_dynamic_array_get_ref(&tac->instrs, i, (void **)&instr);
+
+        if (instr->kind != TAC_ASSIGN_NEW || instr->assign_new.shared ||
+            !tac_is_stateless_class(mapping, instr->assign_new.type)) {
+            continue;
+        }
+
+        instr->assign_new.shared = 1;
+        stats->shared++;
+    }
+}
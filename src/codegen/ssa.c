@@ -0,0 +1,675 @@
+#include "codegen.h"
+#include "ds.h"
+
+// SSA form. The locals that are written more than once (let variables and
+// the results of if, case and loops) get a new version `x.1`, `x.2`, ... at
+// every definition, and phis are placed on the dominance frontiers of the
+// blocks that define them, but only where the variable is live. Every
+// block starts with a label so that phis can name their predecessors.
+//
+// Out of SSA, every phi becomes copies at the end of its predecessors. An
+// edge from a block that branches elsewhere too gets a block of its own for
+// the copies, so they do not run on the other path.
+
+typedef struct tac_ssa_context {
+        tac_result *tac;
+        tac_cfg cfg;
+
+        tac_dominators dominators;
+        ds_dynamic_array *phis;       // tac_instr, the phis of each block
+        ds_dynamic_array *phi_locals; // int, the local of each phi
+
+        size_t locals;                // locals before renaming
+        int *renamed;                 // locals written more than once
+        int *versions;                // last version of each local
+        ds_dynamic_array *stacks;     // char *, current name of each local
+} tac_ssa_context;
+
+// the label at the start of a block
+static char *tac_block_label(tac_cfg *cfg, size_t b) {
+    tac_instr *instr =
+        codegen_tac_get_instr(cfg->tac, codegen_tac_get_block(cfg, b)->first);
+    return instr->kind == TAC_LABEL ? instr->label.label : NULL;
+}
+
+// the argument of a phi for the edge from the block of the label
+static tac_phi_arg *tac_phi_arg_of(tac_phi *phi, const char *label) {
+    if (label == NULL) {
+        return NULL;
+    }
+
+    for (size_t a = 0; a < phi->args.count; a++) {
+        tac_phi_arg *arg = NULL;
+        ds_dynamic_array_get_ref(&phi->args, a, (void **)&arg);
+
+        if (strcmp(arg->label, label) == 0) {
+            return arg;
+        }
+    }
+
+    return NULL;
+}
+
+// a pass that moves the end of a block behind a new label (inlining a call)
+// makes that label the predecessor of the phis the block flowed into
+void codegen_tac_retarget_phis(tac_result *tac, const char *from, char *to) {
+    for (size_t i = 0; i < tac->instrs.count; i++) {
+        tac_instr *instr = codegen_tac_get_instr(tac, i);
+        if (instr->kind != TAC_PHI) {
+            continue;
+        }
+
+        for (size_t a = 0; a < instr->phi.args.count; a++) {
+            tac_phi_arg *arg = NULL;
+            ds_dynamic_array_get_ref(&instr->phi.args, a, (void **)&arg);
+
+            if (strcmp(arg->label, from) == 0) {
+                arg->label = to;
+            }
+        }
+    }
+}
+
+// give every block a label, so that phis can refer to their predecessors
+static void tac_label_blocks(tac_result *tac) {
+    tac_cfg cfg;
+    codegen_tac_cfg_build(tac, &cfg);
+
+    ds_dynamic_array instrs;
+    ds_dynamic_array_init(&instrs, sizeof(tac_instr));
+
+    for (size_t b = 0; b < cfg.blocks.count; b++) {
+        tac_basic_block *block = codegen_tac_get_block(&cfg, b);
+
+        // the entry block must not be the target of a jump
+        if (tac_block_label(&cfg, b) == NULL ||
+            (b == 0 && block->predecessors.count > 0)) {
+            tac_instr label = {.kind = TAC_LABEL,
+                               .label = {codegen_tac_new_label(tac)}};
+            ds_dynamic_array_append(&instrs, &label);
+        }
+
+        for (size_t i = block->first; i < block->last; i++) {
+            ds_dynamic_array_append(&instrs, codegen_tac_get_instr(tac, i));
+        }
+    }
+
+    codegen_tac_cfg_free(&cfg);
+
+    ds_dynamic_array_free(&tac->instrs);
+    tac->instrs = instrs;
+}
+
+static int tac_is_reachable(tac_ssa_context *context, size_t b) {
+    return b == 0 || context->dominators.idom[b] >= 0;
+}
+
+// the dominance frontier of every block, as a set of blocks
+static uint64_t *tac_frontiers(tac_ssa_context *context) {
+    tac_cfg *cfg = &context->cfg;
+    size_t blocks = cfg->blocks.count;
+    size_t words = tac_set_words(blocks);
+
+    uint64_t *frontiers = calloc(blocks * words + 1, sizeof(uint64_t));
+
+    for (size_t b = 0; b < blocks; b++) {
+        tac_basic_block *block = codegen_tac_get_block(cfg, b);
+        if (!tac_is_reachable(context, b) || block->predecessors.count < 2) {
+            continue;
+        }
+
+        for (size_t p = 0; p < block->predecessors.count; p++) {
+            size_t runner = 0;
+            ds_dynamic_array_get(&block->predecessors, p, &runner);
+            if (!tac_is_reachable(context, runner)) {
+                continue;
+            }
+
+            while ((int)runner != context->dominators.idom[b]) {
+                tac_set_add(frontiers + runner * words, b);
+                if (runner == 0) {
+                    break;
+                }
+                runner = context->dominators.idom[runner];
+            }
+        }
+    }
+
+    return frontiers;
+}
+
+static void tac_place_phis(tac_ssa_context *context) {
+    tac_result *tac = context->tac;
+    tac_cfg *cfg = &context->cfg;
+    size_t blocks = cfg->blocks.count;
+    size_t words = tac_set_words(blocks);
+
+    tac_liveness liveness;
+    codegen_tac_liveness(cfg, &liveness);
+
+    uint64_t *frontiers = tac_frontiers(context);
+
+    // the blocks that write each local
+    size_t locals = tac->locals.count;
+    int *defs = calloc(locals + 1, sizeof(int));
+    uint64_t *def_blocks = calloc(locals * words + 1, sizeof(uint64_t));
+    for (size_t i = 0; i < tac->instrs.count; i++) {
+        char **ident = codegen_tac_instr_def(codegen_tac_get_instr(tac, i));
+        if (ident == NULL) {
+            continue;
+        }
+
+        int v = codegen_tac_local_index(tac, *ident);
+        if (v >= 0) {
+            defs[v]++;
+            tac_set_add(def_blocks + v * words, cfg->block_of[i]);
+        }
+    }
+
+    context->renamed = calloc(locals + 1, sizeof(int));
+    context->phis = malloc(sizeof(ds_dynamic_array) * (blocks + 1));
+    context->phi_locals = malloc(sizeof(ds_dynamic_array) * (blocks + 1));
+    for (size_t b = 0; b < blocks; b++) {
+        ds_dynamic_array_init(&context->phis[b], sizeof(tac_instr));
+        ds_dynamic_array_init(&context->phi_locals[b], sizeof(int));
+    }
+
+    uint64_t *has_phi = calloc(words + 1, sizeof(uint64_t));
+    ds_dynamic_array worklist; // size_t
+    ds_dynamic_array_init(&worklist, sizeof(size_t));
+
+    for (size_t v = 0; v < locals; v++) {
+        if (defs[v] < 2) {
+            continue;
+        }
+        context->renamed[v] = 1;
+
+        tac_local *local = NULL;
+        ds_dynamic_array_get_ref(&tac->locals, v, (void **)&local);
+
+        memset(has_phi, 0, words * sizeof(uint64_t));
+        worklist.count = 0;
+        for (size_t b = 0; b < blocks; b++) {
+            if (tac_set_has(def_blocks + v * words, b)) {
+                ds_dynamic_array_append(&worklist, &b);
+            }
+        }
+
+        while (worklist.count > 0) {
+            size_t b = 0;
+            ds_dynamic_array_get(&worklist, worklist.count - 1, &b);
+            worklist.count--;
+
+            for (size_t d = 0; d < blocks; d++) {
+                if (!tac_set_has(frontiers + b * words, d) ||
+                    tac_set_has(has_phi, d)) {
+                    continue;
+                }
+
+                // a phi is only needed where the variable is live
+                size_t first = codegen_tac_get_block(cfg, d)->first;
+                if (!tac_set_has(liveness.in + first * liveness.words, v)) {
+                    continue;
+                }
+
+                tac_set_add(has_phi, d);
+                tac_instr phi = {.kind = TAC_PHI,
+                                 .phi = {.ident = local->name}};
+                ds_dynamic_array_init(&phi.phi.args, sizeof(tac_phi_arg));
+                ds_dynamic_array_append(&context->phis[d], &phi);
+                int local_index = v;
+                ds_dynamic_array_append(&context->phi_locals[d], &local_index);
+
+                if (!tac_set_has(def_blocks + v * words, d)) {
+                    ds_dynamic_array_append(&worklist, &d);
+                }
+            }
+        }
+    }
+
+    ds_dynamic_array_free(&worklist);
+    free(has_phi);
+    free(def_blocks);
+    free(defs);
+    free(frontiers);
+    codegen_tac_liveness_free(&liveness);
+}
+
+static char *tac_new_version(tac_ssa_context *context, int v) {
+    tac_result *tac = context->tac;
+
+    tac_local *local = NULL;
+    ds_dynamic_array_get_ref(&tac->locals, v, (void **)&local);
+
+    int version = ++context->versions[v];
+    int needed = snprintf(NULL, 0, "%s.%d", local->name, version) + 1;
+    char *name = malloc(needed);
+    snprintf(name, needed, "%s.%d", local->name, version);
+
+    tac_local copy = *local;
+    copy.name = name;
+    copy.slot = tac->locals.count;
+    ds_dynamic_array_append(&tac->locals, &copy);
+
+    ds_dynamic_array_append(&context->stacks[v], &name);
+    return name;
+}
+
+static char *tac_current_name(tac_ssa_context *context, int v) {
+    ds_dynamic_array *stack = &context->stacks[v];
+    if (stack->count == 0) {
+        return NULL;
+    }
+
+    char *name = NULL;
+    ds_dynamic_array_get(stack, stack->count - 1, &name);
+    return name;
+}
+
+// the local a name refers to, -1 if it is not renamed
+static int tac_renamed_local(tac_ssa_context *context, const char *name) {
+    if (name == NULL) {
+        return -1;
+    }
+
+    int v = codegen_tac_local_index(context->tac, name);
+    if (v < 0 || (size_t)v >= context->locals || !context->renamed[v]) {
+        return -1;
+    }
+
+    return v;
+}
+
+static void tac_rename_block(tac_ssa_context *context, size_t b) {
+    tac_result *tac = context->tac;
+    tac_cfg *cfg = &context->cfg;
+    tac_basic_block *block = codegen_tac_get_block(cfg, b);
+
+    // the locals that got a new name in this block
+    ds_dynamic_array pushed; // int
+    ds_dynamic_array_init(&pushed, sizeof(int));
+
+    for (size_t p = 0; p < context->phis[b].count; p++) {
+        tac_instr *phi = NULL;
+        ds_dynamic_array_get_ref(&context->phis[b], p, (void **)&phi);
+
+        int v = 0;
+        ds_dynamic_array_get(&context->phi_locals[b], p, &v);
+
+        phi->phi.ident = tac_new_version(context, v);
+        ds_dynamic_array_append(&pushed, &v);
+    }
+
+    for (size_t i = block->first; i < block->last; i++) {
+        tac_instr *instr = codegen_tac_get_instr(tac, i);
+
+        ds_dynamic_array uses;
+        codegen_tac_instr_uses(instr, &uses);
+        for (size_t j = 0; j < uses.count; j++) {
+            char **operand = NULL;
+            ds_dynamic_array_get(&uses, j, &operand);
+
+            int v = tac_renamed_local(context, *operand);
+            char *name = v >= 0 ? tac_current_name(context, v) : NULL;
+            if (name != NULL) {
+                *operand = name;
+            }
+        }
+        ds_dynamic_array_free(&uses);
+
+        char **ident = codegen_tac_instr_def(instr);
+        int v = ident != NULL ? tac_renamed_local(context, *ident) : -1;
+        if (v >= 0) {
+            *ident = tac_new_version(context, v);
+            ds_dynamic_array_append(&pushed, &v);
+        }
+    }
+
+    char *label = tac_block_label(cfg, b);
+    for (size_t s = 0; s < block->successors.count; s++) {
+        size_t successor = 0;
+        ds_dynamic_array_get(&block->successors, s, &successor);
+
+        for (size_t p = 0; p < context->phis[successor].count; p++) {
+            tac_instr *phi = NULL;
+            ds_dynamic_array_get_ref(&context->phis[successor], p,
+                                     (void **)&phi);
+
+            int v = 0;
+            ds_dynamic_array_get(&context->phi_locals[successor], p, &v);
+
+            tac_phi_arg arg = {.value = tac_current_name(context, v),
+                               .label = label};
+            ds_dynamic_array_append(&phi->phi.args, &arg);
+        }
+    }
+
+    for (size_t c = 0; c < context->dominators.children[b].count; c++) {
+        size_t child = 0;
+        ds_dynamic_array_get(&context->dominators.children[b], c, &child);
+        tac_rename_block(context, child);
+    }
+
+    for (size_t p = 0; p < pushed.count; p++) {
+        int v = 0;
+        ds_dynamic_array_get(&pushed, p, &v);
+        context->stacks[v].count--;
+    }
+    ds_dynamic_array_free(&pushed);
+}
+
+void codegen_tac_to_ssa(tac_result *tac) {
+    if (tac->ssa || tac->instrs.count == 0) {
+        return;
+    }
+
+    tac_label_blocks(tac);
+
+    tac_ssa_context context = {.tac = tac, .locals = tac->locals.count};
+    codegen_tac_cfg_build(tac, &context.cfg);
+    size_t blocks = context.cfg.blocks.count;
+
+    codegen_tac_dominators(&context.cfg, &context.dominators);
+    tac_place_phis(&context);
+
+    context.versions = calloc(context.locals + 1, sizeof(int));
+    context.stacks = malloc(sizeof(ds_dynamic_array) * (context.locals + 1));
+    for (size_t v = 0; v < context.locals; v++) {
+        ds_dynamic_array_init(&context.stacks[v], sizeof(char *));
+    }
+
+    tac_rename_block(&context, 0);
+
+    // the phis go right after the label of their block
+    ds_dynamic_array instrs;
+    ds_dynamic_array_init(&instrs, sizeof(tac_instr));
+    for (size_t b = 0; b < blocks; b++) {
+        tac_basic_block *block = codegen_tac_get_block(&context.cfg, b);
+
+        ds_dynamic_array_append(&instrs,
+                                codegen_tac_get_instr(tac, block->first));
+        for (size_t p = 0; p < context.phis[b].count; p++) {
+            tac_instr *phi = NULL;
+            ds_dynamic_array_get_ref(&context.phis[b], p, (void **)&phi);
+            ds_dynamic_array_append(&instrs, phi);
+        }
+        for (size_t i = block->first + 1; i < block->last; i++) {
+            ds_dynamic_array_append(&instrs, codegen_tac_get_instr(tac, i));
+        }
+    }
+
+    ds_dynamic_array_free(&tac->instrs);
+    tac->instrs = instrs;
+    tac->ssa = 1;
+
+    for (size_t v = 0; v < context.locals; v++) {
+        ds_dynamic_array_free(&context.stacks[v]);
+    }
+    for (size_t b = 0; b < blocks; b++) {
+        ds_dynamic_array_free(&context.phis[b]);
+        ds_dynamic_array_free(&context.phi_locals[b]);
+    }
+    free(context.stacks);
+    free(context.versions);
+    free(context.renamed);
+    free(context.phis);
+    free(context.phi_locals);
+    codegen_tac_dominators_free(&context.dominators);
+    codegen_tac_cfg_free(&context.cfg);
+}
+
+static void tac_append_copy(ds_dynamic_array *instrs, char *ident,
+                            char *expr) {
+    tac_instr copy = {.kind = TAC_ASSIGN_VALUE,
+                      .assign_value = {.ident = ident, .expr = expr}};
+    ds_dynamic_array_append(instrs, &copy);
+}
+
+// the copies for the phis of block b on the edge from block p, as if they
+// all happened at once
+static void tac_phi_copies(tac_result *tac, tac_cfg *cfg, size_t b, size_t p,
+                           ds_dynamic_array *instrs) {
+    tac_basic_block *block = codegen_tac_get_block(cfg, b);
+    const char *label = tac_block_label(cfg, p);
+
+    ds_dynamic_array dests;   // char *
+    ds_dynamic_array sources; // char *
+    ds_dynamic_array_init(&dests, sizeof(char *));
+    ds_dynamic_array_init(&sources, sizeof(char *));
+
+    for (size_t i = block->first; i < block->last; i++) {
+        tac_instr *instr = codegen_tac_get_instr(tac, i);
+        if (instr->kind != TAC_PHI) {
+            continue;
+        }
+
+        tac_phi_arg *arg = tac_phi_arg_of(&instr->phi, label);
+        if (arg != NULL && arg->value != NULL &&
+            strcmp(arg->value, instr->phi.ident) != 0) {
+            ds_dynamic_array_append(&dests, &instr->phi.ident);
+            ds_dynamic_array_append(&sources, &arg->value);
+        }
+    }
+
+    // a source that is also written by another copy is saved first
+    int overlap = 0;
+    for (size_t i = 0; i < sources.count && !overlap; i++) {
+        char *source = NULL;
+        ds_dynamic_array_get(&sources, i, &source);
+
+        for (size_t j = 0; j < dests.count; j++) {
+            char *dest = NULL;
+            ds_dynamic_array_get(&dests, j, &dest);
+            if (strcmp(source, dest) == 0) {
+                overlap = 1;
+                break;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < dests.count; i++) {
+        char *dest = NULL;
+        char *source = NULL;
+        ds_dynamic_array_get(&dests, i, &dest);
+        ds_dynamic_array_get(&sources, i, &source);
+
+        if (overlap) {
+            tac_local *local = codegen_tac_find_local(tac, dest);
+            char *temp = codegen_tac_new_local(tac, local->type, 0);
+            tac_append_copy(instrs, temp, source);
+
+            char **saved = NULL;
+            ds_dynamic_array_get_ref(&sources, i, (void **)&saved);
+            *saved = temp;
+        } else {
+            tac_append_copy(instrs, dest, source);
+        }
+    }
+
+    if (overlap) {
+        for (size_t i = 0; i < dests.count; i++) {
+            char *dest = NULL;
+            char *source = NULL;
+            ds_dynamic_array_get(&dests, i, &dest);
+            ds_dynamic_array_get(&sources, i, &source);
+            tac_append_copy(instrs, dest, source);
+        }
+    }
+
+    ds_dynamic_array_free(&dests);
+    ds_dynamic_array_free(&sources);
+}
+
+static int tac_has_phis(tac_result *tac, tac_basic_block *block) {
+    for (size_t i = block->first; i < block->last; i++) {
+        if (codegen_tac_get_instr(tac, i)->kind == TAC_PHI) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+void codegen_tac_from_ssa(tac_result *tac) {
+    if (!tac->ssa) {
+        return;
+    }
+
+    tac_cfg cfg;
+    codegen_tac_cfg_build(tac, &cfg);
+    size_t n = tac->instrs.count;
+
+    // instructions that go before and after each instruction
+    ds_dynamic_array *before = malloc(sizeof(ds_dynamic_array) * (n + 1));
+    ds_dynamic_array *after = malloc(sizeof(ds_dynamic_array) * (n + 1));
+    for (size_t i = 0; i < n; i++) {
+        ds_dynamic_array_init(&before[i], sizeof(tac_instr));
+        ds_dynamic_array_init(&after[i], sizeof(tac_instr));
+    }
+
+    for (size_t b = 0; b < cfg.blocks.count; b++) {
+        tac_basic_block *block = codegen_tac_get_block(&cfg, b);
+        if (!tac_has_phis(tac, block)) {
+            continue;
+        }
+
+        char *block_label = tac_block_label(&cfg, b);
+        int split = 0;
+
+        for (size_t k = 0; k < block->predecessors.count; k++) {
+            size_t p = 0;
+            ds_dynamic_array_get(&block->predecessors, k, &p);
+
+            tac_basic_block *pred = codegen_tac_get_block(&cfg, p);
+            size_t last = pred->last - 1;
+            tac_instr *end = codegen_tac_get_instr(tac, last);
+
+            ds_dynamic_array copies;
+            ds_dynamic_array_init(&copies, sizeof(tac_instr));
+            tac_phi_copies(tac, &cfg, b, p, &copies);
+
+            if (copies.count == 0) {
+                ds_dynamic_array_free(&copies);
+                continue;
+            }
+
+            ds_dynamic_array labels;
+            codegen_tac_instr_targets(end, &labels);
+            int falls_into = codegen_tac_instr_falls_through(end) &&
+                             pred->last == block->first;
+
+            if (end->kind == TAC_JUMP) {
+                // the copies run right before the jump
+                for (size_t c = 0; c < copies.count; c++) {
+                    tac_instr copy;
+                    ds_dynamic_array_get(&copies, c, &copy);
+                    ds_dynamic_array_append(&before[last], &copy);
+                }
+            } else if (labels.count == 0) {
+                // the block falls through into the phis
+                for (size_t c = 0; c < copies.count; c++) {
+                    tac_instr copy;
+                    ds_dynamic_array_get(&copies, c, &copy);
+                    ds_dynamic_array_append(&after[last], &copy);
+                }
+            } else {
+                // a conditional jump: the edge gets a block of its own,
+                // placed right before the phis, and the jump goes there
+                int jumps_here = 0;
+                for (size_t j = 0; j < labels.count; j++) {
+                    char **label = NULL;
+                    ds_dynamic_array_get(&labels, j, &label);
+                    if (strcmp(*label, block_label) == 0) {
+                        jumps_here = 1;
+                    }
+                }
+
+                if (falls_into) {
+                    // the fall through edge: the copies go first, right
+                    // after the conditional jump
+                    ds_dynamic_array reordered;
+                    ds_dynamic_array_init(&reordered, sizeof(tac_instr));
+                    for (size_t c = 0; c < copies.count; c++) {
+                        tac_instr copy;
+                        ds_dynamic_array_get(&copies, c, &copy);
+                        ds_dynamic_array_append(&reordered, &copy);
+                    }
+                    for (size_t c = 0; c < before[block->first].count; c++) {
+                        tac_instr instr;
+                        ds_dynamic_array_get(&before[block->first], c, &instr);
+                        ds_dynamic_array_append(&reordered, &instr);
+                    }
+                    ds_dynamic_array_free(&before[block->first]);
+                    before[block->first] = reordered;
+                }
+
+                if (jumps_here) {
+                    char *edge = codegen_tac_new_label(tac);
+                    for (size_t j = 0; j < labels.count; j++) {
+                        char **label = NULL;
+                        ds_dynamic_array_get(&labels, j, &label);
+                        if (strcmp(*label, block_label) == 0) {
+                            *label = edge;
+                        }
+                    }
+
+                    // the code falling into the phis jumps over the edge
+                    if (!split && block->first > 0 &&
+                        codegen_tac_instr_falls_through(
+                            codegen_tac_get_instr(tac, block->first - 1))) {
+                        tac_instr jump = {.kind = TAC_JUMP,
+                                          .jump = {block_label}};
+                        ds_dynamic_array_append(&before[block->first],
+                                                &jump);
+                    }
+                    split = 1;
+
+                    tac_instr label = {.kind = TAC_LABEL, .label = {edge}};
+                    ds_dynamic_array_append(&before[block->first], &label);
+                    for (size_t c = 0; c < copies.count; c++) {
+                        tac_instr copy;
+                        ds_dynamic_array_get(&copies, c, &copy);
+                        ds_dynamic_array_append(&before[block->first], &copy);
+                    }
+                    tac_instr jump = {.kind = TAC_JUMP, .jump = {block_label}};
+                    ds_dynamic_array_append(&before[block->first], &jump);
+                }
+            }
+
+            ds_dynamic_array_free(&labels);
+            ds_dynamic_array_free(&copies);
+        }
+    }
+
+    ds_dynamic_array instrs;
+    ds_dynamic_array_init(&instrs, sizeof(tac_instr));
+    for (size_t i = 0; i < n; i++) {
+        for (size_t c = 0; c < before[i].count; c++) {
+            tac_instr instr;
+            ds_dynamic_array_get(&before[i], c, &instr);
+            ds_dynamic_array_append(&instrs, &instr);
+        }
+
+        tac_instr *instr = codegen_tac_get_instr(tac, i);
+        if (instr->kind != TAC_PHI) {
+            ds_dynamic_array_append(&instrs, instr);
+        }
+
+        for (size_t c = 0; c < after[i].count; c++) {
+            tac_instr copy;
+            ds_dynamic_array_get(&after[i], c, &copy);
+            ds_dynamic_array_append(&instrs, &copy);
+        }
+
+        ds_dynamic_array_free(&before[i]);
+        ds_dynamic_array_free(&after[i]);
+    }
+
+    free(before);
+    free(after);
+    codegen_tac_cfg_free(&cfg);
+
+    ds_dynamic_array_free(&tac->instrs);
+    tac->instrs = instrs;
+    tac->ssa = 0;
+}
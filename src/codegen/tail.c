@@ -0,0 +1,131 @@
+#include "codegen.h"
+#include "ds.h"
+
+// Tail calls. A call whose result is what the method returns, with only
+// labels, jumps and copies of the result between the two, does not need
+// the frame of the method after it. The assembler then writes the
+// arguments over the ones the method got, tears down the frame and jumps
+// to the callee, which returns straight to the caller of the method; a
+// recursion through tail calls runs in constant stack space.
+//
+// The caller of the method frees the arguments passed on the stack, so
+// the callee can only take as many of those as there is room for: the ones
+// the method got and the word that pads an odd count.
+
+static int tac_find_label(tac_result *tac, const char *label) {
+    for (size_t i = 0; i < tac->instrs.count; i++) {
+        tac_instr *instr = NULL;
+        ds_dynamic_array_get_ref(&tac->instrs, i, (void **)&instr);
+
+        if (instr->kind == TAC_LABEL && strcmp(instr->label.label, label) == 0) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+// an Int or Bool has no identity, so boxing the raw value of the result
+// gives the same value back
+static const char *tac_copied_value(tac_instr *instr) {
+    switch (instr->kind) {
+    case TAC_CAST:
+        return instr->cast.expr;
+    case TAC_UNBOX:
+        return instr->unbox.expr;
+    case TAC_BOX:
+        return instr->box.expr;
+    default:
+        return instr->assign_value.expr;
+    }
+}
+
+// follows the result of the call at i to the end of the method
+static int tac_is_tail_call(tac_result *tac, size_t i) {
+    tac_instr *call = NULL;
+    ds_dynamic_array_get_ref(&tac->instrs, i, (void **)&call);
+
+    const char *result = call->dispatch_call.ident;
+    size_t last = tac->instrs.count - 1;
+
+    // every step moves forward or through a jump, so this bounds the walk
+    for (size_t steps = 0, j = i + 1; steps < tac->instrs.count; steps++) {
+        if (j > last) {
+            return 0;
+        }
+
+        tac_instr *instr = NULL;
+        ds_dynamic_array_get_ref(&tac->instrs, j, (void **)&instr);
+
+        switch (instr->kind) {
+        case TAC_LABEL:
+            j++;
+            break;
+        case TAC_JUMP: {
+            int target = tac_find_label(tac, instr->jump.label);
+            if (target < 0) {
+                return 0;
+            }
+            j = target;
+            break;
+        }
+        case TAC_ASSIGN_VALUE:
+        case TAC_CAST:
+        case TAC_UNBOX:
+        case TAC_BOX: {
+            const char *expr = tac_copied_value(instr);
+            char *ident = *codegen_tac_instr_def(instr);
+
+            // a write to a formal or an attribute outlives the frame
+            if (strcmp(expr, result) != 0 ||
+                codegen_tac_local_index(tac, ident) < 0) {
+                return 0;
+            }
+            result = ident;
+            j++;
+            break;
+        }
+        case TAC_IDENT:
+            return j == last && strcmp(instr->ident.name, result) == 0;
+        default:
+            return 0;
+        }
+    }
+
+    return 0;
+}
+
+void codegen_tac_mark_tail_calls(semantic_mapping *mapping,
+                                 const char *class_name,
+                                 const char *method_name, tac_result *tac,
+                                 tac_stats *stats) {
+    // the attribute initializers return to the object constructor
+    if (method_name == NULL) {
+        return;
+    }
+
+    semantic_mapping_item *item = codegen_tac_find_class(mapping, class_name);
+    implementation_mapping_item *method =
+        item != NULL ? codegen_tac_find_method(item, method_name) : NULL;
+    if (method == NULL) {
+        return;
+    }
+
+    size_t formals = method->method->formals.count;
+    size_t stack = formals > TAC_REGISTER_ARGS ? formals - TAC_REGISTER_ARGS : 0;
+    size_t room = TAC_REGISTER_ARGS + stack + stack % 2;
+
+    for (size_t i = 0; i < tac->instrs.count; i++) {
+        tac_instr *instr = NULL;
+        ds_dynamic_array_get_ref(&tac->instrs, i, (void **)&instr);
+
+        if (instr->kind != TAC_DISPATCH_CALL ||
+            instr->dispatch_call.args.count > room ||
+            !tac_is_tail_call(tac, i)) {
+            continue;
+        }
+
+        instr->dispatch_call.tail = 1;
+        stats->tail_calls++;
+    }
+}
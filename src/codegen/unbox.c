@@ -0,0 +1,318 @@
+#include "codegen.h"
+#include "ds.h"
+
+// Int and Bool temporaries can be kept as raw 64-bit values instead of
+// objects. The values are boxed only where they escape (method arguments,
+// attributes, formals, the result of the expression, ...) and objects are
+// unboxed where a raw value is needed (arithmetic, comparisons, branches).
+
+#define TAC_UNBOX_ITERATIONS 8
+
+// how many times each local of the method is read, counted once before the
+// rewrite
+typedef struct tac_reads {
+        size_t locals;
+        int *counts;
+} tac_reads;
+
+static void tac_reads_add(tac_result *tac, tac_reads *reads,
+                          const char *name) {
+    int v = codegen_tac_local_index(tac, name);
+    if (v >= 0 && (size_t)v < reads->locals) {
+        reads->counts[v]++;
+    }
+}
+
+static void tac_count_reads(tac_result *tac, tac_reads *reads) {
+    reads->locals = tac->locals.count;
+    reads->counts = calloc(reads->locals + 1, sizeof(int));
+
+    for (size_t i = 0; i < tac->instrs.count; i++) {
+        tac_instr *instr = NULL;
+        ds_dynamic_array_get_ref(&tac->instrs, i, (void **)&instr);
+
+        ds_dynamic_array uses;
+        codegen_tac_instr_uses(instr, &uses);
+        for (size_t j = 0; j < uses.count; j++) {
+            char **operand = NULL;
+            ds_dynamic_array_get(&uses, j, &operand);
+            tac_reads_add(tac, reads, *operand);
+        }
+        ds_dynamic_array_free(&uses);
+    }
+}
+
+// a temporary that is never read does not need to be converted; the locals
+// made during the rewrite count as read
+static int tac_is_used(tac_result *tac, tac_reads *reads, const char *name) {
+    int v = codegen_tac_local_index(tac, name);
+    return v < 0 || (size_t)v >= reads->locals || reads->counts[v] > 0;
+}
+
+// attributes, formals and self are always objects
+static enum tac_repr tac_repr_of(tac_result *tac, const char *name) {
+    tac_local *local = codegen_tac_find_local(tac, name);
+    if (local == NULL || local->unboxed == 0) {
+        return TAC_REPR_BOXED;
+    }
+
+    return TAC_REPR_RAW;
+}
+
+typedef struct tac_cost {
+        int raw_defs;   // boxing needed if the variable is an object
+        int boxed_uses; // boxing needed if the variable is raw
+        int raw_uses;   // loads saved if the variable is raw
+} tac_cost;
+
+static void tac_cost_use(tac_result *tac, tac_cost *costs, const char *name,
+                         enum tac_repr repr) {
+    tac_local *local = codegen_tac_find_local(tac, name);
+    if (local == NULL) {
+        return;
+    }
+
+    size_t index = local - (tac_local *)tac->locals.items;
+    if (repr == TAC_REPR_RAW) {
+        costs[index].raw_uses++;
+    } else {
+        costs[index].boxed_uses++;
+    }
+}
+
+static void tac_cost_instr(tac_result *tac, tac_reads *reads,
+                           tac_cost *costs, tac_instr *instr) {
+    ds_dynamic_array uses;
+    ds_dynamic_array reprs;
+    codegen_tac_instr_uses_repr(instr, &uses, &reprs);
+
+    enum tac_repr def;
+    char **ident = codegen_tac_instr_def_repr(instr, &def);
+
+    for (size_t i = 0; i < uses.count; i++) {
+        char **operand = NULL;
+        enum tac_repr repr;
+        ds_dynamic_array_get(&uses, i, &operand);
+        ds_dynamic_array_get(&reprs, i, &repr);
+
+        if (repr == TAC_REPR_COPY) {
+            if (codegen_tac_find_local(tac, *ident) != NULL &&
+                !tac_is_used(tac, reads, *ident)) {
+                continue;
+            }
+            repr = tac_repr_of(tac, *ident);
+        }
+
+        tac_cost_use(tac, costs, *operand, repr);
+    }
+
+    tac_local *local =
+        ident != NULL ? codegen_tac_find_local(tac, *ident) : NULL;
+    if (local != NULL) {
+        if (def == TAC_REPR_COPY) {
+            char **operand = NULL;
+            ds_dynamic_array_get(&uses, 0, &operand);
+            def = tac_repr_of(tac, *operand);
+        }
+
+        if (def == TAC_REPR_RAW) {
+            costs[local - (tac_local *)tac->locals.items].raw_defs++;
+        }
+    }
+
+    ds_dynamic_array_free(&uses);
+    ds_dynamic_array_free(&reprs);
+}
+
+// decide which temporaries are kept raw: a raw variable costs an allocation
+// for each use that needs an object, an object costs an allocation for each
+// definition that computes a raw value
+static void tac_choose_repr(tac_result *tac, tac_reads *reads) {
+    size_t count = tac->locals.count;
+    tac_cost *costs = malloc(sizeof(tac_cost) * count);
+
+    for (size_t i = 0; i < count; i++) {
+        tac_local *local = NULL;
+        ds_dynamic_array_get_ref(&tac->locals, i, (void **)&local);
+
+        local->unboxed = codegen_tac_is_value_type(local->type);
+    }
+
+    for (int iteration = 0; iteration < TAC_UNBOX_ITERATIONS; iteration++) {
+        memset(costs, 0, sizeof(tac_cost) * count);
+
+        for (size_t i = 0; i < tac->instrs.count; i++) {
+            tac_instr *instr = NULL;
+            ds_dynamic_array_get_ref(&tac->instrs, i, (void **)&instr);
+
+            tac_cost_instr(tac, reads, costs, instr);
+        }
+
+        int changed = 0;
+        for (size_t i = 0; i < count; i++) {
+            tac_local *local = NULL;
+            ds_dynamic_array_get_ref(&tac->locals, i, (void **)&local);
+
+            if (!codegen_tac_is_value_type(local->type)) {
+                continue;
+            }
+
+            tac_cost cost = costs[i];
+            int unboxed = cost.boxed_uses < cost.raw_defs ||
+                          (cost.boxed_uses == cost.raw_defs &&
+                           cost.raw_uses > 0);
+
+            if (unboxed != local->unboxed) {
+                local->unboxed = unboxed;
+                changed = 1;
+            }
+        }
+
+        if (!changed) {
+            break;
+        }
+    }
+
+    free(costs);
+}
+
+static const char *tac_value_type(tac_result *tac, const char *name,
+                                  const char *fallback) {
+    tac_local *local = codegen_tac_find_local(tac, name);
+    if (local != NULL && codegen_tac_is_value_type(local->type)) {
+        return local->type;
+    }
+
+    return fallback;
+}
+
+// the type of the raw value an instruction works with
+static const char *tac_instr_value_type(tac_instr *instr) {
+    switch (instr->kind) {
+    case TAC_JUMP_IF_TRUE:
+    case TAC_ASSIGN_ISINSTANCE:
+    case TAC_ASSIGN_ISVOID:
+    case TAC_ASSIGN_LT:
+    case TAC_ASSIGN_LE:
+    case TAC_ASSIGN_NOT:
+        return "Bool";
+    default:
+        return "Int";
+    }
+}
+
+static void tac_emit_conversion(ds_dynamic_array *instrs, char *ident,
+                                char *expr, const char *type,
+                                enum tac_repr repr) {
+    tac_instr instr;
+    if (repr == TAC_REPR_RAW) {
+        instr.kind = TAC_UNBOX;
+        instr.unbox = (tac_assign_unary){.ident = ident, .expr = expr};
+    } else {
+        instr.kind = TAC_BOX;
+        instr.box = (tac_box){.ident = ident, .expr = expr, .type = (char *)type};
+    }
+
+    ds_dynamic_array_append(instrs, &instr);
+}
+
+// operand <- a copy of the operand in the wanted representation
+static void tac_convert_use(tac_result *tac, ds_dynamic_array *instrs,
+                            char **operand, enum tac_repr repr,
+                            const char *type) {
+    if (tac_repr_of(tac, *operand) == repr) {
+        return;
+    }
+
+    type = tac_value_type(tac, *operand, type);
+    char *ident = codegen_tac_new_local(tac, type, repr == TAC_REPR_RAW);
+    tac_emit_conversion(instrs, ident, *operand, type, repr);
+    *operand = ident;
+}
+
+static void tac_unbox_instr(tac_result *tac, tac_reads *reads,
+                            ds_dynamic_array *instrs, tac_instr instr) {
+    const char *type = tac_instr_value_type(&instr);
+
+    enum tac_repr def;
+    char **ident = codegen_tac_instr_def_repr(&instr, &def);
+
+    // a copy between different representations is a conversion
+    if (instr.kind == TAC_ASSIGN_VALUE) {
+        enum tac_repr from = tac_repr_of(tac, instr.assign_value.expr);
+        enum tac_repr to = tac_repr_of(tac, instr.assign_value.ident);
+
+        if (from == to) {
+            ds_dynamic_array_append(instrs, &instr);
+        } else if (codegen_tac_find_local(tac, instr.assign_value.ident) !=
+                       NULL &&
+                   !tac_is_used(tac, reads, instr.assign_value.ident)) {
+            // the value is dropped
+        } else {
+            type = tac_value_type(tac, instr.assign_value.expr, "Int");
+            type = tac_value_type(tac, instr.assign_value.ident, type);
+            tac_emit_conversion(instrs, instr.assign_value.ident,
+                                instr.assign_value.expr, type, to);
+        }
+        return;
+    }
+
+    // a raw value is never void
+    if (instr.kind == TAC_ASSIGN_ISVOID &&
+        tac_repr_of(tac, instr.assign_unary.expr) == TAC_REPR_RAW) {
+        tac_instr assign_bool = {
+            .kind = TAC_ASSIGN_BOOL,
+            .assign_bool = {.ident = instr.assign_unary.ident, .value = 0},
+        };
+        return tac_unbox_instr(tac, reads, instrs, assign_bool);
+    }
+
+    // the dispatch arguments are converted in place in their array
+    ds_dynamic_array uses;
+    ds_dynamic_array reprs;
+    codegen_tac_instr_uses_repr(&instr, &uses, &reprs);
+    for (size_t i = 0; i < uses.count; i++) {
+        char **operand = NULL;
+        enum tac_repr repr;
+        ds_dynamic_array_get(&uses, i, &operand);
+        ds_dynamic_array_get(&reprs, i, &repr);
+        tac_convert_use(tac, instrs, operand, repr, type);
+    }
+    ds_dynamic_array_free(&uses);
+    ds_dynamic_array_free(&reprs);
+
+    if (ident == NULL || def == TAC_REPR_FREE ||
+        tac_repr_of(tac, *ident) == def) {
+        ds_dynamic_array_append(instrs, &instr);
+        return;
+    }
+
+    // compute the value in a temporary and convert it
+    char *target = *ident;
+    type = tac_value_type(tac, target, type);
+    *ident = codegen_tac_new_local(tac, type, def == TAC_REPR_RAW);
+    ds_dynamic_array_append(instrs, &instr);
+
+    enum tac_repr repr = def == TAC_REPR_RAW ? TAC_REPR_BOXED : TAC_REPR_RAW;
+    tac_emit_conversion(instrs, target, *ident, type, repr);
+}
+
+void codegen_tac_unbox(tac_result *tac) {
+    tac_reads reads;
+    tac_count_reads(tac, &reads);
+    tac_choose_repr(tac, &reads);
+
+    ds_dynamic_array instrs;
+    ds_dynamic_array_init(&instrs, sizeof(tac_instr));
+
+    for (size_t i = 0; i < tac->instrs.count; i++) {
+        tac_instr instr;
+        ds_dynamic_array_get(&tac->instrs, i, &instr);
+
+        tac_unbox_instr(tac, &reads, &instrs, instr);
+    }
+
+    ds_dynamic_array_free(&tac->instrs);
+    tac->instrs = instrs;
+    free(reads.counts);
+}
@@ -39,6 +39,7 @@ typedef struct build_context {
         ds_dynamic_array prelude_filepaths; // const char *
         ds_dynamic_array user_filepaths;    // const char *
         ds_dynamic_array asm_filepaths;     // const char *
+        int gc; // the gc module is linked, it needs the write barrier
 
         ds_dynamic_array user_programs; // program_node
         program_node program;
@@ -93,6 +94,10 @@ static int build_context_prelude_init(build_context *context) {
             return_defer(1);
         }
 
+        if (strcmp(module, "gc") == 0) {
+            context->gc = 1;
+        }
+
         char *module_path = NULL;
         if (util_append_path(cool_lib, module, &module_path) != 0) {
             DS_LOG_ERROR("Failed to append path");
@@ -140,6 +145,7 @@ static int build_context_init(build_context *context,
     int result = 0;
 
     context->parser = parser;
+    context->gc = 0;
 
     ds_dynamic_array_init(&context->prelude_filepaths, sizeof(const char *));
     ds_dynamic_array_init(&context->user_filepaths, sizeof(const char *));
@@ -329,14 +335,41 @@ defer:
     return result;
 }
 
+static enum status_code codegen_pipeline(build_context *context,
+                                         tac_pipeline *pipeline) {
+    char *passes = ds_argparse_get_value(&context->parser, ARG_PASSES);
+    if (passes != NULL) {
+        return codegen_tac_pipeline_parse(passes, pipeline) == 0
+                   ? STATUS_OK
+                   : STATUS_ERROR;
+    }
+
+    int level = TAC_OPT_LEVEL_MAX;
+    char *opt_level = ds_argparse_get_value(&context->parser, ARG_OPT_LEVEL);
+    if (opt_level != NULL) {
+        char *end = NULL;
+        level = strtol(opt_level, &end, 10);
+        if (*opt_level == '\0' || *end != '\0') {
+            DS_LOG_ERROR("invalid optimization level: %s", opt_level);
+            return STATUS_ERROR;
+        }
+    }
+
+    return codegen_tac_pipeline_level(level, pipeline) == 0 ? STATUS_OK
+                                                             : STATUS_ERROR;
+}
+
 static enum status_code codegen(build_context *context) {
     int length;
     char *buffer = NULL;
 
     int tacgen_stop = ds_argparse_get_flag(&context->parser, ARG_TACGEN);
     int assembler_stop = ds_argparse_get_flag(&context->parser, ARG_ASSEMBLER);
+    int cfg_stop = ds_argparse_get_flag(&context->parser, ARG_CFG);
+    char *tac_after = ds_argparse_get_value(&context->parser, ARG_TAC_AFTER);
     char *output = ds_argparse_get_value(&context->parser, ARG_OUTPUT);
     char *asm_path = NULL;
+    tac_pipeline pipeline = {0};
 
     int result = STATUS_OK;
 
@@ -344,17 +377,38 @@ static enum status_code codegen(build_context *context) {
         output = DEFAULT_OUTPUT;
     }
 
+    if (codegen_pipeline(context, &pipeline) != STATUS_OK) {
+        return_defer(STATUS_ERROR);
+    }
+
+    if (tac_after != NULL && !codegen_tac_pipeline_has(&pipeline, tac_after)) {
+        DS_LOG_ERROR("pass is not in the pipeline: %s", tac_after);
+        return_defer(STATUS_ERROR);
+    }
+
     if (assembler_stop == 0 && util_append_extension(output, "asm", &asm_path) != 0) {
         DS_LOG_ERROR("Failed to append extension");
         return_defer(STATUS_ERROR);
     }
 
-    if (tacgen_stop == 1) {
+    if (cfg_stop == 1) {
+        for (size_t i = 0; i < context->user_programs.count; i++) {
+            program_node *program = NULL;
+            ds_dynamic_array_get_ref(&context->user_programs, i,
+                                     (void **)&program);
+            codegen_tac_print_cfg(&context->mapping, program, &pipeline,
+                                  tac_after);
+        }
+        return_defer(STATUS_STOP);
+    }
+
+    if (tacgen_stop == 1 || tac_after != NULL) {
         for (size_t i = 0; i < context->user_programs.count; i++) {
             program_node *program = NULL;
             ds_dynamic_array_get_ref(&context->user_programs, i,
                                      (void **)&program);
-            codegen_tac_print(&context->mapping, program);
+            codegen_tac_print(&context->mapping, program, &pipeline,
+                              tac_after);
         }
         return_defer(STATUS_STOP);
     }
@@ -383,7 +437,12 @@ static enum status_code codegen(build_context *context) {
     }
 
     // assembler
-    if (assembler_run(asm_path, &context->mapping) != ASSEMBLER_OK) {
+    assembler_options options = {
+        .report = ds_argparse_get_flag(&context->parser, ARG_REPORT),
+        .pipeline = &pipeline,
+        .write_barrier = context->gc,
+    };
+    if (assembler_run(asm_path, &context->mapping, options) != ASSEMBLER_OK) {
         return_defer(STATUS_ERROR);
     }
 
@@ -394,6 +453,7 @@ static enum status_code codegen(build_context *context) {
     return_defer(STATUS_OK);
 
 defer:
+    codegen_tac_pipeline_free(&pipeline);
     return result;
 }
 
@@ -69,6 +69,85 @@ int util_parse_arguments(ds_argparse_parser *parser, int argc, char **argv) {
                                        .type = ARGUMENT_TYPE_VALUE_ARRAY,
                                        .required = 0}));
 
-    return ds_argparse_parse(parser, argc, argv);
+    ds_argparse_add_argument(
+        parser,
+        ((ds_argparse_options){.short_name = 'r',
+                               .long_name = ARG_REPORT,
+                               .description = "Report what the optimizations did",
+                               .type = ARGUMENT_TYPE_FLAG,
+                               .required = 0}));
+
+    ds_argparse_add_argument(
+        parser, ((ds_argparse_options){.short_name = 'O',
+                                       .long_name = ARG_OPT_LEVEL,
+                                       .description = "Optimization level 0-2 "
+                                                      "(default 2)",
+                                       .type = ARGUMENT_TYPE_VALUE,
+                                       .required = 0}));
+
+    ds_argparse_add_argument(
+        parser,
+        ((ds_argparse_options){.short_name = 'p',
+                               .long_name = ARG_PASSES,
+                               .description = "Comma separated list of TAC "
+                                              "passes, overrides -O",
+                               .type = ARGUMENT_TYPE_VALUE,
+                               .required = 0}));
+
+    ds_argparse_add_argument(
+        parser,
+        ((ds_argparse_options){.short_name = 'T',
+                               .long_name = ARG_TAC_AFTER,
+                               .description = "Generate TAC after the given "
+                                              "pass",
+                               .type = ARGUMENT_TYPE_VALUE,
+                               .required = 0}));
+
+    ds_argparse_add_argument(
+        parser,
+        ((ds_argparse_options){.short_name = 'c',
+                               .long_name = ARG_CFG,
+                               .description = "Generate the control flow "
+                                              "graph of the TAC (Graphviz)",
+                               .type = ARGUMENT_TYPE_FLAG,
+                               .required = 0}));
+
+    // accept `-O2` and `--passes=fold,regalloc` as well as separate values
+    ds_dynamic_array args;  // char *
+    ds_dynamic_array names; // char *, the names split off a value
+    ds_dynamic_array_init(&args, sizeof(char *));
+    ds_dynamic_array_init(&names, sizeof(char *));
+    for (int i = 0; i < argc; i++) {
+        char *arg = argv[i];
+        char *value = NULL;
+
+        if (strncmp(arg, "--", 2) == 0 && strchr(arg, '=') != NULL) {
+            value = strchr(arg, '=');
+            arg = strndup(arg, value - arg);
+            ds_dynamic_array_append(&names, &arg);
+            value++;
+        } else if (arg[0] == '-' && arg[1] == 'O' && arg[2] != '\0') {
+            value = arg + 2;
+            arg = "-O";
+        }
+
+        ds_dynamic_array_append(&args, &arg);
+        if (value != NULL) {
+            ds_dynamic_array_append(&args, &value);
+        }
+    }
+
+    int result = ds_argparse_parse(parser, args.count, (char **)args.items);
+
+    // the parser keeps the values, which point into argv, but not the names
+    for (size_t i = 0; i < names.count; i++) {
+        char *name = NULL;
+        ds_dynamic_array_get(&names, i, &name);
+        free(name);
+    }
+    ds_dynamic_array_free(&names);
+    ds_dynamic_array_free(&args);
+
+    return result;
 }
 
@@ -0,0 +1,58 @@
+class Counter {
+    count: Int;
+    flag: Bool;
+
+    count(): Int { count };
+    flag(): Bool { flag };
+
+    add(x: Int): Int {
+        {
+            count <- count + x;
+            flag <- not flag;
+            count;
+        }
+    };
+};
+
+class Main inherits IO {
+    total: Int <- 2 * 3 + 1;
+
+    twice(x: Int): Int { x + x };
+
+    describe(x: Object): String {
+        case x of
+            i: Int => "Int";
+            b: Bool => "Bool";
+            o: Object => "Object";
+        esac
+    };
+
+    main(): Object {
+        let i: Int <- 0,
+            c: Counter <- new Counter,
+            big: Bool <- false,
+            o: Object
+        in {
+            while i < 10 loop {
+                c.add(i);
+                i <- i + 1;
+            } pool;
+            out_int(c.count()).out_string(" ");
+            out_int(twice(c.count() - 50)).out_string(" ");
+            out_int(~7 / 2).out_string(" ");
+            out_int(total * i).out_string("\n");
+
+            big <- 40 < c.count();
+            if big then out_string("big ") else out_string("small ") fi;
+            if c.flag() then out_string("odd ") else out_string("even ") fi;
+            if isvoid i then out_string("void ") else out_string("set ") fi;
+            if i = 10 then out_string("ten\n") else out_string("not ten\n") fi;
+
+            o <- i + 1;
+            out_string(describe(o)).out_string(" ");
+            out_string(describe(i <= 10)).out_string(" ");
+            out_string(describe(c)).out_string(" ");
+            out_string(i.to_string()).out_string("\n");
+        }
+    };
+};
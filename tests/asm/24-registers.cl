@@ -0,0 +1,41 @@
+class Pair {
+    fst: Int;
+    snd: Int;
+
+    init(a: Int, b: Int): Pair { { fst <- a; snd <- b; self; } };
+    sum(): Int { fst + snd };
+};
+
+class Main inherits IO {
+    id(x: Int): Int { x };
+
+    -- more values are live across the calls than there are registers
+    spill(a: Int, b: Int): Int {
+        let c: Int <- id(a + 1), d: Int <- id(b + 2), e: Int <- id(c * d),
+            f: Int <- id(e - a), g: Int <- id(f + b), h: Int <- id(g * 2),
+            i: Int <- id(h - c), j: Int <- id(i + d), k: Int <- id(j + e)
+        in a + b + c + d + e + f + g + h + i + j + k
+    };
+
+    -- objects kept in registers across allocations
+    pairs(n: Int): Int {
+        let i: Int <- 0, total: Int <- 0, p: Pair, q: Pair in {
+            while i < n loop {
+                p <- new Pair.init(i, i + 1);
+                q <- new Pair.init(p.sum(), i);
+                total <- total + p.sum() + q.sum();
+                i <- i + 1;
+            } pool;
+            total;
+        }
+    };
+
+    main(): Object {
+        {
+            out_int(spill(3, 4));
+            out_string(" ");
+            out_int(pairs(1000));
+            out_string("\n");
+        }
+    };
+};
@@ -0,0 +1,31 @@
+class Main inherits IO {
+    next: Main;
+
+    count(a: Int, b: Int): Int {
+        let n: Int <- 0 in {
+            while a < b loop { n <- n + 1; a <- a + 1; } pool;
+            while a <= b loop { n <- n + 10; a <- a + 1; } pool;
+            while not (b < 0) loop { n <- n + 100; b <- b - 1; } pool;
+            n;
+        }
+    };
+
+    pick(a: Int, b: Int): String {
+        if a < b then "lt" else
+        if not a <= b then "gt" else "eq" fi fi
+    };
+
+    main(): Object {
+        let less: Bool <- 1 < 2 in {
+            out_int(count(0, 3));
+            out_string(" ");
+            out_string(pick(1, 2)).out_string(pick(2, 1)).out_string(pick(2, 2));
+            out_string(" ");
+            out_string(if isvoid next then "void" else "set" fi);
+            next <- new Main;
+            out_string(if not isvoid next then " set" else " void" fi);
+            out_string(if less then " less" else " more" fi);
+            out_string("\n");
+        }
+    };
+};
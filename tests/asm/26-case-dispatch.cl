@@ -0,0 +1,44 @@
+class A {};
+class B inherits A {};
+class C inherits B {};
+class D inherits A {};
+class E {};
+class F inherits E {};
+class G {};
+
+class Main inherits IO {
+    dense(x: Object): Int {
+        case x of
+            x: C => 1;
+            x: B => 2;
+            x: D => 3;
+            x: A => 4;
+            x: F => 5;
+            x: E => 6;
+            x: G => 7;
+            x: Int => 8;
+            x: String => 9;
+            x: Object => 0;
+        esac
+    };
+
+    sparse(x: Object): Int {
+        case x of
+            x: B => 1;
+            x: Object => 0;
+        esac
+    };
+
+    show(x: Object): Main {
+        { out_int(dense(x)).out_int(sparse(x)); self; }
+    };
+
+    main(): Object {
+        {
+            show(new A).show(new B).show(new C).show(new D);
+            show(new E).show(new F).show(new G).show(3);
+            show("s").show(true).show(new IO);
+            out_string("\n");
+        }
+    };
+};
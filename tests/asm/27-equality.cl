@@ -0,0 +1,15 @@
+class Main inherits IO {
+    f(a: Int, b: Int): Bool { a = b };
+    main(): Object {
+        let i: Int <- 0, n: Int <- 0, s: String <- "abc", t: String <- "ab".concat("c") in {
+            while not i = 10 loop { if i = 3 then n <- n + 1 else n <- n + 2 fi; i <- i + 1; } pool;
+            out_int(n);
+            out_string(if s = t then " same" else " diff" fi);
+            out_string(if s = "abd" then " same" else " diff" fi);
+            out_string(if f(1, 1) then " t" else " f" fi);
+            out_string(if new Byte.from_int(65) = new Byte.from_string("A") then " t" else " f" fi);
+            out_string(if true = false then " t" else " f" fi);
+            out_string("\n");
+        }
+    };
+};
@@ -0,0 +1,27 @@
+class Shape {
+    name(): String { "shape" };
+    sides(): Int { 0 };
+    describe(): String { name().concat(" ").concat(sides().to_string()) };
+};
+
+class Square inherits Shape {
+    sides(): Int { 4 };
+};
+
+class Cube inherits Square {
+    name(): String { "cube" };
+};
+
+class Main inherits IO {
+    square: Square <- new Cube;
+
+    main(): Object {
+        {
+            out_string(new Shape.describe()).out_string("\n");
+            out_string(new Square.describe()).out_string("\n");
+            out_string(square.describe()).out_string("\n");
+            out_string(square.name()).out_string(" ");
+            out_int(square.sides()).out_string("\n");
+        }
+    };
+};
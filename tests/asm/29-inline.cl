@@ -0,0 +1,21 @@
+class Counter {
+    count: Int;
+
+    get(): Int { count };
+    set(value: Int): Counter { { count <- value; self; } };
+    add(value: Int): Counter { set(get() + value) };
+    clamp(limit: Int): Int { if limit < count then limit else count fi };
+};
+
+class Main inherits IO {
+    counter: Counter <- new Counter;
+
+    main(): Object {
+        {
+            counter.set(3).add(4).add(5);
+            out_int(counter.get()).out_string(" ");
+            out_int(counter.clamp(10)).out_string(" ");
+            out_int(counter.clamp(20)).out_string("\n");
+        }
+    };
+};
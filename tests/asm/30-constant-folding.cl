@@ -0,0 +1,14 @@
+class Main inherits IO {
+    k: Int;
+    f(x: Int): Int { x * 256 * 256 + 3 - 10 / 2 };
+    main(): Object {
+        let a: Int <- 2 * 3, b: Int <- a + 4, i: Int <- 0, d: Bool in {
+            if a < b then out_int(b) else out_int(0 - 1) fi;
+            if not (a = 6) then abort() else out_string(" ok") fi;
+            while i < 3 loop { i <- i + 1; k <- k + a; } pool;
+            out_int(f(1)).out_string(" ").out_int(k).out_string(" ");
+            if d then out_string("d") else out_string("nd") fi;
+            out_int(~(7 / 2)).out_string(" ").out_int(1 / (a - 6 + 1)).out_string("\n");
+        }
+    };
+};
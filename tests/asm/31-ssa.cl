@@ -0,0 +1,51 @@
+class Main inherits IO {
+    fib(n: Int): Int {
+        let a: Int <- 0, b: Int <- 1, i: Int <- 0 in {
+            while i < n loop {
+                let t: Int <- a in { a <- b; b <- t + b; };
+                i <- i + 1;
+            } pool;
+            a;
+        }
+    };
+
+    collatz(n: Int): Int {
+        let steps: Int <- 0 in {
+            while not n = 1 loop {
+                if n - n / 2 * 2 = 0 then n <- n / 2 else n <- 3 * n + 1 fi;
+                steps <- steps + 1;
+            } pool;
+            steps;
+        }
+    };
+
+    swaps(n: Int): Int {
+        let x: Int <- 1, y: Int <- 2, t: Int in {
+            while 0 < n loop {
+                t <- x; x <- y; y <- t;
+                n <- n - 1;
+            } pool;
+            x * 10 + y;
+        }
+    };
+
+    kind(o: Object): String {
+        let s: String <- "?" in {
+            case o of
+                i: Int => if i < 0 then s <- "neg" else s <- "int" fi;
+                b: Bool => s <- "bool";
+                o: Object => s;
+            esac;
+        }
+    };
+
+    main(): Object {
+        {
+            out_int(fib(20)).out_string(" ");
+            out_int(collatz(27)).out_string(" ");
+            out_int(swaps(3)).out_string(" ").out_int(swaps(4)).out_string(" ");
+            out_string(kind(0 - 1)).out_string(kind(3)).out_string(kind(true));
+            out_string(kind(self)).out_string("\n");
+        }
+    };
+};
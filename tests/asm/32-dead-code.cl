@@ -0,0 +1,27 @@
+class Counter {
+    n: Int;
+    next(): Int { n <- n + 1 };
+};
+
+class Main inherits IO {
+    c: Counter <- new Counter;
+
+    unused(x: Int): Int {
+        let a: Int <- x * 2, s: String <- "unused", b: Bool <- x < 3 in {
+            if b then a + 1 else a - 1 fi;
+            while false loop a <- a + 1 pool;
+            c.next();
+            x;
+        }
+    };
+
+    main(): Object {
+        let i: Int <- 0, last: Int in {
+            while i < 5 loop {
+                last <- unused(i);
+                i <- i + 1;
+            } pool;
+            out_int(last).out_string(" ").out_int(c.next()).out_string("\n");
+        }
+    };
+};
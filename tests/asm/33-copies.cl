@@ -0,0 +1,38 @@
+class Main inherits IO {
+    rotate(n: Int): String {
+        let a: String <- "a", b: String <- "b", c: String <- "c", t: String in {
+            while 0 < n loop {
+                t <- a; a <- b; b <- c; c <- t;
+                n <- n - 1;
+            } pool;
+            a.concat(b).concat(c);
+        }
+    };
+
+    shadow(x: Int): Int {
+        let y: Int <- x in {
+            let x: Int <- y + 1 in y <- x * 2;
+            let y: Int <- y in x <- y + x;
+        }
+    };
+
+    total(o: Object): Int {
+        let s: Int <- 0 in {
+            case o of
+                i: Int => s <- i;
+                t: String => s <- t.length();
+                o: Object => s <- 0 - 1;
+            esac;
+            s + 1;
+        }
+    };
+
+    main(): Object {
+        {
+            out_string(rotate(4)).out_string(" ").out_string(rotate(5)).out_string(" ");
+            out_int(shadow(3)).out_string(" ");
+            out_int(total(41)).out_string(" ").out_int(total("abc")).out_string(" ");
+            out_int(total(self)).out_string("\n");
+        }
+    };
+};
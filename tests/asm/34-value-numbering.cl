@@ -0,0 +1,36 @@
+class Main inherits IO {
+    k: Int <- 1;
+
+    bump(): Int { k <- k + 1 };
+
+    twice(a: Int, b: Int): Int {
+        let x: Int <- a * b + k in {
+            bump();
+            x + (a * b + k);
+        }
+    };
+
+    reassigned(a: Int): Int {
+        let x: Int <- a + 1 in {
+            a <- a * 10;
+            x + (a + 1);
+        }
+    };
+
+    halves(s: String): String {
+        let n: Int <- s.length() in
+            if s.length() / 2 < n then
+                s.substr(0, n / 2).concat("|").concat(s.substr(0, s.length() / 2))
+            else
+                s
+            fi
+    };
+
+    main(): Object {
+        {
+            out_int(twice(3, 4)).out_string(" ");
+            out_int(reassigned(5)).out_string(" ");
+            out_string(halves("abcdef")).out_string("\n");
+        }
+    };
+};
@@ -0,0 +1,60 @@
+class Main inherits IO {
+    k: Int <- 1;
+
+    bump(): Int { k <- k + 1 };
+
+    scaled(s: String, x: Int): Int {
+        let i: Int <- 0, t: Int <- 0 in {
+            while i < s.length() loop {
+                t <- t + x * 2 + 10 / x;
+                i <- i + 1;
+            } pool;
+            t;
+        }
+    };
+
+    -- k changes in the loop, so reading it can not move out
+    bumped(n: Int): Int {
+        let i: Int <- 0, t: Int <- 0 in {
+            while i < n loop {
+                t <- t + k;
+                bump();
+                i <- i + 1;
+            } pool;
+            t;
+        }
+    };
+
+    -- the division is not in the header and the loop does not run
+    never(x: Int): Int {
+        let t: Int <- 7 in {
+            while t < 0 loop
+                t <- 100 / x
+            pool;
+            t;
+        }
+    };
+
+    nested(n: Int): Int {
+        let i: Int <- 0, t: Int <- 0 in {
+            while i < n loop {
+                let j: Int <- 0 in
+                    while j < n loop {
+                        t <- t + n * n + i;
+                        j <- j + 1;
+                    } pool;
+                i <- i + 1;
+            } pool;
+            t;
+        }
+    };
+
+    main(): Object {
+        {
+            out_int(scaled("abcd", 5)).out_string(" ");
+            out_int(bumped(4)).out_string(" ");
+            out_int(never(0)).out_string(" ");
+            out_int(nested(3)).out_string("\n");
+        }
+    };
+};
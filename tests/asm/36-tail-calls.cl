@@ -0,0 +1,40 @@
+class Counter {
+    count(n: Int, acc: Int): Int {
+        if n = 0 then acc else count(n - 1, acc + 1) fi
+    };
+
+    -- the receiver is a formal that the arguments overwrite
+    walk(other: Counter, n: Int): Int {
+        if n = 0 then 0 else other.count(n, 100) fi
+    };
+};
+
+class Twice inherits Counter {
+    count(n: Int, acc: Int): Int {
+        if n = 0 then acc else self@Counter.count(n - 1, acc + 2) fi
+    };
+};
+
+class Main inherits IO {
+    sum(n: Int, acc: Int): Int {
+        if n = 0 then acc else sum(n - 1, acc + n) fi
+    };
+
+    even(n: Int): Bool { if n = 0 then true else odd(n - 1) fi };
+
+    odd(n: Int): Bool { if n = 0 then false else even(n - 1) fi };
+
+    -- one argument fits in the room of three
+    first(a: Int, b: Int, c: Int): Int { half(a + b + c) };
+
+    half(n: Int): Int { n / 2 };
+
+    main(): Object {
+        {
+            out_int(sum(10000, 0)).out_string(" ");
+            out_string(if even(10001) then "even" else "odd" fi).out_string(" ");
+            out_int(first(1, 2, 3)).out_string(" ");
+            out_int(new Counter.walk(new Twice, 5)).out_string("\n");
+        }
+    };
+};
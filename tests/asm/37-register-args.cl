@@ -0,0 +1,33 @@
+class Digits {
+    six(a: Int, b: Int, c: Int, d: Int, e: Int, f: Int): Int {
+        a * 100000 + b * 10000 + c * 1000 + d * 100 + e * 10 + f
+    };
+};
+
+class Reversed inherits Digits {
+    six(a: Int, b: Int, c: Int, d: Int, e: Int, f: Int): Int {
+        f * 100000 + e * 10000 + d * 1000 + c * 100 + b * 10 + a
+    };
+};
+
+class Main inherits IO {
+    -- the arguments on the stack move in place for the tail call
+    rotate(n: Int, a: Int, b: Int, c: Int, d: Int, e: Int, f: Int): Int {
+        if n = 0 then new Digits.six(a, b, c, d, e, f)
+        else rotate(n - 1, f, a, b, c, d, e) fi
+    };
+
+    swap(a: String, b: String): String {
+        if a.length() < b.length() then swap(b, a) else a.concat(b) fi
+    };
+
+    main(): Object {
+        let digits: Digits <- new Reversed, o: Object <- "abc" in {
+            out_int(digits.six(1, 2, 3, 4, 5, 6)).out_string(" ");
+            out_int(rotate(2, 1, 2, 3, 4, 5, 6)).out_string(" ");
+            out_string(swap("a", "bcd")).out_string(" ");
+            out_string("abcdef".substr(2, 3)).out_string(" ");
+            if o.equals("abc") then out_string("equal\n") else out_string("different\n") fi;
+        }
+    };
+};
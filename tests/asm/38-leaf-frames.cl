@@ -0,0 +1,44 @@
+class Base {
+    n: Int <- 7;
+    label: String <- "base";
+
+    n(): Int { n };
+    key(): Int { 65 };
+    me(): Base { self };
+
+    -- idiv writes rdx, which brought the second argument
+    ratio(a: Int, b: Int): Int { a / b + b };
+
+    pick(a: Int, b: Int, c: Int, d: Int): Int {
+        if a < b then c else d fi
+    };
+};
+
+-- nothing to initialize, the constructor is the one of Base
+class Empty inherits Base {};
+
+class Busy inherits Empty {
+    total: Int <- let a: Int <- n * 2, b: Int <- n + 1 in a * b;
+    words: String <- label.concat(" busy");
+    twice: Int <- total + total;
+    other: Base <- new Empty;
+
+    twice(): Int { twice };
+    words(): String { words };
+    other(): Base { other };
+};
+
+class Main inherits IO {
+    main(): Object {
+        let busy: Busy <- new Busy in {
+            out_int(busy.n()).out_string(" ");
+            out_int(busy.key()).out_string(" ");
+            out_string(busy.me().type_name()).out_string(" ");
+            out_int(busy.ratio(17, 5)).out_string(" ");
+            out_int(busy.pick(1, 2, 3, 4)).out_string(" ");
+            out_int(busy.twice()).out_string(" ");
+            out_string(busy.words()).out_string(" ");
+            out_int(busy.other().n()).out_string("\n");
+        }
+    };
+};
@@ -0,0 +1,48 @@
+class Point {
+    x: Int;
+    y: Int;
+    next: Point;
+
+    init(a: Int, b: Int, n: Point): Point {
+        { x <- a; y <- b; next <- n; self; }
+    };
+
+    x(): Int { x };
+    y(): Int { y };
+    next(): Point { next };
+};
+
+class Main inherits IO {
+    -- the attributes are loaded through the register of the object
+    sum(p: Point): Int {
+        let total: Int <- 0 in {
+            while not isvoid p loop {
+                total <- total + p.x() * p.y();
+                p <- p.next();
+            } pool;
+            total;
+        }
+    };
+
+    -- zero is compared and stored, and the branches jump to the next label
+    sign(n: Int): Int {
+        if n = 0 then 0 else if n < 0 then ~1 else 1 fi fi
+    };
+
+    -- more values than registers, so some live in stack slots
+    spill(a: Int, b: Int, c: Int, d: Int, e: Int, f: Int): Int {
+        let g: Int <- a + b, h: Int <- c + d, i: Int <- e + f,
+            j: Int <- g * h, k: Int <- h * i, l: Int <- i * g in
+            out_int(g + h + i + j + k + l).out_string(" ").sign(j - k)
+    };
+
+    main(): Object {
+        let p: Point <- new Point.init(1, 2, new Point.init(3, 4, new Point.init(5, 6, let void: Point in void))) in {
+            out_int(sum(p)).out_string(" ");
+            out_int(sign(~5)).out_string(" ");
+            out_int(sign(0)).out_string(" ");
+            out_int(sign(8)).out_string(" ");
+            out_int(spill(1, 2, 3, 4, 5, 6)).out_string("\n");
+        }
+    };
+};
@@ -0,0 +1,57 @@
+class Box {
+    value: Object;
+
+    init(v: Object): Box {
+        { value <- v; self; }
+    };
+
+    value(): Object { value };
+};
+
+class Main inherits IO {
+    -- values inside and outside of the cache boxed through Object
+    show(x: Object): Object {
+        case x of
+            i: Int => out_int(i).out_string(" ");
+            b: Bool => out_string(if b then "true " else "false " fi);
+            o: Object => out_string("? ");
+        esac
+    };
+
+    -- a new Int and Bool are the default values
+    defaults(): Object {
+        let i: Int <- new Int, b: Bool <- new Bool in {
+            show(i);
+            show(b);
+        }
+    };
+
+    main(): Object {
+        let boxes: Box <- new Box.init(~128),
+            total: Int <- 0,
+            i: Int <- ~200 in {
+            show(boxes.value());
+            show(new Box.init(1023).value());
+            show(new Box.init(1024).value());
+            show(new Box.init(~129).value());
+            show(new Box.init(3 < 4).value());
+            show(new Box.init(4 < 3).value());
+            defaults();
+
+            -- values on both sides of the cache read back through Object
+            while i < 1200 loop {
+                let a: Object <- i in
+                    case a of n: Int => total <- total + n; esac;
+                i <- i + 1;
+            } pool;
+            show(total);
+
+            -- natives return cached and uncached values
+            show("hello".length());
+            show("hello".equals("hello"));
+            show("hello".equals("world"));
+            show("hello world hello world hello world hello world hello world hello world hello world hello world hello world hello world hello world hello world hello world hello world hello world hello world hello world hello world hello world hello world hello world hello world hello world hello world hello world hello world hello world hello world hello world hello world hello world hello world hello world hello world hello world hello world hello world hello world hello world hello world hello world hello world hello world hello world hello world hello world hello world hello world hello world hello world hello world hello world hello world hello world hello world hello world hello world hello world hello world hello world hello world hello world hello world hello world hello world hello world hello world hello world hello world hello world hello world hello world hello world hello world hello world".length());
+            out_string("\n");
+        }
+    };
+};
@@ -0,0 +1,52 @@
+class Node {
+    value: Int <- 7;
+    name: String <- "node";
+    flag: Bool <- true;
+    next: Node;
+
+    init(v: Int, n: Node): Node {
+        { value <- v; next <- n; self; }
+    };
+
+    value(): Int { value };
+    name(): String { name };
+    flag(): Bool { flag };
+    next(): Node { next };
+};
+
+-- more words than are copied inline
+class Wide {
+    a: Int <- 1; b: Int <- 2; c: Int <- 3; d: Int <- 4; e: Int <- 5;
+    f: Int <- 6; g: Int <- 7; h: Int <- 8; i: Int <- 9; j: Int <- 10;
+    k: Int <- 11; l: Int <- 12; m: Int <- 13; n: Int <- 14;
+
+    sum(): Int { a + b + c + d + e + f + g + h + i + j + k + l + m + n };
+};
+
+class Main inherits IO {
+    main(): Object {
+        let fresh: Node <- new Node,
+            list: Node,
+            i: Int <- 0,
+            total: Int <- 0 in {
+            -- the prototype is copied with its attribute values
+            out_int(fresh.value()).out_string(" ");
+            out_string(fresh.name()).out_string(" ");
+            out_string(if fresh.flag() then "true " else "false " fi);
+            out_string(if isvoid fresh.next() then "void " else "next " fi);
+
+            -- enough objects to run out of the first chunk of the heap
+            while i < 200000 loop {
+                list <- new Node.init(i, if i - (i / 100) * 100 = 0 then let v: Node in v else list fi);
+                i <- i + 1;
+            } pool;
+            while not isvoid list loop {
+                total <- total + list.value();
+                list <- list.next();
+            } pool;
+            out_int(total).out_string(" ");
+
+            out_int(new Wide.sum()).out_string("\n");
+        }
+    };
+};
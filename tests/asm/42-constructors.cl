@@ -0,0 +1,53 @@
+class Counter {
+    count: Int;
+
+    next(): Int { count <- count + 1 };
+    count(): Int { count };
+};
+
+-- every attribute starts with its value in the prototype
+class Defaults {
+    i: Int;
+    s: String;
+    b: Bool;
+    o: Object;
+    seven: Int <- 7;
+    yes: Bool <- true;
+    hello: String <- "hello";
+
+    show(io: IO): IO {
+        io.out_int(i).out_string(" ")
+          .out_int(s.length()).out_string(" ")
+          .out_string(if b then "true " else "false " fi)
+          .out_string(if isvoid o then "void " else "object " fi)
+          .out_int(seven).out_string(" ")
+          .out_string(if yes then "true " else "false " fi)
+          .out_string(hello).out_string(" ")
+    };
+};
+
+-- an initializer with a side effect runs once, in the parent constructor
+class Parent inherits IO {
+    counter: Counter <- new Counter;
+    first: Int <- { out_string("first "); counter.next(); };
+
+    first(): Int { first };
+    counter(): Counter { counter };
+};
+
+class Child inherits Parent {
+    second: Int <- { out_string("second "); counter.next(); };
+
+    second(): Int { second };
+};
+
+class Main inherits IO {
+    main(): Object {
+        let child: Child <- new Child in {
+            new Defaults.show(self);
+            out_int(child.first()).out_string(" ");
+            out_int(child.second()).out_string(" ");
+            out_int(child.counter().count()).out_string("\n");
+        }
+    };
+};
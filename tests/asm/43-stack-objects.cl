@@ -0,0 +1,86 @@
+class Pair {
+    first: Object;
+    second: Object;
+    tag: String <- "pair";
+
+    setFirst(o: Object): Object { first <- o };
+    setSecond(o: Object): Object { second <- o };
+    first(): Object { first };
+    second(): Object { second };
+    tag(): String { tag };
+};
+
+class Cell {
+    value: Int;
+
+    value(): Int { value };
+    set(v: Int): Int { value <- v };
+};
+
+class Main inherits IO {
+    kept: Pair;
+
+    -- a pair per iteration that only lives until the next one
+    sum(n: Int): Int {
+        let s: Int <- 0, i: Int <- 0 in {
+            while i < n loop {
+                let p: Pair <- new Pair in {
+                    p.setFirst(i);
+                    p.setSecond(i * 2);
+                    case p.first() of x: Int => s <- s + x; esac;
+                    case p.second() of x: Int => s <- s + x; esac;
+                };
+                i <- i + 1;
+            } pool;
+            s;
+        }
+    };
+
+    -- the heap objects a pair holds live through the collections below
+    hold(): String {
+        let p: Pair <- new Pair, junk: String in {
+            p.setFirst("held ".concat("string"));
+            p.setSecond(new Cell);
+            let i: Int <- 0 in
+                while i < 100000 loop {
+                    junk <- "x".concat(i.type_name());
+                    i <- i + 1;
+                } pool;
+            case p.second() of c: Cell => c.set(5); esac;
+            case p.first() of s: String => s; esac;
+        }
+    };
+
+    -- the object made in the last iteration is still read in this one
+    chain(n: Int): Int {
+        let prev: Cell, c: Cell, s: Int <- 0, i: Int <- 0 in {
+            while i < n loop {
+                c <- new Cell;
+                c.set(i);
+                if not isvoid prev then s <- s + prev.value() else 0 fi;
+                prev <- c;
+                i <- i + 1;
+            } pool;
+            s;
+        }
+    };
+
+    -- a pair stored in an attribute outlives the call
+    keep(): Pair {
+        let p: Pair <- new Pair in {
+            kept <- p;
+            p;
+        }
+    };
+
+    main(): Object {
+        {
+            out_int(sum(1000)).out_string(" ");
+            out_string(hold()).out_string(" ");
+            out_int(chain(10)).out_string(" ");
+            keep().setFirst(3);
+            case kept.first() of x: Int => out_int(x); esac;
+            out_string(" ").out_string(kept.tag()).out_string("\n");
+        }
+    };
+};
@@ -0,0 +1,40 @@
+-- no state, so every new can be the same object
+class Math {
+    square(x: Int): Int { x * x };
+    max(a: Int, b: Int): Int { if a < b then b else a fi };
+};
+
+class MoreMath inherits Math {
+    cube(x: Int): Int { x * square(x) };
+};
+
+-- only good for its identity
+class Marker {};
+
+-- a copy of its own keeps every object distinct
+class Token {
+    copy(): SELF_TYPE { self };
+    name(): String { "token" };
+};
+
+class Main inherits IO {
+    main(): Object {
+        let m: Math <- new MoreMath, s: Int <- 0, i: Int <- 0 in {
+            while i < 10 loop {
+                s <- s + new Math.square(i) + new MoreMath.cube(i);
+                i <- i + 1;
+            } pool;
+            out_int(s).out_string(" ");
+            out_int(new Math.max(3, 4)).out_string(" ");
+            out_string(m.type_name()).out_string(" ");
+            out_string(new Math.copy().type_name()).out_string(" ");
+            case m of
+                x: MoreMath => out_string("more ");
+                x: Math => out_string("math ");
+            esac;
+            out_string(if new Marker = new Marker then "same " else "distinct " fi);
+            out_string(if new Token = new Token then "same " else "distinct " fi);
+            out_string(new Token.name()).out_string("\n");
+        }
+    };
+};
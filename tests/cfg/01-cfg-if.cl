@@ -0,0 +1,3 @@
+class A {
+    f(x : Int, y : Int) : Int { if x < y then x else y fi };
+};
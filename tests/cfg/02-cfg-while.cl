@@ -0,0 +1,8 @@
+class A {
+    f(n : Int) : Int {
+        let i : Int <- 0, s : Int <- 0 in {
+            while i < n loop { s <- s + i; i <- i + 1; } pool;
+            s;
+        }
+    };
+};
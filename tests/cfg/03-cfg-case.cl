@@ -0,0 +1,9 @@
+class A {
+    f(o : Object) : Int {
+        case o of
+            i : Int => i;
+            s : String => s.length();
+            x : Object => 0;
+        esac
+    };
+};
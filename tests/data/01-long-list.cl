@@ -0,0 +1,27 @@
+class Main inherits IO {
+    -- deep enough to overflow the stack if the walks were not tail calls
+    size: Int <- 1000000;
+
+    build(n: Int): List {
+        let i: Int <- 0,
+            l: List
+        in {
+            while i < n loop {
+                l <- new List.init(n - i, l);
+                i <- i + 1;
+            } pool;
+            l;
+        }
+    };
+
+    main(): Object {
+        let l: List <- build(size)
+        in {
+            out_int(case l.index(size - 1) of i: Int => i; esac).out_string(" ");
+            l.append(size + 1);
+            out_int(case l.index(size) of i: Int => i; esac).out_string(" ");
+            l.concat(build(3));
+            out_int(case l.index(size + 3) of i: Int => i; esac).out_string("\n");
+        }
+    };
+};
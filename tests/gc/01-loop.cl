@@ -0,0 +1,13 @@
+class Main inherits IO {
+    main(): Object {
+        let i: Int <- 0,
+            sum: Int <- 0
+        in {
+            while i < 1000000 loop {
+                sum <- sum + i.mod(7);
+                i <- i + 1;
+            } pool;
+            out_int(sum).out_string("\n");
+        }
+    };
+};
@@ -0,0 +1,56 @@
+class Node {
+    value: Int;
+    next: Node;
+
+    value(): Int { value };
+    next(): Node { next };
+    set_value(v: Int): Int { value <- v };
+
+    init(v: Int, n: Node): Node {
+        {
+            value <- v;
+            next <- n;
+            self;
+        }
+    };
+};
+
+class Main inherits IO {
+    nodes: Node;
+
+    sum(): Int {
+        let n: Node <- nodes,
+            s: Int <- 0
+        in {
+            while not isvoid n loop {
+                s <- s + n.value();
+                n <- n.next();
+            } pool;
+            s;
+        }
+    };
+
+    main(): Object {
+        let i: Int <- 0,
+            round: Int <- 0,
+            n: Node
+        in {
+            while i < 10000 loop {
+                nodes <- new Node.init(i, nodes);
+                i <- i + 1;
+            } pool;
+            out_int(sum()).out_string("\n");
+
+            -- the nodes are old by now, store fresh integers in them
+            while round < 20 loop {
+                n <- nodes;
+                while not isvoid n loop {
+                    n.set_value(n.value() + 1);
+                    n <- n.next();
+                } pool;
+                round <- round + 1;
+            } pool;
+            out_int(sum()).out_string("\n");
+        }
+    };
+};
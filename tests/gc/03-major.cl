@@ -0,0 +1,53 @@
+class Node {
+    value: String;
+    next: Node;
+
+    value(): String { value };
+    next(): Node { next };
+
+    init(v: String, n: Node): Node {
+        {
+            value <- v;
+            next <- n;
+            self;
+        }
+    };
+};
+
+class Main inherits IO {
+    build(size: Int): Node {
+        let i: Int <- 0,
+            n: Node
+        in {
+            while i < size loop {
+                n <- new Node.init(i.to_string().concat("!"), n);
+                i <- i + 1;
+            } pool;
+            n;
+        }
+    };
+
+    length(n: Node): Int {
+        let l: Int <- 0
+        in {
+            while not isvoid n loop {
+                l <- l + n.value().length();
+                n <- n.next();
+            } pool;
+            l;
+        }
+    };
+
+    main(): Object {
+        let round: Int <- 0,
+            keep: Node
+        in {
+            while round < 10 loop {
+                keep <- build(100000);
+                round <- round + 1;
+            } pool;
+            out_int(length(keep)).out_string("\n");
+            out_string(keep.value()).out_string("\n");
+        }
+    };
+};
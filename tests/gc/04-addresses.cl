@@ -0,0 +1,28 @@
+class Main inherits IO {
+    junk: Object;
+    kept: Int;
+
+    -- the raw address of an object, an Int the collector must not touch
+    addr(o: Object): Int { new Ref.init(o).addr() };
+
+    churn(n: Int): Object {
+        let i: Int <- 0 in
+            while i < n loop {
+                junk <- new Tuple;
+                i <- i + 1;
+            } pool
+    };
+
+    main(): Object {
+        let a: Int <- addr(new Object),
+            pad: Object <- churn(1000),
+            b: Int <- addr(new Object),
+            d: Int <- b - a
+        in {
+            kept <- b;
+            churn(200000);
+            if b - a = d then out_string("same\n") else out_string("moved\n") fi;
+            if kept - a = d then out_string("same\n") else out_string("moved\n") fi;
+        }
+    };
+};
@@ -0,0 +1,21 @@
+class Shape {
+    sides(): Int { 0 };
+    name(): String { "shape" };
+};
+
+class Square inherits Shape {
+    sides(): Int { 4 };
+};
+
+class Main {
+    shape: Shape <- new Square;
+
+    -- every Shape has the same name, but not the same sides
+    main(): Object {
+        {
+            shape.name();
+            shape.sides();
+            new Square.sides();
+        }
+    };
+};
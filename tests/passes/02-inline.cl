@@ -0,0 +1,14 @@
+class Point {
+    x: Int <- 3;
+
+    x(): Int { x };
+    twice(n: Int): Int { n + n };
+};
+
+class Main {
+    point: Point <- new Point;
+
+    main(): Object {
+        point.twice(point.x())
+    };
+};
@@ -0,0 +1,8 @@
+class Main {
+    main(): Object {
+        let a: Int <- 6,
+            b: Int <- a * 7
+        in
+            if b < 40 then a else b - 2 fi
+    };
+};
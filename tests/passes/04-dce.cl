@@ -0,0 +1,10 @@
+class Main {
+    main(): Object {
+        let unused: Int <- 1 + 2,
+            s: String <- "dead"
+        in {
+            s <- "live";
+            if false then "never" else s fi;
+        }
+    };
+};
@@ -0,0 +1,9 @@
+class Main {
+    main(): Object {
+        let a: String <- "a",
+            b: String <- a,
+            c: String <- b
+        in
+            c.concat(b).concat(a)
+    };
+};
@@ -0,0 +1,12 @@
+class Main {
+    x: Int <- 5;
+
+    -- y * y is computed once, even again in the branch
+    main(): Object {
+        let y: Int <- x,
+            a: Int <- y * y,
+            b: Int <- y * y
+        in
+            if 0 < a then y * y else a + b fi
+    };
+};
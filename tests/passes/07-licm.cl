@@ -0,0 +1,17 @@
+class Main {
+    size: Int <- 10;
+
+    -- n * n does not change in the loop
+    main(): Object {
+        let n: Int <- size,
+            i: Int <- 0,
+            sum: Int <- 0
+        in {
+            while i < n loop {
+                sum <- sum + n * n;
+                i <- i + 1;
+            } pool;
+            sum;
+        }
+    };
+};
@@ -0,0 +1,21 @@
+class Point {
+    x: Int <- 0;
+    y: Int <- 0;
+
+    init(a: Int, b: Int): Point { { x <- a; y <- b; self; } };
+    sum(): Int { x + y };
+};
+
+class Main {
+    kept: Point;
+
+    -- the first point is only read, the second one is stored
+    main(): Object {
+        let p: Point <- new Point.init(1, 2),
+            q: Point <- new Point
+        in {
+            kept <- q;
+            p.sum();
+        }
+    };
+};
@@ -0,0 +1,22 @@
+class Helper {
+    double(n: Int): Int { n * 2 };
+};
+
+class Counter {
+    count: Int;
+
+    next(): Int { count <- count + 1 };
+};
+
+class Marker {};
+
+class Main {
+    -- only Helper has no state and more than the methods of Object
+    main(): Object {
+        {
+            new Marker;
+            new Counter.next();
+            new Helper.double(21);
+        }
+    };
+};